@@ -1,15 +1,117 @@
 #pragma once
 
+#include <stdint.h>
+
+/// callback load histogram bins, each one 10% of the buffer period wide, the
+/// last one collects everything from 190% up
+#define AUDIO_LOAD_BINS 20
+
+struct audio_load_t {
+    int callbacks;
+    int underflows;
+    int overflows;
+    int priming;
+
+    /// time spent in the callback as a fraction of the buffer period
+    float load_avg;
+    float load_max;
+
+    int histogram[ AUDIO_LOAD_BINS ];
+};
+
+/// impulse response the convolver loads in audio_init(), null for none
+void audio_set_impulse_response( const char * path );
+
 int audio_init();
 
 void audio_tick();
 
 void audio_destroy();
 
-void audio_start_midi( int midi_no );
+// event timestamps are porttime milliseconds (Pt_Time()), every event is
+// played a constant latency after its timestamp
+
+void audio_start_midi( int midi_no, int timestamp );
+
+void audio_send_control( int control, int value, int timestamp );
+
+/// sets a synth_param_t at the start of the next callback
+void audio_set_param( int param, float amount );
+
+/// 14 bit pitch wheel position, 0x2000 is centered
+void audio_send_bend( int value, int timestamp );
+
+/// selects the oscillator waveform, program numbers wrap around the waveforms
+void audio_send_program( int program, int timestamp );
+
+void audio_stop_midi( int midi_no, int timestamp );
+
+/// latency added on top of the stream output latency, it must cover the
+/// time from an event happening to the synth seeing it
+void audio_set_midi_latency( float seconds );
+
+/// midi latency until audio_set_midi_latency() is called; it covers a
+/// callback running half a period late, the millisecond midi polling and
+/// timestamp resolution and the limiter's lookahead
+#define AUDIO_MIDI_LATENCY 0.005f
+
+/// what audio_schedule_frame() maps timestamps with
+struct audio_clock_t {
+    /// frame the most recent callback started rendering on, and the stream
+    /// time it reaches the dac; 0 before the first callback
+    int64_t anchor_frame;
+    double anchor_dac_time;
+
+    /// stream time minus porttime in seconds, the smallest seen so far
+    double pt_offset;
+
+    /// from an event happening to it being heard, in seconds
+    double latency;
+
+    /// frames the output is delayed by after it is rendered
+    int lookahead;
+};
+
+/// render frame an event with a porttime timestamp should sound on, a
+/// constant latency after it happened; offset is stream time minus porttime
+/// as read right now, it replaces pt_offset when that is further off
+int64_t audio_schedule_frame(
+    audio_clock_t * clock,
+    int timestamp,
+    double offset
+);
+
+/// what the audio thread saw during its most recent callback
+struct audio_telemetry_t {
+    int64_t frame;
+
+    int voice_count;
+
+    /// loudest envelope among the sounding voices
+    float eg_level;
+
+    float peak;
+    float rms;
+
+    /// time spent in the callback as a fraction of the buffer period
+    float load;
+};
+
+/// reads the callback statistics without blocking the audio thread
+void audio_get_load( audio_load_t * out );
 
-void audio_send_control( int value );
+/// counts a callback that took busy_ns for frames into the statistics,
+/// status_flags are the ones portaudio passed it; only the audio callback
+/// calls this while the stream runs
+void audio_record_callback(
+    int64_t busy_ns,
+    unsigned long frames,
+    unsigned long status_flags
+);
 
-void audio_stop_midi();
+/// copies the freshest complete telemetry block, call from one thread only
+void audio_get_telemetry( audio_telemetry_t * out );
 
-float audio_visual_1();
\ No newline at end of file
+/// copies the newest count output samples (left channel) oldest first and
+/// returns how many were available, call from one thread only
+int audio_read_scope( float * out, int count );
\ No newline at end of file
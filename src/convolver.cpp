@@ -0,0 +1,445 @@
+#include "convolver.hpp"
+
+#include <string.h>
+
+#include <chrono>
+
+/// how long the worker sleeps when it has no complete block to work on
+#define CONVOLVER_POLL_US 500
+
+/// cuts taps [ start, end ) of one channel of the response into partitions
+/// of block taps; a level with no taps allocates nothing
+static void conv_level_init(
+    conv_level_t * l,
+    const float * ir,
+    int channels,
+    int channel,
+    int start,
+    int end,
+    int block
+)
+{
+    memset( l, 0, sizeof( *l ) );
+    l->block = block;
+    if ( end <= start ) return;
+
+    l->partitions = ( end - start + block - 1 ) / block;
+    fft_real_plan_init( &l->fft, 2 * block );
+
+    const int bins = 2 * block; // floats in one spectrum
+    l->spectra = new float[ l->partitions * bins ];
+    l->delay = new float[ l->partitions * bins ]();
+    l->window = new float[ 2 * block ]();
+    l->work = new float[ 2 * bins ];
+
+    // the spectra carry the 1 / size of the inverse transform
+    const float scale = 1.0f / ( 2 * block );
+
+    for ( int p = 0; p < l->partitions; p++ ) {
+        float * h = l->spectra + p * bins;
+        float * taps = l->work;
+        memset( taps, 0, sizeof( float ) * 2 * block );
+
+        for ( int k = 0; k < block; k++ ) {
+            int tap = start + p * block + k;
+            if ( tap >= end ) break;
+            taps[ k ] = scale * ir[ tap * channels + channel ];
+        }
+
+        fft_real_forward( &l->fft, taps, h, h + block );
+    }
+}
+
+static void conv_level_free( conv_level_t * l )
+{
+    if ( l->partitions ) fft_real_plan_free( &l->fft );
+    delete[] l->spectra;
+    delete[] l->delay;
+    delete[] l->window;
+    delete[] l->work;
+    memset( l, 0, sizeof( *l ) );
+}
+
+/// takes the next block input samples and returns the level's part of the
+/// convolution over the same block, delayed by the level's start
+///
+/// overlap-save: the fft of the last two blocks of input is multiplied with
+/// every partition against the window as it was that many blocks ago, and
+/// the second half of the inverse is free of wrap around
+static void conv_level_block(
+    conv_level_t * l,
+    const float * in,
+    float * out
+)
+{
+    const int block = l->block;
+    const int bins = 2 * block;
+
+    memmove( l->window, l->window + block, sizeof( float ) * block );
+    memcpy( l->window + block, in, sizeof( float ) * block );
+
+    // the newest spectrum overwrites the oldest, so partition p pairs with
+    // the entry p after the newest
+    l->newest = ( l->newest + l->partitions - 1 ) % l->partitions;
+
+    float * x = l->delay + l->newest * bins;
+    fft_real_forward( &l->fft, l->window, x, x + block );
+
+    float * acc = l->work;
+    memset( acc, 0, sizeof( float ) * bins );
+
+    for ( int p = 0; p < l->partitions; p++ ) {
+        int entry = ( l->newest + p ) % l->partitions;
+        const float * xp = l->delay + entry * bins;
+        const float * hp = l->spectra + p * bins;
+
+        fft_spectrum_mac(
+            block,
+            acc,
+            acc + block,
+            xp,
+            xp + block,
+            hp,
+            hp + block
+        );
+    }
+
+    float * y = l->work + bins;
+    fft_real_inverse( &l->fft, acc, acc + block, y );
+
+    memcpy( out, y + block, sizeof( float ) * block );
+}
+
+/// runs one worker block, the input ring must hold a whole block and the
+/// output ring must have room for one
+static void tail_block( convolver_t * c )
+{
+    float frames[ CONVOLVER_TAIL_BLOCK * 2 ];
+    float in[ CONVOLVER_TAIL_BLOCK ];
+    float out[ CONVOLVER_TAIL_BLOCK ];
+
+    PaUtil_ReadRingBuffer( &c->tail_in, frames, CONVOLVER_TAIL_BLOCK );
+
+    for ( int ch = 0; ch < 2; ch++ ) {
+        for ( int i = 0; i < CONVOLVER_TAIL_BLOCK; i++ ) {
+            in[ i ] = frames[ 2 * i + ch ];
+        }
+
+        conv_level_block( &c->tail[ ch ], in, out );
+
+        for ( int i = 0; i < CONVOLVER_TAIL_BLOCK; i++ ) {
+            frames[ 2 * i + ch ] = out[ i ];
+        }
+    }
+
+    PaUtil_WriteRingBuffer( &c->tail_out, frames, CONVOLVER_TAIL_BLOCK );
+}
+
+static bool tail_ready( convolver_t * c )
+{
+    return PaUtil_GetRingBufferReadAvailable( &c->tail_in ) >=
+               CONVOLVER_TAIL_BLOCK &&
+           PaUtil_GetRingBufferWriteAvailable( &c->tail_out ) >=
+               CONVOLVER_TAIL_BLOCK;
+}
+
+static void tail_worker( convolver_t * c )
+{
+    while ( c->running.load( std::memory_order_acquire ) ) {
+        if ( tail_ready( c ) ) {
+            tail_block( c );
+        } else {
+            std::this_thread::sleep_for(
+                std::chrono::microseconds( CONVOLVER_POLL_US )
+            );
+        }
+    }
+}
+
+void convolver_init( convolver_t * c )
+{
+    c->mix = 1.0f;
+    c->length = 0;
+    c->ring_memory = nullptr;
+    c->synchronous = false;
+    c->running.store( false );
+
+    memset( c->body, 0, sizeof( c->body ) );
+    memset( c->tail, 0, sizeof( c->tail ) );
+}
+
+void convolver_load(
+    convolver_t * c,
+    const float * ir,
+    int channels,
+    int frames,
+    bool synchronous
+)
+{
+    convolver_free( c );
+    if ( frames <= 0 ) return;
+
+    c->length = frames;
+    c->synchronous = synchronous;
+    c->fill = 0;
+    c->frame = 0;
+    c->tail_skip = 0;
+    c->tail_late = 0;
+
+    memset( c->head, 0, sizeof( c->head ) );
+    memset( c->history, 0, sizeof( c->history ) );
+    memset( c->body_out, 0, sizeof( c->body_out ) );
+
+    int head = frames < CONVOLVER_HEAD ? frames : CONVOLVER_HEAD;
+    int body = frames < CONVOLVER_TAIL_START ? frames : CONVOLVER_TAIL_START;
+
+    for ( int ch = 0; ch < 2; ch++ ) {
+        int channel = channels > 1 ? ch : 0;
+
+        for ( int k = 0; k < head; k++ ) {
+            c->head[ ch ][ CONVOLVER_HEAD - 1 - k ] =
+                ir[ k * channels + channel ];
+        }
+
+        conv_level_init(
+            &c->body[ ch ],
+            ir,
+            channels,
+            channel,
+            CONVOLVER_HEAD,
+            body,
+            CONVOLVER_HEAD
+        );
+        conv_level_init(
+            &c->tail[ ch ],
+            ir,
+            channels,
+            channel,
+            CONVOLVER_TAIL_START,
+            frames,
+            CONVOLVER_TAIL_BLOCK
+        );
+    }
+
+    if ( !c->tail[ 0 ].partitions ) return;
+
+    const int ring = 2 * CONVOLVER_RING_FRAMES;
+    c->ring_memory = new float[ 2 * ring ];
+    PaUtil_InitializeRingBuffer(
+        &c->tail_in,
+        2 * sizeof( float ),
+        CONVOLVER_RING_FRAMES,
+        c->ring_memory
+    );
+    PaUtil_InitializeRingBuffer(
+        &c->tail_out,
+        2 * sizeof( float ),
+        CONVOLVER_RING_FRAMES,
+        c->ring_memory + ring
+    );
+
+    if ( !synchronous ) {
+        c->running.store( true, std::memory_order_release );
+        c->worker = std::thread( tail_worker, c );
+    }
+}
+
+void convolver_free( convolver_t * c )
+{
+    if ( c->worker.joinable() ) {
+        c->running.store( false, std::memory_order_release );
+        c->worker.join();
+    }
+
+    for ( int ch = 0; ch < 2; ch++ ) {
+        conv_level_free( &c->body[ ch ] );
+        conv_level_free( &c->tail[ ch ] );
+    }
+
+    delete[] c->ring_memory;
+    c->ring_memory = nullptr;
+    c->length = 0;
+}
+
+int convolver_memory( const convolver_t * c )
+{
+    int floats = c->ring_memory ? 4 * CONVOLVER_RING_FRAMES : 0;
+
+    const conv_level_t * levels[ 4 ] = {
+        &c->body[ 0 ], &c->body[ 1 ], &c->tail[ 0 ], &c->tail[ 1 ],
+    };
+    for ( const conv_level_t * l : levels ) {
+        if ( !l->partitions ) continue;
+        floats += 2 * l->partitions * 2 * l->block; // spectra and delay
+        floats += 2 * l->block + 4 * l->block;      // window and work
+        floats += 19 * l->block / 2;                // the fft plans
+    }
+
+    return (int) sizeof( float ) * floats;
+}
+
+/// the head taps over the windows starting at x, x + 1, x + 2 and x + 3,
+/// the lanes are four consecutive outputs like halfband_fir()
+static inline f32x4 head_fir( const float * h, const float * x )
+{
+    f32x4 acc0 = f32x4_zero();
+    f32x4 acc1 = f32x4_zero();
+    f32x4 acc2 = f32x4_zero();
+    f32x4 acc3 = f32x4_zero();
+
+    for ( int k = 0; k < CONVOLVER_HEAD; k += 4 ) {
+        acc0 += f32x4_loadu( x + k ) * f32x4_set1( h[ k ] );
+        acc1 += f32x4_loadu( x + k + 1 ) * f32x4_set1( h[ k + 1 ] );
+        acc2 += f32x4_loadu( x + k + 2 ) * f32x4_set1( h[ k + 2 ] );
+        acc3 += f32x4_loadu( x + k + 3 ) * f32x4_set1( h[ k + 3 ] );
+    }
+
+    return ( acc0 + acc1 ) + ( acc2 + acc3 );
+}
+
+/// adds what the worker made for the frames frames starting at c->frame,
+/// taking only what is already in the ring
+static void read_tail(
+    convolver_t * c,
+    float ( *wet )[ CONVOLVER_HEAD ],
+    int frames
+)
+{
+    // the worker level starts CONVOLVER_TAIL_START frames into the output
+    int64_t first = c->frame - CONVOLVER_TAIL_START;
+    int offset = first < 0 ? (int) ( -first < frames ? -first : frames ) : 0;
+    int count = frames - offset;
+
+    // input the worker never saw leaves a gap of silence
+    if ( c->tail_skip < 0 && count > 0 ) {
+        int gap = -c->tail_skip < count ? (int) -c->tail_skip : count;
+        c->tail_skip += gap;
+        offset += gap;
+        count -= gap;
+    }
+    if ( count <= 0 ) return;
+
+    if ( c->tail_skip > 0 ) {
+        int64_t ready = PaUtil_GetRingBufferReadAvailable( &c->tail_out );
+        int64_t drop = ready < c->tail_skip ? ready : c->tail_skip;
+        PaUtil_AdvanceRingBufferReadIndex(
+            &c->tail_out,
+            (ring_buffer_size_t) drop
+        );
+        c->tail_skip -= drop;
+    }
+
+    float tail[ CONVOLVER_HEAD * 2 ];
+    int got = 0;
+    if ( !c->tail_skip ) {
+        got = (int) PaUtil_ReadRingBuffer( &c->tail_out, tail, count );
+    }
+
+    for ( int i = 0; i < got; i++ ) {
+        wet[ 0 ][ offset + i ] += tail[ 2 * i ];
+        wet[ 1 ][ offset + i ] += tail[ 2 * i + 1 ];
+    }
+
+    // never wait, what is missing now is dropped once it comes in
+    if ( got < count ) {
+        c->tail_skip += count - got;
+        c->tail_late += count - got;
+    }
+}
+
+/// hands the worker the input of the frames starting at c->frame
+static void write_tail( convolver_t * c, float * const * in, int frames )
+{
+    float input[ CONVOLVER_HEAD * 2 ];
+    for ( int i = 0; i < frames; i++ ) {
+        input[ 2 * i ] = in[ 0 ][ i ];
+        input[ 2 * i + 1 ] = in[ 1 ][ i ];
+    }
+
+    int written = (int) PaUtil_WriteRingBuffer( &c->tail_in, input, frames );
+    c->tail_skip -= frames - written;
+
+    if ( c->synchronous ) {
+        while ( tail_ready( c ) ) tail_block( c );
+    }
+}
+
+/// processes up to the end of the current head block
+static void convolver_chunk( convolver_t * c, float * const * io, int frames )
+{
+    SIMD_ALIGN float wet[ 2 ][ CONVOLVER_HEAD ];
+
+    for ( int ch = 0; ch < 2; ch++ ) {
+        float * history = c->history[ ch ];
+        memcpy(
+            history + CONVOLVER_HEAD + c->fill,
+            io[ ch ],
+            sizeof( float ) * frames
+        );
+
+        // the window of output i ends on input i, CONVOLVER_HEAD - 1 back
+        const float * x = history + c->fill + 1;
+        for ( int i = 0; i < frames; i += SIMD_LANES ) {
+            f32x4_store( wet[ ch ] + i, head_fir( c->head[ ch ], x + i ) );
+        }
+
+        for ( int i = 0; i < frames; i++ ) {
+            wet[ ch ][ i ] += c->body_out[ ch ][ c->fill + i ];
+        }
+    }
+
+    if ( c->tail[ 0 ].partitions ) {
+        read_tail( c, wet, frames );
+        write_tail( c, io, frames );
+    }
+
+    const float mix = c->mix;
+    for ( int ch = 0; ch < 2; ch++ ) {
+        float * x = io[ ch ];
+        for ( int i = 0; i < frames; i++ ) {
+            x[ i ] += mix * ( wet[ ch ][ i ] - x[ i ] );
+        }
+    }
+
+    c->fill += frames;
+    c->frame += frames;
+    if ( c->fill < CONVOLVER_HEAD ) return;
+
+    // the block is complete, the body level covers the next one
+    for ( int ch = 0; ch < 2; ch++ ) {
+        float * history = c->history[ ch ];
+
+        if ( c->body[ ch ].partitions ) {
+            conv_level_block(
+                &c->body[ ch ],
+                history + CONVOLVER_HEAD,
+                c->body_out[ ch ]
+            );
+        }
+
+        memcpy(
+            history,
+            history + CONVOLVER_HEAD,
+            sizeof( float ) * CONVOLVER_HEAD
+        );
+    }
+
+    c->fill = 0;
+}
+
+void convolver_process( convolver_t * c, float * const * io, int frames )
+{
+    // nothing loaded, or the effect is switched off; the convolution pauses
+    // rather than resets, which needs no handshake with the worker
+    if ( !c->length || c->mix <= 0.0f ) return;
+
+    for ( int done = 0; done < frames; ) {
+        int n = CONVOLVER_HEAD - c->fill;
+        if ( n > frames - done ) n = frames - done;
+
+        float * chunk[ 2 ] = { io[ 0 ] + done, io[ 1 ] + done };
+        convolver_chunk( c, chunk, n );
+
+        done += n;
+    }
+}
@@ -0,0 +1,108 @@
+#pragma once
+
+#include "fft.hpp"
+#include "simd.hpp"
+
+#include <pa_ringbuffer.h>
+
+#include <atomic>
+#include <thread>
+
+/// taps of the direct form head, and the block of the first fft level
+#define CONVOLVER_HEAD 64
+
+/// block of the second fft level, which runs on the worker thread
+#define CONVOLVER_TAIL_BLOCK 1024
+
+/// where the worker level starts in the impulse response; a worker block is
+/// due one whole block after its input is complete, which is its deadline
+#define CONVOLVER_TAIL_START ( 2 * CONVOLVER_TAIL_BLOCK )
+
+/// frames either ring between the audio thread and the worker holds
+#define CONVOLVER_RING_FRAMES ( 8 * CONVOLVER_TAIL_BLOCK )
+
+/// one uniformly partitioned overlap-save convolution of a block size
+///
+/// the impulse response is cut into partitions of block taps, each kept as
+/// the spectrum of its zero padded 2 block fft; the spectra of the last
+/// input windows are kept in a frequency domain delay line, and every block
+/// multiplies the two and sums over the partitions
+struct conv_level_t {
+    int block;
+    int partitions;
+    fft_real_plan_t fft;
+
+    /// packed real spectra of block bins, real parts then imaginary parts
+    float * spectra; // of the partitions
+    float * delay;   // of the last input windows, a ring starting at newest
+    int newest;
+
+    float * window; // the last 2 block input samples
+    float * work;   // a spectrum and 2 block samples of scratch
+};
+
+/// zero latency convolution of a stereo signal with an impulse response
+///
+/// the first CONVOLVER_HEAD taps run in direct form, the rest up to
+/// CONVOLVER_TAIL_START as a small fft level at the end of every head block,
+/// both on the calling thread; the rest of a long response runs on a worker
+/// thread in big blocks, handed over through lock free rings so the caller
+/// never waits on it
+struct convolver_t {
+    float mix; // 0 bypasses the effect, 1 is only the convolution
+
+    /// taps of the response, 0 while nothing is loaded
+    int length;
+
+    /// the head taps oldest input first, and the input of the current head
+    /// block after the CONVOLVER_HEAD samples before it
+    SIMD_ALIGN float head[ 2 ][ CONVOLVER_HEAD ];
+    SIMD_ALIGN float history[ 2 ][ 2 * CONVOLVER_HEAD + SIMD_LANES ];
+    int fill; // samples in the current head block
+
+    /// the first fft level and its output over the current head block
+    conv_level_t body[ 2 ];
+    SIMD_ALIGN float body_out[ 2 ][ CONVOLVER_HEAD ];
+
+    /// the worker level, the input ring is written by the caller and the
+    /// output ring by the worker, both hold stereo frames
+    conv_level_t tail[ 2 ];
+    PaUtilRingBuffer tail_in;
+    PaUtilRingBuffer tail_out;
+    float * ring_memory;
+
+    /// frames rendered since the response was loaded
+    int64_t frame;
+
+    /// tail frames the worker delivered too late to be played, they are
+    /// dropped when they come in; below 0 it is frames the worker never got
+    /// the input for, which are played as silence instead
+    int64_t tail_skip;
+    int64_t tail_late; // tail frames that were not ready in time
+
+    /// with no worker the tail is computed on the calling thread, for
+    /// offline rendering where the result must not depend on timing
+    bool synchronous;
+    std::thread worker;
+    std::atomic< bool > running;
+};
+
+void convolver_init( convolver_t * c );
+
+/// takes a response of frames frames and 1 or 2 interleaved channels, a mono
+/// one is used for both sides; not while convolver_process() may run
+void convolver_load(
+    convolver_t * c,
+    const float * ir,
+    int channels,
+    int frames,
+    bool synchronous
+);
+
+/// stops the worker and releases the response
+void convolver_free( convolver_t * c );
+
+/// bytes the loaded response takes up
+int convolver_memory( const convolver_t * c );
+
+void convolver_process( convolver_t * c, float * const * io, int frames );
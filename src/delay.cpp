@@ -0,0 +1,409 @@
+#include "delay.hpp"
+
+#include "simd.hpp"
+
+#include <math.h>
+#include <string.h>
+
+/// samples the effects process at once, longer calls are split up
+#define DELAY_BLOCK 64
+
+/// longest echo and the room the swept effects have, in seconds
+#define ECHO_MAX_TIME    2.0f
+#define CHORUS_MAX_TIME  0.05f
+#define FLANGER_MAX_TIME 0.02f
+
+/// how quickly the echo follows a new delay time, in seconds
+#define ECHO_GLIDE_TIME 0.05f
+
+/// samples at the start of a line mirrored past its end, so the taps of four
+/// consecutive outputs can be loaded as vectors without wrapping
+#define DELAY_GUARD 8
+
+void delay_line_init( delay_line_t * d, int size )
+{
+    uint32_t n = SIMD_LANES;
+    while ( n < (uint32_t) size ) n <<= 1;
+
+    d->buffer = new float[ n + DELAY_GUARD ];
+    d->mask = n - 1;
+    delay_line_clear( d, DELAY_MIN );
+}
+
+void delay_line_free( delay_line_t * d )
+{
+    delete[] d->buffer;
+    d->buffer = nullptr;
+}
+
+void delay_line_clear( delay_line_t * d, float delay )
+{
+    memset( d->buffer, 0, sizeof( float ) * ( d->mask + 1 + DELAY_GUARD ) );
+    d->write = 0;
+    d->delay = (int32_t) ( delay * ( 1 << DELAY_FRAC_BITS ) + 0.5f );
+}
+
+void delay_line_process(
+    delay_line_t * d,
+    const float * in,
+    float * out,
+    int frames,
+    float delay,
+    float feedback
+)
+{
+    // the oldest tap the interpolation reads must not have been overwritten
+    // by the samples written so far in the current group
+    const float longest = (float) ( d->mask - SIMD_LANES - 2 );
+    if ( delay < DELAY_MIN ) delay = DELAY_MIN;
+    if ( delay > longest ) delay = longest;
+
+    int32_t target = (int32_t) ( delay * ( 1 << DELAY_FRAC_BITS ) + 0.5f );
+    int32_t step = ( target - d->delay ) / frames;
+
+    // the read position moves on by a sample minus the change in delay every
+    // frame, in fixed point that is an accumulator like an oscillator phase
+    uint32_t advance = ( 1u << DELAY_FRAC_BITS ) - (uint32_t) step;
+    uint32_t first = ( d->write << DELAY_FRAC_BITS ) - (uint32_t) d->delay -
+                     (uint32_t) step;
+
+    SIMD_ALIGN int32_t start[ SIMD_LANES ];
+    for ( int l = 0; l < SIMD_LANES; l++ ) {
+        start[ l ] = (int32_t) ( first + l * advance );
+    }
+
+    const i32x4 group = i32x4_set1( (int32_t) ( SIMD_LANES * advance ) );
+    const i32x4 mask = i32x4_set1( (int32_t) d->mask );
+    const i32x4 frac_mask = i32x4_set1( ( 1 << DELAY_FRAC_BITS ) - 1 );
+    const f32x4 frac_scale = f32x4_set1( 1.0f / ( 1 << DELAY_FRAC_BITS ) );
+    const i32x4 prev = i32x4_set1( -1 );
+    const i32x4 next = i32x4_set1( 1 );
+    const i32x4 after = i32x4_set1( 2 );
+    const f32x4 half = f32x4_set1( 0.5f );
+    const f32x4 two = f32x4_set1( 2.0f );
+    const f32x4 two_half = f32x4_set1( 2.5f );
+    const f32x4 one_half = f32x4_set1( 1.5f );
+    const f32x4 feedback4 = f32x4_set1( feedback );
+
+    i32x4 read = i32x4_load( start );
+
+    float * const buffer = d->buffer;
+    const uint32_t size = d->mask + 1;
+
+    for ( int i = 0; i < frames; i += SIMD_LANES ) {
+        // four consecutive outputs per vector, each with its own position
+        i32x4 index = i32x4_srl< DELAY_FRAC_BITS >( read );
+        f32x4 t = i32x4_to_f32x4( read & frac_mask ) * frac_scale;
+
+        SIMD_ALIGN int32_t at[ SIMD_LANES ];
+        i32x4_store( at, index & mask );
+
+        f32x4 xm1, x0, x1, x2;
+        if ( at[ 3 ] - at[ 0 ] == SIMD_LANES - 1 && at[ 0 ] > 0 ) {
+            // unless the delay changes by a sample per sample, the outputs
+            // read consecutive samples and the taps are plain loads
+            const float * x = buffer + at[ 0 ];
+            xm1 = f32x4_loadu( x - 1 );
+            x0 = f32x4_loadu( x );
+            x1 = f32x4_loadu( x + 1 );
+            x2 = f32x4_loadu( x + 2 );
+        } else {
+            xm1 = f32x4_gather( buffer, ( index + prev ) & mask );
+            x0 = f32x4_gather( buffer, index & mask );
+            x1 = f32x4_gather( buffer, ( index + next ) & mask );
+            x2 = f32x4_gather( buffer, ( index + after ) & mask );
+        }
+
+        // catmull-rom, linear interpolation dulls a swept delay audibly
+        f32x4 c1 = half * ( x1 - xm1 );
+        f32x4 c2 = xm1 - two_half * x0 + two * x1 - half * x2;
+        f32x4 c3 = half * ( x2 - xm1 ) + one_half * ( x0 - x1 );
+
+        f32x4 y4 = ( ( c3 * t + c2 ) * t + c1 ) * t + x0;
+
+        uint32_t w = ( d->write + i ) & d->mask;
+        if ( frames - i >= SIMD_LANES && w >= DELAY_GUARD &&
+             w + SIMD_LANES <= size ) {
+            f32x4 x = f32x4_loadu( in + i ) + feedback4 * y4;
+            f32x4_storeu( out + i, y4 );
+            f32x4_storeu( buffer + w, x );
+            read = read + group;
+            continue;
+        }
+
+        // the end of the block, or a group wrapping around the line
+        SIMD_ALIGN float y[ SIMD_LANES ];
+        f32x4_store( y, y4 );
+
+        int count = frames - i < SIMD_LANES ? frames - i : SIMD_LANES;
+        for ( int l = 0; l < count; l++ ) {
+            float x = in[ i + l ] + feedback * y[ l ];
+            out[ i + l ] = y[ l ];
+
+            uint32_t w = ( d->write + i + l ) & d->mask;
+            buffer[ w ] = x;
+            if ( w < DELAY_GUARD ) buffer[ w + size ] = x;
+        }
+
+        read = read + group;
+    }
+
+    d->write = ( d->write + frames ) & d->mask;
+    d->delay += step * frames;
+}
+
+/// out = in + mix ( wet - in ) on both channels
+static void mix_wet(
+    float * const * io,
+    float ( *wet )[ DELAY_BLOCK ],
+    int frames,
+    float mix
+)
+{
+    for ( int c = 0; c < 2; c++ ) {
+        for ( int i = 0; i < frames; i++ ) {
+            io[ c ][ i ] += mix * ( wet[ c ][ i ] - io[ c ][ i ] );
+        }
+    }
+}
+
+void echo_init( echo_t * e, float sample_rate )
+{
+    e->time_left = 0.375f;
+    e->time_right = 0.5f;
+    e->feedback = 0.4f;
+    e->mix = 0.0f;
+    e->active = 0;
+
+    for ( int c = 0; c < 2; c++ ) {
+        delay_line_init( &e->line[ c ], (int) ( ECHO_MAX_TIME * sample_rate ) );
+    }
+}
+
+void echo_free( echo_t * e )
+{
+    for ( int c = 0; c < 2; c++ ) delay_line_free( &e->line[ c ] );
+}
+
+void echo_process(
+    echo_t * e,
+    float * const * io,
+    int frames,
+    float sample_rate
+)
+{
+    if ( e->mix <= 0.0f ) {
+        e->active = 0;
+        return;
+    }
+
+    const float target[ 2 ] = {
+        e->time_left * sample_rate,
+        e->time_right * sample_rate,
+    };
+
+    // repeats left over from before the bypass would come back in
+    if ( !e->active ) {
+        for ( int c = 0; c < 2; c++ ) {
+            e->time[ c ] = target[ c ];
+            delay_line_clear( &e->line[ c ], target[ c ] );
+        }
+        e->active = 1;
+    }
+
+    float feedback = e->feedback;
+    if ( feedback < 0.0f ) feedback = 0.0f;
+    if ( feedback > 0.95f ) feedback = 0.95f;
+
+    float * chunk[ 2 ] = { io[ 0 ], io[ 1 ] };
+    while ( frames > 0 ) {
+        int block = frames < DELAY_BLOCK ? frames : DELAY_BLOCK;
+
+        float glide = 1.0f - expf( -block / ( ECHO_GLIDE_TIME * sample_rate ) );
+        float wet[ 2 ][ DELAY_BLOCK ];
+        for ( int c = 0; c < 2; c++ ) {
+            e->time[ c ] += ( target[ c ] - e->time[ c ] ) * glide;
+            delay_line_process(
+                &e->line[ c ],
+                chunk[ c ],
+                wet[ c ],
+                block,
+                e->time[ c ],
+                feedback
+            );
+        }
+        mix_wet( chunk, wet, block, e->mix );
+
+        chunk[ 0 ] += block;
+        chunk[ 1 ] += block;
+        frames -= block;
+    }
+}
+
+/// delays both channels by centre + depth * lfo, the lfo is read once per
+/// block and the delay glides to it, so the modulation runs at control rate
+static void swept_process(
+    delay_line_t * line,
+    lfo_state_t * lfo,
+    float * const * io,
+    int frames,
+    float rate,
+    float centre,
+    float depth,
+    float feedback,
+    float mix,
+    float sample_rate
+)
+{
+    float * chunk[ 2 ] = { io[ 0 ], io[ 1 ] };
+    while ( frames > 0 ) {
+        int block = frames < DELAY_BLOCK ? frames : DELAY_BLOCK;
+
+        float wet[ 2 ][ DELAY_BLOCK ];
+        for ( int c = 0; c < 2; c++ ) {
+            float sweep = lfo_advance( &lfo[ c ], rate, LFO_SINE, block,
+                                       sample_rate );
+            float delay = ( centre + depth * sweep ) * sample_rate;
+            delay_line_process(
+                &line[ c ],
+                chunk[ c ],
+                wet[ c ],
+                block,
+                delay,
+                feedback
+            );
+        }
+        mix_wet( chunk, wet, block, mix );
+
+        chunk[ 0 ] += block;
+        chunk[ 1 ] += block;
+        frames -= block;
+    }
+}
+
+/// restarts the lfos a quarter cycle apart and empties the lines
+static void swept_reset(
+    delay_line_t * line,
+    lfo_state_t * lfo,
+    float delay,
+    float sample_rate
+)
+{
+    for ( int c = 0; c < 2; c++ ) {
+        lfo_init( &lfo[ c ], c + 1 );
+        lfo[ c ].phase = 0.25f * c;
+        delay_line_clear( &line[ c ], delay * sample_rate );
+    }
+}
+
+void chorus_init( chorus_t * c, float sample_rate )
+{
+    c->rate = 0.8f;
+    c->delay = 0.015f;
+    c->depth = 0.004f;
+    c->mix = 0.0f;
+    c->active = 0;
+
+    for ( int i = 0; i < 2; i++ ) {
+        delay_line_init(
+            &c->line[ i ],
+            (int) ( CHORUS_MAX_TIME * sample_rate )
+        );
+    }
+    swept_reset( c->line, c->lfo, c->delay, sample_rate );
+}
+
+void chorus_free( chorus_t * c )
+{
+    for ( int i = 0; i < 2; i++ ) delay_line_free( &c->line[ i ] );
+}
+
+void chorus_process(
+    chorus_t * c,
+    float * const * io,
+    int frames,
+    float sample_rate
+)
+{
+    if ( c->mix <= 0.0f ) {
+        c->active = 0;
+        return;
+    }
+    if ( !c->active ) {
+        swept_reset( c->line, c->lfo, c->delay, sample_rate );
+        c->active = 1;
+    }
+
+    swept_process(
+        c->line,
+        c->lfo,
+        io,
+        frames,
+        c->rate,
+        c->delay,
+        c->depth,
+        0.0f,
+        c->mix,
+        sample_rate
+    );
+}
+
+void flanger_init( flanger_t * f, float sample_rate )
+{
+    f->rate = 0.2f;
+    f->delay = 0.001f;
+    f->depth = 0.004f;
+    f->feedback = 0.6f;
+    f->mix = 0.0f;
+    f->active = 0;
+
+    for ( int i = 0; i < 2; i++ ) {
+        delay_line_init(
+            &f->line[ i ],
+            (int) ( FLANGER_MAX_TIME * sample_rate )
+        );
+    }
+    swept_reset( f->line, f->lfo, f->delay, sample_rate );
+}
+
+void flanger_free( flanger_t * f )
+{
+    for ( int i = 0; i < 2; i++ ) delay_line_free( &f->line[ i ] );
+}
+
+void flanger_process(
+    flanger_t * f,
+    float * const * io,
+    int frames,
+    float sample_rate
+)
+{
+    if ( f->mix <= 0.0f ) {
+        f->active = 0;
+        return;
+    }
+
+    // the sweep is centred between the shortest and the longest point
+    float centre = f->delay + 0.5f * f->depth;
+    if ( !f->active ) {
+        swept_reset( f->line, f->lfo, centre, sample_rate );
+        f->active = 1;
+    }
+
+    float feedback = f->feedback;
+    if ( feedback < -0.95f ) feedback = -0.95f;
+    if ( feedback > 0.95f ) feedback = 0.95f;
+
+    swept_process(
+        f->line,
+        f->lfo,
+        io,
+        frames,
+        f->rate,
+        centre,
+        0.5f * f->depth,
+        feedback,
+        f->mix,
+        sample_rate
+    );
+}
@@ -0,0 +1,116 @@
+#pragma once
+
+#include "mod.hpp"
+
+#include <stdint.h>
+
+/// fractional bits of a delay line position, the remaining 20 bits index the
+/// buffer, so a line holds at most 2^20 samples (23 s at 44.1 kHz)
+#define DELAY_FRAC_BITS 12
+
+/// shortest delay in samples; the kernel reads four samples at a time before
+/// writing them, and the cubic interpolation looks two samples ahead
+#define DELAY_MIN 8
+
+/// circular buffer with a power of two size, positions wrap with a mask
+struct delay_line_t {
+    float * buffer;
+    uint32_t mask;  // size - 1
+    uint32_t write; // index the next sample goes to
+
+    /// delay the last block ended on, fixed point with DELAY_FRAC_BITS
+    int32_t delay;
+};
+
+/// allocates at least size samples, rounded up to a power of two
+void delay_line_init( delay_line_t * d, int size );
+
+void delay_line_free( delay_line_t * d );
+
+/// silences the line and sets the delay without a glide
+void delay_line_clear( delay_line_t * d, float delay );
+
+/// feeds in through the line and stores what it reads in out, the delay
+/// glides linearly from the last one to delay samples across the block
+///
+/// in + feedback * out is written back, so feedback is a comb filter (or an
+/// echo repeating every delay samples); in and out may be the same buffer
+void delay_line_process(
+    delay_line_t * d,
+    const float * in,
+    float * out,
+    int frames,
+    float delay,
+    float feedback
+);
+
+/// stereo delay, every repeat is feedback times quieter than the last
+struct echo_t {
+    float time_left;  // seconds
+    float time_right; // seconds
+    float feedback;   // 0 - 0.95
+    float mix;        // 0 bypasses the effect, 1 is only the repeats
+
+    /// delay times in samples, following the set ones smoothly so a change
+    /// bends the pitch of the repeats instead of clicking
+    float time[ 2 ];
+    int active;
+
+    delay_line_t line[ 2 ];
+};
+
+/// a copy of the signal delayed by a few milliseconds and swept by an lfo,
+/// the right channel a quarter cycle behind the left
+struct chorus_t {
+    float rate;  // Hz
+    float delay; // seconds, centre of the sweep
+    float depth; // seconds either side of the centre
+    float mix;   // 0 bypasses the effect, 0.5 is an even blend
+
+    lfo_state_t lfo[ 2 ];
+    int active;
+
+    delay_line_t line[ 2 ];
+};
+
+/// a chorus with a much shorter delay and feedback, the comb filter it
+/// makes sweeps up and down the spectrum
+struct flanger_t {
+    float rate;     // Hz
+    float delay;    // seconds, shortest point of the sweep
+    float depth;    // seconds from the shortest to the longest point
+    float feedback; // -0.95 - 0.95
+    float mix;      // 0 bypasses the effect, 0.5 gives the deepest notches
+
+    lfo_state_t lfo[ 2 ];
+    int active;
+
+    delay_line_t line[ 2 ];
+};
+
+void echo_init( echo_t * e, float sample_rate );
+void echo_free( echo_t * e );
+void echo_process(
+    echo_t * e,
+    float * const * io,
+    int frames,
+    float sample_rate
+);
+
+void chorus_init( chorus_t * c, float sample_rate );
+void chorus_free( chorus_t * c );
+void chorus_process(
+    chorus_t * c,
+    float * const * io,
+    int frames,
+    float sample_rate
+);
+
+void flanger_init( flanger_t * f, float sample_rate );
+void flanger_free( flanger_t * f );
+void flanger_process(
+    flanger_t * f,
+    float * const * io,
+    int frames,
+    float sample_rate
+);
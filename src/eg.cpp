@@ -0,0 +1,104 @@
+#include "eg.hpp"
+
+#include <math.h>
+
+/// a segment that goes from start to limit in the given time by heading for
+/// limit + overshoot (overshoot carries the direction)
+static eg_segment_t make_segment(
+    float start,
+    float limit,
+    float overshoot,
+    float seconds,
+    float sample_rate
+)
+{
+    float target = limit + overshoot;
+
+    // distance to the target at the start and at the end of the segment
+    float to = fabsf( overshoot );
+    float from = fabsf( limit - start ) + to;
+
+    // shorter than a sample, jump straight past the limit
+    float samples = seconds * sample_rate;
+    if ( samples < 1.0f ) samples = 1.0f;
+
+    eg_segment_t s;
+    // nothing to travel (decay to a full sustain), end on the next sample
+    s.coef = from > to ? expf( -logf( from / to ) / samples ) : 0.0f;
+    s.target = target;
+    s.limit = limit;
+    s.dir = overshoot > 0.0f ? 1.0f : -1.0f;
+
+    return s;
+}
+
+eg_coef_t eg_coef(
+    float attack,
+    float decay,
+    float sustain,
+    float release,
+    float sample_rate
+)
+{
+    if ( sustain < 0.0f ) sustain = 0.0f;
+    if ( sustain > 1.0f ) sustain = 1.0f;
+
+    eg_coef_t c;
+    c.attack = make_segment(
+        0.0f,
+        1.0f,
+        EG_ATTACK_OVERSHOOT,
+        attack,
+        sample_rate
+    );
+    c.decay = make_segment(
+        1.0f,
+        sustain,
+        -EG_RELEASE_OVERSHOOT,
+        decay,
+        sample_rate
+    );
+    c.release = make_segment(
+        1.0f,
+        0.0f,
+        -EG_RELEASE_OVERSHOOT,
+        release,
+        sample_rate
+    );
+
+    return c;
+}
+
+void eg_segments(
+    const eg_coef_t & coef,
+    int stage,
+    eg_segment_t * current,
+    eg_segment_t * next
+)
+{
+    // sustain and idle stay where they are
+    const eg_segment_t hold = { 1.0f, 0.0f, 0.0f, 0.0f };
+
+    *current = hold;
+    *next = hold;
+
+    if ( stage == EG_ATTACK ) {
+        *current = coef.attack;
+        *next = coef.decay;
+    }
+    if ( stage == EG_DECAY ) *current = coef.decay;
+    if ( stage == EG_RELEASE ) *current = coef.release;
+}
+
+int eg_advance( int stage, int ends )
+{
+    if ( ends <= 0 ) return stage;
+
+    if ( stage == EG_RELEASE ) return EG_IDLE;
+    if ( stage == EG_ATTACK || stage == EG_DECAY ) {
+        stage += ends;
+        return stage > EG_SUSTAIN ? EG_SUSTAIN : stage;
+    }
+
+    return stage;
+}
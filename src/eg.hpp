@@ -0,0 +1,57 @@
+#pragma once
+
+/// how far past its limit each segment aims, relative to full scale; the
+/// attack aims high for the familiar convex analog shape, decay and release
+/// aim just below so the tail is exponential but still ends
+#define EG_ATTACK_OVERSHOOT  0.3f
+#define EG_RELEASE_OVERSHOOT 0.0001f
+
+enum eg_stage_t {
+    EG_IDLE, // silent, the voice can be freed
+    EG_ATTACK,
+    EG_DECAY,
+    EG_SUSTAIN,
+    EG_RELEASE,
+};
+
+/// one exponential segment heading for target: the distance to the target
+/// shrinks by coef every sample, and the segment ends once the output passes
+/// limit in direction dir (+1 rising, -1 falling, 0 never)
+///
+/// keeping the distance instead of the output means one multiply and one add
+/// per sample without rounding error piling up near the target
+struct eg_segment_t {
+    float coef;
+    float target;
+    float limit;
+    float dir;
+};
+
+/// segments for one set of envelope parameters, sustain and idle hold
+/// their level and need no coefficients
+struct eg_coef_t {
+    eg_segment_t attack;
+    eg_segment_t decay;
+    eg_segment_t release;
+};
+
+/// attack is the time from silence to full scale, decay from full scale
+/// to the sustain level and release from full scale to silence, in seconds
+eg_coef_t eg_coef(
+    float attack,
+    float decay,
+    float sustain,
+    float release,
+    float sample_rate
+);
+
+/// the segment a stage runs and the one that follows once it ends
+void eg_segments(
+    const eg_coef_t & coef,
+    int stage,
+    eg_segment_t * current,
+    eg_segment_t * next
+);
+
+/// the stage after ending `ends` segments starting from stage
+int eg_advance( int stage, int ends );
@@ -0,0 +1,518 @@
+#include "fft.hpp"
+
+#include "logging.hpp"
+
+#include <math.h>
+#include <string.h>
+
+#ifndef M_PI
+#define M_PI ( 3.14159265 )
+#endif
+
+static bool is_power_of_two( int n )
+{
+    return n > 0 && !( n & ( n - 1 ) );
+}
+
+/// exp( -2 pi j k / size ) for k < count, real parts then imaginary parts
+static float * make_twiddles( int size, int count )
+{
+    float * w = new float[ 2 * count ];
+
+    for ( int k = 0; k < count; k++ ) {
+        double angle = -2.0 * M_PI * k / size;
+        w[ k ] = (float) cos( angle );
+        w[ count + k ] = (float) sin( angle );
+    }
+
+    return w;
+}
+
+int fft_plan_init( fft_plan_t * p, int size )
+{
+    memset( p, 0, sizeof( *p ) );
+
+    if ( size < FFT_MIN_SIZE || size > FFT_MAX_SIZE ||
+         !is_power_of_two( size ) ) {
+        ERROR_LOG( "no fft of %d points", size );
+        return 1;
+    }
+
+    p->size = size;
+    p->twiddle = make_twiddles( size, size );
+    p->work = new float[ 2 * size ];
+
+    // w1 w2 w3 of butterfly k are the twiddles k, 2 k and 3 k
+    const int quarter = size / 4;
+    p->first = new float[ 6 * quarter ];
+
+    for ( int m = 0; m < 3; m++ ) {
+        float * re = p->first + 2 * m * quarter;
+        float * im = re + quarter;
+
+        for ( int k = 0; k < quarter; k++ ) {
+            re[ k ] = p->twiddle[ ( m + 1 ) * k ];
+            im[ k ] = p->twiddle[ size + ( m + 1 ) * k ];
+        }
+    }
+
+    return 0;
+}
+
+void fft_plan_free( fft_plan_t * p )
+{
+    delete[] p->twiddle;
+    delete[] p->first;
+    delete[] p->work;
+    memset( p, 0, sizeof( *p ) );
+}
+
+/// r + j i = ( ar + j ai ) ( br + j bi )
+static inline void complex_mul(
+    f32x4 ar,
+    f32x4 ai,
+    f32x4 br,
+    f32x4 bi,
+    f32x4 & r,
+    f32x4 & i
+)
+{
+    r = ar * br - ai * bi;
+    i = ar * bi + ai * br;
+}
+
+/// a radix 4 butterfly on the points a b c d, a quarter of the length
+/// apart; y0 - y3 still need their twiddles
+///
+/// y0 = a + b + c + d       y1 = ( a - c ) - j ( b - d )
+/// y2 = a - b + c - d       y3 = ( a - c ) + j ( b - d )
+#define FFT_BUTTERFLY                                                          \
+    f32x4 apc_r = a_r + c_r, apc_i = a_i + c_i;                                \
+    f32x4 amc_r = a_r - c_r, amc_i = a_i - c_i;                                \
+    f32x4 bpd_r = b_r + d_r, bpd_i = b_i + d_i;                                \
+    f32x4 bmd_r = b_r - d_r, bmd_i = b_i - d_i;                                \
+                                                                               \
+    f32x4 y0_r = apc_r + bpd_r, y0_i = apc_i + bpd_i;                          \
+    f32x4 y1_r = amc_r + bmd_i, y1_i = amc_i - bmd_r;                          \
+    f32x4 y2_r = apc_r - bpd_r, y2_i = apc_i - bpd_i;                          \
+    f32x4 y3_r = amc_r - bmd_i, y3_i = amc_i + bmd_r;
+
+/// the first stage, stride 1: four butterflies side by side, each with its
+/// own twiddles; the four outputs of a butterfly are consecutive, so a
+/// transpose turns the results into the vectors to store
+static void first_stage(
+    const fft_plan_t * p,
+    const float * xr,
+    const float * xi,
+    float * yr,
+    float * yi
+)
+{
+    const int q = p->size / 4;
+    const float * w = p->first;
+
+    for ( int k = 0; k < q; k += SIMD_LANES ) {
+        f32x4 a_r = f32x4_loadu( xr + k ), a_i = f32x4_loadu( xi + k );
+        f32x4 b_r = f32x4_loadu( xr + k + q ), b_i = f32x4_loadu( xi + k + q );
+        f32x4 c_r = f32x4_loadu( xr + k + 2 * q );
+        f32x4 c_i = f32x4_loadu( xi + k + 2 * q );
+        f32x4 d_r = f32x4_loadu( xr + k + 3 * q );
+        f32x4 d_i = f32x4_loadu( xi + k + 3 * q );
+
+        FFT_BUTTERFLY
+
+        complex_mul(
+            y1_r,
+            y1_i,
+            f32x4_loadu( w + k ),
+            f32x4_loadu( w + q + k ),
+            y1_r,
+            y1_i
+        );
+        complex_mul(
+            y2_r,
+            y2_i,
+            f32x4_loadu( w + 2 * q + k ),
+            f32x4_loadu( w + 3 * q + k ),
+            y2_r,
+            y2_i
+        );
+        complex_mul(
+            y3_r,
+            y3_i,
+            f32x4_loadu( w + 4 * q + k ),
+            f32x4_loadu( w + 5 * q + k ),
+            y3_r,
+            y3_i
+        );
+
+        f32x4_transpose( y0_r, y1_r, y2_r, y3_r );
+        f32x4_transpose( y0_i, y1_i, y2_i, y3_i );
+
+        float * zr = yr + 4 * k;
+        float * zi = yi + 4 * k;
+        f32x4_storeu( zr, y0_r );
+        f32x4_storeu( zr + 4, y1_r );
+        f32x4_storeu( zr + 8, y2_r );
+        f32x4_storeu( zr + 12, y3_r );
+        f32x4_storeu( zi, y0_i );
+        f32x4_storeu( zi + 4, y1_i );
+        f32x4_storeu( zi + 8, y2_i );
+        f32x4_storeu( zi + 12, y3_i );
+    }
+}
+
+/// a later radix 4 stage over sub-transforms of len points, interleaved
+/// with stride s; the s points of one butterfly position share a twiddle,
+/// so four of them run side by side
+static void radix4_stage(
+    const fft_plan_t * p,
+    int len,
+    int s,
+    const float * xr,
+    const float * xi,
+    float * yr,
+    float * yi
+)
+{
+    const int q = len / 4;
+    const float * tw_r = p->twiddle;
+    const float * tw_i = p->twiddle + p->size;
+
+    for ( int k = 0; k < q; k++ ) {
+        const f32x4 w1_r = f32x4_set1( tw_r[ k * s ] );
+        const f32x4 w1_i = f32x4_set1( tw_i[ k * s ] );
+        const f32x4 w2_r = f32x4_set1( tw_r[ 2 * k * s ] );
+        const f32x4 w2_i = f32x4_set1( tw_i[ 2 * k * s ] );
+        const f32x4 w3_r = f32x4_set1( tw_r[ 3 * k * s ] );
+        const f32x4 w3_i = f32x4_set1( tw_i[ 3 * k * s ] );
+
+        const int in = s * k;
+        const int out = s * 4 * k;
+
+        for ( int j = 0; j < s; j += SIMD_LANES ) {
+            const int a = in + j;
+            f32x4 a_r = f32x4_loadu( xr + a );
+            f32x4 a_i = f32x4_loadu( xi + a );
+            f32x4 b_r = f32x4_loadu( xr + a + s * q );
+            f32x4 b_i = f32x4_loadu( xi + a + s * q );
+            f32x4 c_r = f32x4_loadu( xr + a + 2 * s * q );
+            f32x4 c_i = f32x4_loadu( xi + a + 2 * s * q );
+            f32x4 d_r = f32x4_loadu( xr + a + 3 * s * q );
+            f32x4 d_i = f32x4_loadu( xi + a + 3 * s * q );
+
+            FFT_BUTTERFLY
+
+            complex_mul( y1_r, y1_i, w1_r, w1_i, y1_r, y1_i );
+            complex_mul( y2_r, y2_i, w2_r, w2_i, y2_r, y2_i );
+            complex_mul( y3_r, y3_i, w3_r, w3_i, y3_r, y3_i );
+
+            const int y = out + j;
+            f32x4_storeu( yr + y, y0_r );
+            f32x4_storeu( yi + y, y0_i );
+            f32x4_storeu( yr + y + s, y1_r );
+            f32x4_storeu( yi + y + s, y1_i );
+            f32x4_storeu( yr + y + 2 * s, y2_r );
+            f32x4_storeu( yi + y + 2 * s, y2_i );
+            f32x4_storeu( yr + y + 3 * s, y3_r );
+            f32x4_storeu( yi + y + 3 * s, y3_i );
+        }
+    }
+}
+
+/// the last stage of an odd power of two, 2 point transforms with stride s;
+/// x and y may be the same arrays
+static void radix2_stage(
+    int s,
+    const float * xr,
+    const float * xi,
+    float * yr,
+    float * yi
+)
+{
+    for ( int j = 0; j < s; j += SIMD_LANES ) {
+        f32x4 a_r = f32x4_loadu( xr + j ), a_i = f32x4_loadu( xi + j );
+        f32x4 b_r = f32x4_loadu( xr + j + s ), b_i = f32x4_loadu( xi + j + s );
+
+        f32x4_storeu( yr + j, a_r + b_r );
+        f32x4_storeu( yi + j, a_i + b_i );
+        f32x4_storeu( yr + j + s, a_r - b_r );
+        f32x4_storeu( yi + j + s, a_i - b_i );
+    }
+}
+
+void fft_forward( fft_plan_t * p, float * re, float * im )
+{
+    const int n = p->size;
+
+    const float * xr = re;
+    const float * xi = im;
+    float * yr = p->work;
+    float * yi = p->work + n;
+
+    // every stage reads one buffer and writes the other
+    first_stage( p, xr, xi, yr, yi );
+
+    int len = n / 4;
+    int s = 4;
+    for ( ;; ) {
+        float * out_r = yr == re ? p->work : re;
+        float * out_i = yr == re ? p->work + n : im;
+        xr = yr;
+        xi = yi;
+        yr = out_r;
+        yi = out_i;
+
+        if ( len < 4 ) break;
+
+        radix4_stage( p, len, s, xr, xi, yr, yi );
+        len /= 4;
+        s *= 4;
+    }
+
+    if ( len == 2 ) {
+        radix2_stage( s, xr, xi, re, im );
+    } else if ( xr != re ) {
+        memcpy( re, xr, sizeof( float ) * n );
+        memcpy( im, xi, sizeof( float ) * n );
+    }
+}
+
+void fft_inverse( fft_plan_t * p, float * re, float * im )
+{
+    // swapping the real and imaginary parts on the way in and out turns
+    // the forward transform into the inverse one
+    fft_forward( p, im, re );
+}
+
+int fft_real_plan_init( fft_real_plan_t * p, int size )
+{
+    memset( p, 0, sizeof( *p ) );
+
+    if ( fft_plan_init( &p->half, size / 2 ) ) return 1;
+
+    p->size = size;
+    p->twiddle = make_twiddles( size, size / 2 );
+    p->z = new float[ size ];
+
+    return 0;
+}
+
+void fft_real_plan_free( fft_real_plan_t * p )
+{
+    fft_plan_free( &p->half );
+    delete[] p->twiddle;
+    delete[] p->z;
+    memset( p, 0, sizeof( *p ) );
+}
+
+/// one bin as a float, or four as an f32x4, the m - k side of a real
+/// spectrum loaded and stored in reverse so its lanes line up with the k side
+static inline void load_bins( float & x, const float * p )
+{
+    x = *p;
+}
+
+static inline void load_bins( f32x4 & x, const float * p )
+{
+    x = f32x4_loadu( p );
+}
+
+static inline void load_reversed( float & x, const float * p )
+{
+    x = *p;
+}
+
+static inline void load_reversed( f32x4 & x, const float * p )
+{
+    x = f32x4_reverse( f32x4_loadu( p ) );
+}
+
+static inline void store_bins( float * p, float x )
+{
+    *p = x;
+}
+
+static inline void store_bins( float * p, f32x4 x )
+{
+    f32x4_storeu( p, x );
+}
+
+static inline void store_reversed( float * p, float x )
+{
+    *p = x;
+}
+
+static inline void store_reversed( float * p, f32x4 x )
+{
+    f32x4_storeu( p, f32x4_reverse( x ) );
+}
+
+/// bins k and l = m - k of a real spectrum from the same bins of z, the
+/// half size transform with the even samples in the real parts and the odd
+/// ones in the imaginary parts
+///
+/// the spectra of the two halves come apart through the symmetry of real
+/// signals, e = ( z[ k ] + z*[ l ] ) / 2 and o = ( z[ k ] - z*[ l ] ) / 2j;
+/// then x[ k ] = e + w^k o, and x[ l ] is the conjugate of e - w^k o
+template < typename T > static inline void split_bins(
+    const fft_real_plan_t * p,
+    float * re,
+    float * im,
+    int k,
+    int l,
+    T half
+)
+{
+    const int m = p->size / 2;
+    T zr_k, zi_k, zr_l, zi_l, wr, wi;
+    load_bins( zr_k, p->z + k );
+    load_bins( zi_k, p->z + m + k );
+    load_reversed( zr_l, p->z + l );
+    load_reversed( zi_l, p->z + m + l );
+    load_bins( wr, p->twiddle + k );
+    load_bins( wi, p->twiddle + m + k );
+
+    T er = half * ( zr_k + zr_l );
+    T ei = half * ( zi_k - zi_l );
+    T or_ = half * ( zi_k + zi_l );
+    T oi = half * ( zr_l - zr_k );
+
+    T tr = wr * or_ - wi * oi;
+    T ti = wr * oi + wi * or_;
+
+    store_bins( re + k, er + tr );
+    store_bins( im + k, ei + ti );
+    store_reversed( re + l, er - tr );
+    store_reversed( im + l, ti - ei );
+}
+
+/// split_bins() backwards, without its factors of 1/2
+template < typename T > static inline void join_bins(
+    fft_real_plan_t * p,
+    const float * re,
+    const float * im,
+    int k,
+    int l
+)
+{
+    const int m = p->size / 2;
+    T re_k, im_k, re_l, im_l, wr, wi;
+    load_bins( re_k, re + k );
+    load_bins( im_k, im + k );
+    load_reversed( re_l, re + l );
+    load_reversed( im_l, im + l );
+    load_bins( wr, p->twiddle + k );
+    load_bins( wi, p->twiddle + m + k );
+
+    T er = re_k + re_l;
+    T ei = im_k - im_l;
+    T dr = re_k - re_l;
+    T di = im_k + im_l;
+
+    // o = d / w^k, and w^k is on the unit circle
+    T or_ = dr * wr + di * wi;
+    T oi = di * wr - dr * wi;
+
+    store_bins( p->z + k, er - oi );
+    store_bins( p->z + m + k, ei + or_ );
+    store_reversed( p->z + l, er + oi );
+    store_reversed( p->z + m + l, or_ - ei );
+}
+
+void fft_real_forward(
+    fft_real_plan_t * p,
+    const float * in,
+    float * re,
+    float * im
+)
+{
+    const int m = p->size / 2;
+    float * zr = p->z;
+    float * zi = p->z + m;
+
+    for ( int i = 0; i < m; i += SIMD_LANES ) {
+        f32x4 even, odd;
+        f32x4_deinterleave(
+            f32x4_loadu( in + 2 * i ),
+            f32x4_loadu( in + 2 * i + SIMD_LANES ),
+            even,
+            odd
+        );
+        f32x4_storeu( zr + i, even );
+        f32x4_storeu( zi + i, odd );
+    }
+
+    fft_forward( &p->half, zr, zi );
+
+    re[ 0 ] = zr[ 0 ] + zi[ 0 ];
+    im[ 0 ] = zr[ 0 ] - zi[ 0 ];
+
+    // four pairs at a time while the k and the m - k vectors stay apart
+    int k = 1;
+    for ( ; k + SIMD_LANES <= m / 2; k += SIMD_LANES ) {
+        int l = m - k - ( SIMD_LANES - 1 );
+        split_bins( p, re, im, k, l, f32x4_set1( 0.5f ) );
+    }
+    for ( ; k <= m / 2; k++ ) split_bins( p, re, im, k, m - k, 0.5f );
+}
+
+void fft_real_inverse(
+    fft_real_plan_t * p,
+    const float * re,
+    const float * im,
+    float * out
+)
+{
+    const int m = p->size / 2;
+    float * zr = p->z;
+    float * zi = p->z + m;
+
+    zr[ 0 ] = re[ 0 ] + im[ 0 ];
+    zi[ 0 ] = re[ 0 ] - im[ 0 ];
+
+    int k = 1;
+    for ( ; k + SIMD_LANES <= m / 2; k += SIMD_LANES ) {
+        join_bins< f32x4 >( p, re, im, k, m - k - ( SIMD_LANES - 1 ) );
+    }
+    for ( ; k <= m / 2; k++ ) join_bins< float >( p, re, im, k, m - k );
+
+    fft_inverse( &p->half, zr, zi );
+
+    for ( int i = 0; i < m; i += SIMD_LANES ) {
+        f32x4 a, b;
+        f32x4_interleave( f32x4_loadu( zr + i ), f32x4_loadu( zi + i ), a, b );
+        f32x4_storeu( out + 2 * i, a );
+        f32x4_storeu( out + 2 * i + SIMD_LANES, b );
+    }
+}
+
+void fft_spectrum_mac(
+    int bins,
+    float * acc_re,
+    float * acc_im,
+    const float * x_re,
+    const float * x_im,
+    const float * h_re,
+    const float * h_im
+)
+{
+    // bin 0 holds the dc and nyquist bins, which are real and multiply
+    // separately
+    float dc = acc_re[ 0 ] + x_re[ 0 ] * h_re[ 0 ];
+    float nyquist = acc_im[ 0 ] + x_im[ 0 ] * h_im[ 0 ];
+
+    for ( int k = 0; k < bins; k += SIMD_LANES ) {
+        f32x4 xr = f32x4_loadu( x_re + k ), xi = f32x4_loadu( x_im + k );
+        f32x4 hr = f32x4_loadu( h_re + k ), hi = f32x4_loadu( h_im + k );
+
+        f32x4 r, i;
+        complex_mul( xr, xi, hr, hi, r, i );
+
+        f32x4_storeu( acc_re + k, f32x4_loadu( acc_re + k ) + r );
+        f32x4_storeu( acc_im + k, f32x4_loadu( acc_im + k ) + i );
+    }
+
+    acc_re[ 0 ] = dc;
+    acc_im[ 0 ] = nyquist;
+}
@@ -0,0 +1,85 @@
+#pragma once
+
+#include "simd.hpp"
+
+/// smallest and largest complex transform; a real transform of n samples
+/// runs a complex one of n / 2 points, so it takes 32 - 131072 samples
+#define FFT_MIN_SIZE 16
+#define FFT_MAX_SIZE 65536
+
+/// complex fft of a power of two size, on split real and imaginary arrays
+///
+/// radix 4 stockham stages, with a radix 2 one at the end for odd powers;
+/// every butterfly works on four points at once, the first stage along the
+/// twiddles and the later ones along the stride, so no stage needs a bit
+/// reversal; everything a transform touches is allocated with the plan
+struct fft_plan_t {
+    int size;
+
+    /// exp( -2 pi j k / size ) for k < size, real parts then imaginary parts
+    float * twiddle;
+
+    /// the first stage's three twiddles for every butterfly, laid out so
+    /// four butterflies load them as vectors
+    float * first;
+
+    /// the stages alternate between the data and this, 2 * size floats
+    float * work;
+};
+
+/// 0 on success, 1 for a size out of range or not a power of two
+int fft_plan_init( fft_plan_t * p, int size );
+
+void fft_plan_free( fft_plan_t * p );
+
+/// in place and unscaled, so a forward and an inverse transform multiply by
+/// size; one transform at a time per plan
+void fft_forward( fft_plan_t * p, float * re, float * im );
+void fft_inverse( fft_plan_t * p, float * re, float * im );
+
+/// fft of size real samples, done as a complex one of size / 2 points
+///
+/// the spectrum is packed into size / 2 bins: re[ 0 ] is dc and im[ 0 ] the
+/// nyquist bin, both real, the rest are the bins in between; the bins above
+/// nyquist mirror them and are not stored
+struct fft_real_plan_t {
+    int size;
+    fft_plan_t half;
+
+    /// exp( -2 pi j k / size ) for k < size / 2, real then imaginary parts
+    float * twiddle;
+
+    /// the half size complex signal, 2 * size / 2 floats
+    float * z;
+};
+
+int fft_real_plan_init( fft_real_plan_t * p, int size );
+
+void fft_real_plan_free( fft_real_plan_t * p );
+
+/// unscaled like fft_forward(), in is not changed
+void fft_real_forward(
+    fft_real_plan_t * p,
+    const float * in,
+    float * re,
+    float * im
+);
+
+/// the inverse of fft_real_forward() times size, re and im are not changed
+void fft_real_inverse(
+    fft_real_plan_t * p,
+    const float * re,
+    const float * im,
+    float * out
+);
+
+/// adds x times h to acc, bin by bin, for packed real spectra of bins bins
+void fft_spectrum_mac(
+    int bins,
+    float * acc_re,
+    float * acc_im,
+    const float * x_re,
+    const float * x_im,
+    const float * h_re,
+    const float * h_im
+);
@@ -0,0 +1,204 @@
+#include "limiter.hpp"
+
+#include <math.h>
+#include <string.h>
+
+/// the soft clipper is t - 4 / 27 t^3 of the sample over the ceiling, which
+/// reaches 1 with a flat top at 1.5 times the ceiling
+#define CLIP_RANGE 1.5f
+#define CLIP_CUBE  ( 4.0f / 27.0f )
+
+void limiter_init( limiter_t * l, float lookahead, float sample_rate )
+{
+    l->ceiling = 0.966f; // -0.3 dBFS, room for the device's own filters
+    l->release = 0.05f;
+    l->soft_clip = false;
+
+    l->lookahead = (int) ( lookahead * sample_rate + 0.5f );
+    if ( l->lookahead < 0 ) l->lookahead = 0;
+    if ( l->lookahead > LIMITER_MAX_LOOKAHEAD ) {
+        l->lookahead = LIMITER_MAX_LOOKAHEAD;
+    }
+
+    l->lowest_gain = 1.0f;
+    l->coef_release = 0.0f;
+    l->release_coef = 0.0f;
+
+    l->envelope = 1.0f;
+    l->average_sum = l->lookahead + 1;
+
+    memset( l->input, 0, sizeof( l->input ) );
+    memset( l->runs, 0, sizeof( l->runs ) );
+    for ( int i = 0; i < LIMITER_HISTORY + LIMITER_BLOCK + SIMD_LANES; i++ ) {
+        l->wanted[ i ] = 1.0f;
+    }
+    for ( int i = 0; i < LIMITER_HISTORY + LIMITER_BLOCK; i++ ) {
+        l->released[ i ] = 1.0f;
+    }
+}
+
+/// the lowest wanted gain over the lookahead + 1 frames up to each frame of
+/// the block; a sparse table, every level halving the runs it has to cover
+static void limiter_hold( limiter_t * l, int frames, float * hold )
+{
+    const int H = LIMITER_HISTORY;
+    const int window = l->lookahead + 1;
+    const int first = ( H - l->lookahead ) & ~( SIMD_LANES - 1 );
+
+    // minimums of runs of width, for every start up to the last full run
+    const float * runs = l->wanted;
+    int width = 1;
+    for ( int level = 0; width * 2 <= window; level++ ) {
+        float * next = l->runs[ level & 1 ];
+        const int end = H + frames - width * 2 + 1;
+
+        for ( int j = first; j < end; j += SIMD_LANES ) {
+            f32x4 a = f32x4_load( runs + j );
+            f32x4 b = f32x4_loadu( runs + j + width );
+            f32x4_store( next + j, f32x4_min( a, b ) );
+        }
+
+        runs = next;
+        width *= 2;
+    }
+
+    // two runs overlapping across the window cover it exactly
+    for ( int i = 0; i < frames; i += SIMD_LANES ) {
+        const float * a = runs + H + i - l->lookahead;
+        f32x4 m = f32x4_loadu( a );
+        m = f32x4_min( m, f32x4_loadu( a + window - width ) );
+        f32x4_store( hold + i, m );
+    }
+}
+
+static void limiter_block( limiter_t * l, float * frames_lr, int frames )
+{
+    const int H = LIMITER_HISTORY;
+    const int window = l->lookahead + 1;
+
+    SIMD_ALIGN float hold[ LIMITER_BLOCK + SIMD_LANES ];
+    SIMD_ALIGN float gain[ LIMITER_BLOCK + SIMD_LANES ];
+    SIMD_ALIGN float out[ 2 ][ LIMITER_BLOCK + SIMD_LANES ];
+
+    float * const left = l->input[ 0 ] + H;
+    float * const right = l->input[ 1 ] + H;
+
+    int i = 0;
+    for ( ; i + SIMD_LANES <= frames; i += SIMD_LANES ) {
+        f32x4 a = f32x4_loadu( frames_lr + 2 * i );
+        f32x4 b = f32x4_loadu( frames_lr + 2 * i + SIMD_LANES );
+        f32x4 x, y;
+        f32x4_deinterleave( a, b, x, y );
+        f32x4_store( left + i, x );
+        f32x4_store( right + i, y );
+    }
+    for ( ; i < frames; i++ ) {
+        left[ i ] = frames_lr[ 2 * i ];
+        right[ i ] = frames_lr[ 2 * i + 1 ];
+    }
+
+    // the gain that brings the louder side down to the threshold, 1 below
+    // it; the lanes past the block read stale samples and are never used
+    const float threshold = l->ceiling * ( l->soft_clip ? CLIP_RANGE : 1.0f );
+    const f32x4 threshold4 = f32x4_set1( threshold );
+    const f32x4 zero = f32x4_set1( 0.0f );
+
+    for ( i = 0; i < frames; i += SIMD_LANES ) {
+        f32x4 x = f32x4_load( left + i );
+        f32x4 y = f32x4_load( right + i );
+        f32x4 peak = f32x4_max(
+            f32x4_max( x, zero - x ),
+            f32x4_max( y, zero - y )
+        );
+        f32x4 wanted = threshold4 / f32x4_max( peak, threshold4 );
+        f32x4_store( l->wanted + H + i, wanted );
+    }
+
+    limiter_hold( l, frames, hold );
+
+    // the release follows every frame from the last, so it stays scalar
+    const float coef = l->release_coef;
+    const double scale = 1.0 / window;
+    float envelope = l->envelope;
+    double sum = l->average_sum;
+    float lowest = l->lowest_gain;
+
+    for ( i = 0; i < frames; i++ ) {
+        envelope = fminf( hold[ i ], 1.0f - ( 1.0f - envelope ) * coef );
+        l->released[ H + i ] = envelope;
+        sum += envelope - l->released[ H + i - window ];
+        gain[ i ] = (float) ( sum * scale );
+        lowest = fminf( lowest, gain[ i ] );
+    }
+
+    l->envelope = envelope;
+    l->average_sum = sum;
+    l->lowest_gain = lowest;
+
+    // the soft clip and the final clamp are both branch free; the clamp only
+    // catches rounding in the running average
+    const f32x4 ceiling = f32x4_set1( l->ceiling );
+    const f32x4 bottom = zero - ceiling;
+    const f32x4 range = f32x4_set1( CLIP_RANGE );
+    const f32x4 over = f32x4_set1( 1.0f / l->ceiling );
+    const f32x4 cube = f32x4_set1( CLIP_CUBE );
+    const f32x4 one = f32x4_set1( 1.0f );
+
+    for ( int c = 0; c < 2; c++ ) {
+        const float * x = l->input[ c ] + H - l->lookahead;
+        for ( i = 0; i < frames; i += SIMD_LANES ) {
+            f32x4 y = f32x4_loadu( x + i ) * f32x4_load( gain + i );
+            if ( l->soft_clip ) {
+                f32x4 t = y * over;
+                t = f32x4_min( f32x4_max( t, zero - range ), range );
+                y = ceiling * t * ( one - cube * t * t );
+            }
+            y = f32x4_min( f32x4_max( y, bottom ), ceiling );
+            f32x4_store( out[ c ] + i, y );
+        }
+    }
+
+    for ( i = 0; i + SIMD_LANES <= frames; i += SIMD_LANES ) {
+        f32x4 a, b;
+        f32x4_interleave(
+            f32x4_load( out[ 0 ] + i ),
+            f32x4_load( out[ 1 ] + i ),
+            a,
+            b
+        );
+        f32x4_storeu( frames_lr + 2 * i, a );
+        f32x4_storeu( frames_lr + 2 * i + SIMD_LANES, b );
+    }
+    for ( ; i < frames; i++ ) {
+        frames_lr[ 2 * i ] = out[ 0 ][ i ];
+        frames_lr[ 2 * i + 1 ] = out[ 1 ][ i ];
+    }
+
+    for ( int c = 0; c < 2; c++ ) {
+        memmove( l->input[ c ], l->input[ c ] + frames, sizeof( float ) * H );
+    }
+    memmove( l->wanted, l->wanted + frames, sizeof( float ) * H );
+    memmove( l->released, l->released + frames, sizeof( float ) * H );
+}
+
+void limiter_process(
+    limiter_t * l,
+    float * frames_lr,
+    int frames,
+    float sample_rate
+)
+{
+    if ( l->release != l->coef_release ) {
+        l->coef_release = l->release;
+        l->release_coef = l->release > 0.0f
+                              ? expf( -1.0f / ( l->release * sample_rate ) )
+                              : 0.0f;
+    }
+
+    l->lowest_gain = 1.0f;
+
+    for ( int done = 0; done < frames; done += LIMITER_BLOCK ) {
+        int n = frames - done < LIMITER_BLOCK ? frames - done : LIMITER_BLOCK;
+        limiter_block( l, frames_lr + 2 * done, n );
+    }
+}
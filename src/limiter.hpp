@@ -0,0 +1,67 @@
+#pragma once
+
+#include "simd.hpp"
+
+/// lookahead of the output limiter, in seconds
+#define LIMITER_LOOKAHEAD 0.0015f
+
+/// longest lookahead in frames, 5.8 ms at 44.1 kHz
+#define LIMITER_MAX_LOOKAHEAD 255
+
+/// frames processed at once, longer calls are split up
+#define LIMITER_BLOCK 64
+
+/// frames kept from earlier blocks, one longest lookahead window
+#define LIMITER_HISTORY ( LIMITER_MAX_LOOKAHEAD + 1 )
+
+/// stereo linked lookahead peak limiter, the last stage before the device
+///
+/// every frame asks for the gain that brings its peak down to the ceiling;
+/// the gain applied is the lowest asked for over the lookahead window, with
+/// a release, then averaged over the same window, so it has ramped all the
+/// way down by the time the peak comes out of the delay
+///
+/// the soft clipper rounds the waveform off towards the ceiling instead, for
+/// peaks up to half again above it, and the limiter only turns the gain down
+/// for louder ones; it also bends the top of the waveform below the ceiling
+/// a little
+struct limiter_t {
+    float ceiling; // highest output sample, linear
+    float release; // seconds, time constant of the gain recovering
+    bool soft_clip;
+
+    /// frames the output is delayed by, set by limiter_init() since a change
+    /// would glitch
+    int lookahead;
+
+    /// lowest gain the last limiter_process() call applied
+    float lowest_gain;
+
+    /// release the coefficient was computed for
+    float coef_release;
+    float release_coef;
+
+    /// gain after the release, and the sum of the last lookahead + 1 of them
+    float envelope;
+    double average_sum;
+
+    /// oldest first, the current block starts at LIMITER_HISTORY
+    SIMD_ALIGN float input[ 2 ][ LIMITER_HISTORY + LIMITER_BLOCK + SIMD_LANES ];
+    SIMD_ALIGN float wanted[ LIMITER_HISTORY + LIMITER_BLOCK + SIMD_LANES ];
+    SIMD_ALIGN float released[ LIMITER_HISTORY + LIMITER_BLOCK ];
+
+    /// minimums over power of two runs of wanted, built up every block
+    SIMD_ALIGN float runs[ 2 ][ LIMITER_HISTORY + LIMITER_BLOCK + SIMD_LANES ];
+};
+
+/// lookahead is in seconds, at most LIMITER_MAX_LOOKAHEAD frames
+void limiter_init( limiter_t * l, float lookahead, float sample_rate );
+
+/// limits interleaved stereo frames in place, the output is lookahead frames
+/// behind the input
+void limiter_process(
+    limiter_t * l,
+    float * frames_lr,
+    int frames,
+    float sample_rate
+);
@@ -1,21 +1,113 @@
 #include "audio.hpp"
 #include "hardware.hpp"
 #include "logging.hpp"
+#include "offline.hpp"
 #include "render.hpp"
+#include "scope.hpp"
 #include "state.hpp"
+#include "synth.hpp"
 
 #include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
 
 #include <portmidi.h>
 #include <porttime.h>
 
+#include <atomic>
+
 #define MIDI_CODE_MASK 0xf0
 #define MIDI_CHN_MASK  0x0f
 
+/// events taken from portmidi per read
+#define MIDI_BATCH_SIZE 64
+
+/// samples shown by the scope, it searches twice as many for a trigger
+#define SCOPE_WINDOW 1024
+
 static struct {
     PmStream * midi_in;
+
+    /// set once the input is open and flushed, the midi thread only reads
+    /// while this is set
+    std::atomic< int > midi_active;
+
+    /// input to enqueue latency in milliseconds, written by the midi thread
+    std::atomic< int > latency_last;
+    std::atomic< int > latency_max;
+    std::atomic< int > latency_count;
+    std::atomic< long long > latency_sum;
 } intern;
 
+static void forward_event( const PmEvent & event )
+{
+    int cmd = Pm_MessageStatus( event.message ) & MIDI_CODE_MASK;
+    int data1 = Pm_MessageData1( event.message );
+    int data2 = Pm_MessageData2( event.message );
+
+    // note on with zero velocity is a note off
+    if ( cmd == 0x90 && data2 > 0 ) {
+        audio_start_midi( data1, event.timestamp );
+    }
+    if ( cmd == 0x80 || ( cmd == 0x90 && data2 == 0 ) ) {
+        audio_stop_midi( data1, event.timestamp );
+    }
+
+    if ( cmd == 0xb0 ) {
+        audio_send_control( data1, data2, event.timestamp );
+    }
+
+    if ( cmd == 0xc0 ) {
+        audio_send_program( data1, event.timestamp );
+    }
+
+    if ( cmd == 0xe0 ) {
+        audio_send_bend( data1 | ( data2 << 7 ), event.timestamp );
+    }
+}
+
+static void record_latency( int latency )
+{
+    intern.latency_last.store( latency, std::memory_order_relaxed );
+    if ( latency > intern.latency_max.load( std::memory_order_relaxed ) ) {
+        intern.latency_max.store( latency, std::memory_order_relaxed );
+    }
+    intern.latency_sum.fetch_add( latency, std::memory_order_relaxed );
+    intern.latency_count.fetch_add( 1, std::memory_order_relaxed );
+}
+
+/// porttime timer callback, runs every millisecond on the porttime thread
+/// and forwards midi input straight into the audio command queue
+static void midi_thread( PtTimestamp, void * )
+{
+    if ( !intern.midi_active.load( std::memory_order_acquire ) ) return;
+
+    PmEvent events[ MIDI_BATCH_SIZE ];
+
+    for ( ;; ) {
+        int count = Pm_Read( intern.midi_in, events, MIDI_BATCH_SIZE );
+        if ( count <= 0 ) break;
+
+        for ( int i = 0; i < count; i++ ) {
+            forward_event( events[ i ] );
+        }
+
+        PtTimestamp now = Pt_Time();
+        for ( int i = 0; i < count; i++ ) {
+            record_latency( now - events[ i ].timestamp );
+
+            int cmd = Pm_MessageStatus( events[ i ].message ) & MIDI_CODE_MASK;
+            int chan = Pm_MessageStatus( events[ i ].message ) & MIDI_CHN_MASK;
+            int data1 = Pm_MessageData1( events[ i ].message );
+            int data2 = Pm_MessageData2( events[ i ].message );
+            DEBUG_LOG( "[chan %x : %2x] : %2x %2x", chan, cmd, data1, data2 );
+        }
+
+        if ( count < MIDI_BATCH_SIZE ) break;
+    }
+}
+
 static void init_midi()
 {
     int last_input;
@@ -27,7 +119,7 @@ static void init_midi()
         }
     }
 
-    Pt_Start( 1, 0, 0 );
+    Pt_Start( 1, midi_thread, nullptr );
     PmError err = Pm_OpenInput(
         &intern.midi_in,
         last_input,
@@ -39,6 +131,7 @@ static void init_midi()
 
     if ( err ) {
         ERROR_LOG( "%s", Pm_GetErrorText( err ) );
+        return;
     }
 
     // Pm_SetFilter( intern.midi_in, PM_FILT_NOTE );
@@ -46,11 +139,45 @@ static void init_midi()
     while ( Pm_Poll( intern.midi_in ) ) {
         Pm_Read( intern.midi_in, &event, 1 );
     }
+
+    intern.midi_active.store( 1, std::memory_order_release );
 }
 
 static void destroy_midi()
 {
-    Pm_Close( intern.midi_in );
+    int active = intern.midi_active.exchange( 0 );
+    Pt_Stop();
+
+    int count = intern.latency_count.load();
+    if ( count ) {
+        DEBUG_LOG(
+            "midi input to enqueue latency over %d events: avg %.2f max %d ms",
+            count,
+            (double) intern.latency_sum.load() / count,
+            intern.latency_max.load()
+        );
+    }
+
+    if ( active ) Pm_Close( intern.midi_in );
+}
+
+/// applies a "<name>=<value>" setting from the command line
+static void set_param( const char * setting )
+{
+    char name[ 32 ];
+    float value;
+    int param = -1;
+
+    if ( sscanf( setting, "%31[^=]=%f", name, &value ) == 2 ) {
+        param = synth_param_find( name );
+    }
+
+    if ( param < 0 ) {
+        ERROR_LOG( "bad setting '%s', expected <name>=<value>", setting );
+        return;
+    }
+
+    audio_set_param( param, value );
 }
 
 static void loop()
@@ -60,67 +187,197 @@ static void loop()
     int midi = hardware_number() + 69;
 
     if ( midi != last_midi ) {
-        if ( midi == 69 ) {
-            audio_stop_midi();
-        } else {
-            audio_start_midi( midi );
-        }
+        if ( last_midi != 69 ) audio_stop_midi( last_midi, Pt_Time() );
+        if ( midi != 69 ) audio_start_midi( midi, Pt_Time() );
 
         last_midi = midi;
     }
 
-    static int pressed_note_count = 0;
+    audio_tick();
+    audio_telemetry_t telemetry;
+    audio_get_telemetry( &telemetry );
 
-    PmEvent event;
-    if ( Pm_Read( intern.midi_in, &event, 1 ) ) {
-        int cmd = Pm_MessageStatus( event.message ) & MIDI_CODE_MASK;
-        int chan = Pm_MessageStatus( event.message ) & MIDI_CHN_MASK;
-        int data1 = Pm_MessageData1( event.message );
-        int data2 = Pm_MessageData2( event.message );
-        INFO_LOG( "[chan %x : %2x] : %2x %2x", chan, cmd, data1, data2 );
-
-        if ( cmd == 0x90 ) {
-            pressed_note_count++;
-            audio_start_midi( data1 );
-        }
-        if ( cmd == 0x80 ) {
-            pressed_note_count--;
-            if ( pressed_note_count == 0 ) audio_stop_midi();
-        }
+    static float scope[ SCOPE_WINDOW * 2 ];
+    int count = audio_read_scope( scope, SCOPE_WINDOW * 2 );
+    int start = scope_trigger( scope, count, SCOPE_WINDOW );
+    int shown = count - start < SCOPE_WINDOW ? count - start : SCOPE_WINDOW;
 
-        if ( cmd == 0xb0 ) {
-            audio_send_control( data2 );
-        }
+    // the spectrum of everything read, under the waveform
+    static scope_spectrum_t spectrum;
+    static bool spectrum_ready = !scope_spectrum_init( &spectrum );
+    if ( spectrum_ready ) {
+        scope_spectrum_update( &spectrum, scope, count, SAMPLE_RATE );
     }
 
-    audio_tick();
-    render( audio_visual_1() );
+    render_trace_t traces[ 2 ] = {
+        {
+            scope + start,
+            shown,
+            0.4f,
+            0.5f,
+            { 0.4f, 1.0f, 0.6f, 1.0f },
+        },
+        {
+            spectrum.points,
+            SCOPE_SPECTRUM_POINTS,
+            -0.95f,
+            0.8f,
+            { 1.0f, 0.7f, 0.3f, 1.0f },
+        },
+    };
+
+    render( telemetry.eg_level, traces, spectrum_ready ? 2 : 1 );
 }
 
 #if defined( _WIN32 ) and RELEASE
 int WinMain()
 #else
-int main()
+int main( int argc, char ** argv )
 #endif
 {
+#if defined( _WIN32 ) and RELEASE
+    int argc = __argc;
+    char ** argv = __argv;
+#endif
+
     state.freq = 440.0f;
     INFO_LOG( "meow" );
 
-    init_midi();
+    // app --render <events.mid|events.txt> <out.wav> [ir.wav]
+    if ( argc > 1 && !strcmp( argv[ 1 ], "--render" ) ) {
+        if ( argc != 4 && argc != 5 ) {
+            ERROR_LOG(
+                "usage: %s --render <input> <output.wav> [ir.wav]",
+                argv[ 0 ]
+            );
+            return 1;
+        }
+
+        return offline_render( argv[ 2 ], argv[ 3 ], argv[ 4 ] );
+    }
+
+    // app --check-convolver [ir.wav]
+    if ( argc > 1 && !strcmp( argv[ 1 ], "--check-convolver" ) ) {
+        return offline_check_convolver( argc > 2 ? argv[ 2 ] : nullptr );
+    }
+
+    // app --check-fft
+    if ( argc > 1 && !strcmp( argv[ 1 ], "--check-fft" ) ) {
+        return offline_check_fft();
+    }
+
+    // app --check-limiter
+    if ( argc > 1 && !strcmp( argv[ 1 ], "--check-limiter" ) ) {
+        return offline_check_limiter();
+    }
+
+    // app --check-blep
+    if ( argc > 1 && !strcmp( argv[ 1 ], "--check-blep" ) ) {
+        return offline_check_blep();
+    }
+
+    // app --check-delay
+    if ( argc > 1 && !strcmp( argv[ 1 ], "--check-delay" ) ) {
+        return offline_check_delay();
+    }
+
+    // app --check-eg
+    if ( argc > 1 && !strcmp( argv[ 1 ], "--check-eg" ) ) {
+        return offline_check_eg();
+    }
+
+    // app --check-fade
+    if ( argc > 1 && !strcmp( argv[ 1 ], "--check-fade" ) ) {
+        return offline_check_fade();
+    }
+
+    // app --check-jitter
+    if ( argc > 1 && !strcmp( argv[ 1 ], "--check-jitter" ) ) {
+        return offline_check_jitter();
+    }
+
+    // app --check-load
+    if ( argc > 1 && !strcmp( argv[ 1 ], "--check-load" ) ) {
+        return offline_check_load();
+    }
+
+    // app --check-mod
+    if ( argc > 1 && !strcmp( argv[ 1 ], "--check-mod" ) ) {
+        return offline_check_mod();
+    }
+
+    // app --check-onsets
+    if ( argc > 1 && !strcmp( argv[ 1 ], "--check-onsets" ) ) {
+        return offline_check_onsets();
+    }
+
+    // app --check-oversample
+    if ( argc > 1 && !strcmp( argv[ 1 ], "--check-oversample" ) ) {
+        return offline_check_oversample();
+    }
+
+    // app --check-pitch
+    if ( argc > 1 && !strcmp( argv[ 1 ], "--check-pitch" ) ) {
+        return offline_check_pitch();
+    }
+
+    // app --check-reverb
+    if ( argc > 1 && !strcmp( argv[ 1 ], "--check-reverb" ) ) {
+        return offline_check_reverb();
+    }
+
+    // app --check-simd [events]
+    if ( argc > 1 && !strcmp( argv[ 1 ], "--check-simd" ) ) {
+        return offline_check_simd( argc > 2 ? argv[ 2 ] : nullptr );
+    }
+
+    // app --check-tuning
+    if ( argc > 1 && !strcmp( argv[ 1 ], "--check-tuning" ) ) {
+        return offline_check_tuning();
+    }
+
+    // app --check-unison
+    if ( argc > 1 && !strcmp( argv[ 1 ], "--check-unison" ) ) {
+        return offline_check_unison();
+    }
+
+    // app --check-vcf
+    if ( argc > 1 && !strcmp( argv[ 1 ], "--check-vcf" ) ) {
+        return offline_check_vcf();
+    }
+
+    // app --check-voices
+    if ( argc > 1 && !strcmp( argv[ 1 ], "--check-voices" ) ) {
+        return offline_check_voices();
+    }
+
+    // app [--ir <ir.wav>] [--set <name>=<value>]...
+    for ( int i = 1; i + 1 < argc; i++ ) {
+        if ( !strcmp( argv[ i ], "--ir" ) ) {
+            audio_set_impulse_response( argv[ ++i ] );
+        }
+    }
 
     hardware_init();
+    render_init();
 
     audio_init();
 
-    audio_stop_midi();
+    for ( int i = 1; i + 1 < argc; i++ ) {
+        if ( !strcmp( argv[ i ], "--set" ) ) set_param( argv[ ++i ] );
+    }
+
+    // midi input goes straight to the audio engine, so it starts after and
+    // stops before it
+    init_midi();
 
     hardware_set_loop( loop );
 
+    destroy_midi();
+
     audio_destroy();
 
     hardware_destroy();
 
-    destroy_midi();
-
     return 0;
 }
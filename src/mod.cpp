@@ -0,0 +1,74 @@
+#include "mod.hpp"
+
+#include <math.h>
+
+#ifndef M_PI
+#define M_PI ( 3.14159265 )
+#endif
+
+void lfo_init( lfo_state_t * lfo, uint32_t seed )
+{
+    lfo->phase = 0.0f;
+    lfo->hold = 0.0f;
+    lfo->random = seed ? seed : 1;
+}
+
+/// xorshift, plenty for sample and hold
+static float next_random( lfo_state_t * lfo )
+{
+    uint32_t x = lfo->random;
+    x ^= x << 13;
+    x ^= x >> 17;
+    x ^= x << 5;
+    lfo->random = x;
+
+    return (float) x * ( 2.0f / 4294967296.0f ) - 1.0f;
+}
+
+float lfo_advance(
+    lfo_state_t * lfo,
+    float rate,
+    int wave,
+    int frames,
+    float sample_rate
+)
+{
+    float phase = lfo->phase + rate * frames / sample_rate;
+    if ( phase >= 1.0f ) {
+        phase -= floorf( phase );
+        lfo->hold = next_random( lfo );
+    }
+    lfo->phase = phase;
+
+    switch ( wave ) {
+    case LFO_TRIANGLE:
+        return 1.0f - 4.0f * fabsf( phase - 0.5f );
+    case LFO_SAW:
+        return 2.0f * phase - 1.0f;
+    case LFO_SQUARE:
+        return phase < 0.5f ? 1.0f : -1.0f;
+    case LFO_SAMPLE_HOLD:
+        return lfo->hold;
+    default:
+        return sinf( 2.0f * (float) M_PI * phase );
+    }
+}
+
+void mod_apply(
+    const mod_slot_t * slots,
+    int slot_count,
+    const float * sources,
+    float * dest
+)
+{
+    for ( int i = 0; i < MOD_DEST_COUNT; i++ ) dest[ i ] = 0.0f;
+
+    for ( int i = 0; i < slot_count; i++ ) {
+        const mod_slot_t & slot = slots[ i ];
+        if ( slot.source <= MOD_SOURCE_NONE ) continue;
+        if ( slot.source >= MOD_SOURCE_COUNT ) continue;
+        if ( slot.dest < 0 || slot.dest >= MOD_DEST_COUNT ) continue;
+
+        dest[ slot.dest ] += slot.amount * sources[ slot.source ];
+    }
+}
@@ -0,0 +1,68 @@
+#pragma once
+
+#include <stdint.h>
+
+/// frames between two modulation updates, everything modulated is ramped
+/// linearly in between
+#ifndef CONTROL_INTERVAL
+#define CONTROL_INTERVAL 32
+#endif
+
+#define LFO_COUNT      2
+#define MOD_SLOT_COUNT 8
+
+enum lfo_wave_t {
+    LFO_SINE,
+    LFO_TRIANGLE,
+    LFO_SAW,
+    LFO_SQUARE,
+    LFO_SAMPLE_HOLD,
+    LFO_WAVE_COUNT,
+};
+
+enum mod_source_t {
+    MOD_SOURCE_NONE,
+    MOD_SOURCE_LFO1,
+    MOD_SOURCE_LFO2,
+    MOD_SOURCE_COUNT,
+};
+
+enum mod_dest_t {
+    MOD_DEST_PITCH,       // semitones
+    MOD_DEST_CUTOFF,      // octaves
+    MOD_DEST_PULSE_WIDTH, // fraction of a cycle
+    MOD_DEST_AMP,         // fraction of full gain
+    MOD_DEST_COUNT,
+};
+
+/// one row of the modulation matrix, adds amount * source to dest
+struct mod_slot_t {
+    int source;
+    int dest;
+    float amount;
+};
+
+struct lfo_state_t {
+    float phase; // 0 - 1
+    float hold;  // current sample and hold value
+    uint32_t random;
+};
+
+void lfo_init( lfo_state_t * lfo, uint32_t seed );
+
+/// advances the lfo by frames and returns its value there, -1 - 1
+float lfo_advance(
+    lfo_state_t * lfo,
+    float rate,
+    int wave,
+    int frames,
+    float sample_rate
+);
+
+/// sums every slot into dest, sources are indexed by mod_source_t
+void mod_apply(
+    const mod_slot_t * slots,
+    int slot_count,
+    const float * sources,
+    float * dest
+);
@@ -0,0 +1,3040 @@
+#include "offline.hpp"
+
+#include "audio.hpp"
+#include "fft.hpp"
+#include "limiter.hpp"
+#include "logging.hpp"
+#include "synth.hpp"
+#include "wav.hpp"
+
+#include <portaudio.h>
+
+#include <math.h>
+#include <stdio.h>
+#include <string.h>
+
+#include <algorithm>
+#include <chrono>
+#include <complex>
+#include <thread>
+#include <vector>
+
+#ifndef M_PI
+#define M_PI ( 3.14159265 )
+#endif
+
+/// frames rendered per synth_render() call
+#define OFFLINE_BLOCK 4096
+
+/// how long to keep rendering after the last event while voices still sound
+#define OFFLINE_MAX_TAIL ( 10 * SAMPLE_RATE )
+
+/// noise run through the convolver by offline_check_convolver(), and how
+/// many of its outputs are compared against direct convolution
+#define CHECK_FRAMES ( 3 * SAMPLE_RATE )
+#define CHECK_POINTS 2000
+
+/// largest error against direct convolution, relative to its peak
+#define CHECK_TOLERANCE 1e-4
+
+/// bins of every transform compared against a direct dft, the largest error
+/// allowed relative to the rms of the spectrum, and how long every size is
+/// timed for
+#define CHECK_FFT_BINS      64
+#define CHECK_FFT_TOLERANCE 1e-5
+#define CHECK_FFT_SECONDS   0.05
+
+/// stereo frames run through the limiter by offline_check_limiter()
+#define CHECK_LIMITER_FRAMES ( 10 * SAMPLE_RATE )
+
+/// frames the simd check renders after the last event, and how far the
+/// vector path may be off the scalar one relative to the peak
+#define CHECK_SIMD_TAIL      ( SAMPLE_RATE / 2 )
+#define CHECK_SIMD_TOLERANCE 1e-5
+
+/// audio callbacks the jitter check simulates, half a minute
+#define CHECK_JITTER_CALLBACKS 20000
+
+/// synthetic callbacks the load check counts
+#define CHECK_LOAD_CALLBACKS 1000
+
+/// frames of filter impulse response the vcf check measures
+#define CHECK_VCF_FRAMES 32768
+
+/// how far the filters may be off their analog prototypes, in dB, and
+/// their slopes off 6 dB per octave and pole
+#define CHECK_VCF_TOLERANCE 0.05
+#define CHECK_VCF_SLOPE     0.5
+
+/// gains below this, in dB, are too far down to compare
+#define CHECK_VCF_FLOOR -100.0
+
+/// largest error of an envelope segment's length, relative to it, at least
+/// a frame either way, and of its level along the way, which the rounding
+/// of the coefficient bends over long segments
+#define CHECK_EG_TOLERANCE 0.005
+#define CHECK_EG_LEVEL     1e-3
+
+/// largest error of a modulation swing, in semitones or octaves
+#define CHECK_MOD_TOLERANCE 0.01
+
+/// frames the crossfade check renders
+#define CHECK_FADE_FRAMES 2048
+
+/// frames the oscillator spectra are taken over, after the envelope and the
+/// filter have settled, and bins either side of a harmonic counted as part
+/// of it, the main lobe of the window
+#define CHECK_BLEP_SIZE   65536
+#define CHECK_BLEP_SETTLE 4096
+#define CHECK_BLEP_BINS   4
+
+/// highest aliasing against the harmonics from the tables and with blep,
+/// whose two sample polynomials leave a good deal more at high notes, and
+/// highest level of the harmonic a quarter wide pulse has none of, in dB
+#define CHECK_BLEP_TABLE_ALIAS -80.0
+#define CHECK_BLEP_ALIAS       -30.0
+#define CHECK_BLEP_NULL        -40.0
+
+/// drive the oversampling check saturates a sine with, and the aliasing it
+/// has to stay under at 4x, in dB of the harmonics below the band; above it
+/// the last half-band's transition folds the same harmonics at any factor
+#define CHECK_OVERSAMPLE_DRIVE 8.0f
+#define CHECK_OVERSAMPLE_BAND  19000.0
+#define CHECK_OVERSAMPLE_ALIAS -80.0
+
+/// how much worse than 2x 4x may measure where both are down at the floor
+#define CHECK_OVERSAMPLE_FLOOR 0.5
+
+/// frames the unison check measures over, after the attack, and how far the
+/// level may drift from one oscillator's as the stack widens, in dB; low
+/// notes beat so slowly the phases hardly move over the frames
+#define CHECK_UNISON_FRAMES ( 2 * SAMPLE_RATE )
+#define CHECK_UNISON_LEVEL  2.0
+
+/// seconds the delay check runs the effects for, and how far the echo's
+/// repeat and the swept delays may land from where they are set, in samples
+#define CHECK_DELAY_SECONDS   2
+#define CHECK_DELAY_TOLERANCE 0.05
+
+/// tail the reverb check renders, in multiples of the decay set, and how far
+/// the decay it measures may land from the one set, as a ratio; the decay is
+/// fitted over -5 to -35 dB of the backward integrated energy in the octave
+/// around the band, as a room's T30 is, low enough the damping barely acts
+#define CHECK_REVERB_LENGTH    1.5
+#define CHECK_REVERB_TOLERANCE 0.05
+#define CHECK_REVERB_BAND      500.0
+
+/// how far the feedback matrix may be from orthogonal, in any entry of its
+/// product with its transpose
+#define CHECK_REVERB_LOSSLESS 1e-6
+
+/// lowest note the synth checks play, the others go up in semitones
+#define CHECK_NOTE 36
+
+/// notes the onset check starts inside one callback's block
+#define CHECK_ONSETS 12
+
+/// how far off an exact equal tempered pitch the oscillators may be
+#define CHECK_CENTS 0.01
+
+struct file_event_t {
+    int64_t tick;
+    int status; // 0xff for tempo changes
+    int data1;
+    int data2;
+    int tempo; // microseconds per quarter note
+};
+
+static bool read_varlen(
+    const unsigned char *& p,
+    const unsigned char * end,
+    uint32_t * out
+)
+{
+    uint32_t value = 0;
+
+    for ( int i = 0; i < 4; i++ ) {
+        if ( p >= end ) return false;
+        unsigned char b = *p++;
+        value = ( value << 7 ) | ( b & 0x7f );
+        if ( !( b & 0x80 ) ) {
+            *out = value;
+            return true;
+        }
+    }
+
+    return false;
+}
+
+static uint32_t read_be( const unsigned char * p, int bytes )
+{
+    uint32_t value = 0;
+    for ( int i = 0; i < bytes; i++ ) value = ( value << 8 ) | p[ i ];
+    return value;
+}
+
+/// collects the channel voice messages we play and the tempo changes
+static bool parse_track(
+    const unsigned char * p,
+    const unsigned char * end,
+    std::vector< file_event_t > & events
+)
+{
+    int64_t tick = 0;
+    int running = 0;
+
+    while ( p < end ) {
+        uint32_t delta;
+        if ( !read_varlen( p, end, &delta ) ) return false;
+        tick += delta;
+
+        if ( p >= end ) return false;
+
+        int status = *p;
+        if ( status & 0x80 ) {
+            p++;
+        } else if ( running ) {
+            status = running;
+        } else {
+            return false;
+        }
+
+        if ( status == 0xff ) {
+            if ( p >= end ) return false;
+            int type = *p++;
+
+            uint32_t length;
+            if ( !read_varlen( p, end, &length ) ) return false;
+            if ( length > (uint32_t) ( end - p ) ) return false;
+
+            if ( type == 0x51 && length == 3 ) {
+                file_event_t e = {};
+                e.tick = tick;
+                e.status = 0xff;
+                e.tempo = (int) read_be( p, 3 );
+                events.push_back( e );
+            }
+
+            p += length;
+            running = 0;
+        } else if ( status == 0xf0 || status == 0xf7 ) {
+            uint32_t length;
+            if ( !read_varlen( p, end, &length ) ) return false;
+            if ( length > (uint32_t) ( end - p ) ) return false;
+
+            p += length;
+            running = 0;
+        } else {
+            int code = status & 0xf0;
+            int size = ( code == 0xc0 || code == 0xd0 ) ? 1 : 2;
+            if ( end - p < size ) return false;
+
+            file_event_t e = {};
+            e.tick = tick;
+            e.status = status;
+            e.data1 = p[ 0 ];
+            e.data2 = size > 1 ? p[ 1 ] : 0;
+            p += size;
+            running = status;
+
+            bool played = code == 0x80 || code == 0x90 || code == 0xb0 ||
+                          code == 0xc0 || code == 0xe0;
+            if ( played ) events.push_back( e );
+        }
+    }
+
+    return true;
+}
+
+static bool to_command( int status, int data1, int data2, synth_command_t * c )
+{
+    int code = status & 0xf0;
+
+    if ( code == 0x90 && data2 > 0 ) {
+        c->type = synth_command_t::MIDI_START;
+        c->value = data1;
+    } else if ( code == 0x80 || code == 0x90 ) {
+        c->type = synth_command_t::MIDI_STOP;
+        c->value = data1;
+    } else if ( code == 0xb0 ) {
+        c->type = synth_command_t::MIDI_CONTROL;
+        c->param = data1;
+        c->value = data2;
+    } else if ( code == 0xc0 ) {
+        c->type = synth_command_t::MIDI_PROGRAM;
+        c->value = data1;
+    } else if ( code == 0xe0 ) {
+        c->type = synth_command_t::MIDI_BEND;
+        c->value = data1 | ( data2 << 7 );
+    } else {
+        return false;
+    }
+
+    return true;
+}
+
+static bool load_midi_file(
+    const unsigned char * data,
+    size_t size,
+    std::vector< synth_command_t > & commands
+)
+{
+    const unsigned char * p = data;
+    const unsigned char * end = data + size;
+
+    if ( size < 14 || memcmp( p, "MThd", 4 ) || read_be( p + 4, 4 ) < 6 ) {
+        return false;
+    }
+
+    int track_count = (int) read_be( p + 10, 2 );
+    int division = (int) read_be( p + 12, 2 );
+    p += 8 + read_be( p + 4, 4 );
+
+    std::vector< file_event_t > events;
+
+    for ( int i = 0; i < track_count && end - p >= 8; i++ ) {
+        uint32_t length = read_be( p + 4, 4 );
+        if ( length > (uint32_t) ( end - p - 8 ) ) return false;
+
+        if ( !memcmp( p, "MTrk", 4 ) ) {
+            if ( !parse_track( p + 8, p + 8 + length, events ) ) return false;
+        }
+
+        p += 8 + length;
+    }
+
+    // merge the tracks, events on the same tick keep their track order
+    std::stable_sort(
+        events.begin(),
+        events.end(),
+        []( const file_event_t & a, const file_event_t & b ) {
+            return a.tick < b.tick;
+        }
+    );
+
+    // seconds per tick, either from the tempo map or a fixed smpte rate
+    double tick_seconds;
+    bool smpte = division & 0x8000;
+    if ( smpte ) {
+        int fps = -(int) (signed char) ( division >> 8 );
+        tick_seconds = 1.0 / ( fps * ( division & 0xff ) );
+    } else {
+        tick_seconds = 0.5 / division; // 120 bpm until told otherwise
+    }
+
+    double seconds = 0.0;
+    int64_t tick = 0;
+
+    for ( const file_event_t & e : events ) {
+        seconds += ( e.tick - tick ) * tick_seconds;
+        tick = e.tick;
+
+        if ( e.status == 0xff ) {
+            if ( !smpte ) tick_seconds = e.tempo * 1e-6 / division;
+            continue;
+        }
+
+        synth_command_t c;
+        if ( !to_command( e.status, e.data1, e.data2, &c ) ) continue;
+        c.frame = llround( seconds * SAMPLE_RATE );
+        commands.push_back( c );
+    }
+
+    return true;
+}
+
+static bool load_event_list(
+    FILE * file,
+    std::vector< synth_command_t > & commands
+)
+{
+    char line[ 256 ];
+    int line_no = 0;
+
+    while ( fgets( line, sizeof( line ), file ) ) {
+        line_no++;
+
+        char * p = line;
+        while ( *p == ' ' || *p == '\t' ) p++;
+        if ( *p == '#' || *p == '\n' || *p == '\r' || *p == 0 ) continue;
+
+        double seconds;
+        char type[ 16 ];
+        int used;
+        if ( sscanf( p, "%lf %15s%n", &seconds, type, &used ) != 2 ) {
+            ERROR_LOG( "bad event on line %d", line_no );
+            return false;
+        }
+        const char * args = p + used;
+
+        synth_command_t c;
+        c.frame = llround( seconds * SAMPLE_RATE );
+
+        int value = 0, control;
+        char name[ 32 ];
+        bool ok = sscanf( args, "%d", &value ) == 1;
+
+        if ( !strcmp( type, "on" ) ) {
+            c.type = synth_command_t::MIDI_START;
+        } else if ( !strcmp( type, "off" ) ) {
+            c.type = synth_command_t::MIDI_STOP;
+        } else if ( !strcmp( type, "cc" ) ) {
+            // the controller number is optional, without one it is none
+            // of the mapped ones
+            c.type = synth_command_t::MIDI_CONTROL;
+            c.param = -1;
+            if ( sscanf( args, "%d %d", &control, &value ) == 2 ) {
+                c.param = control;
+            }
+        } else if ( !strcmp( type, "bend" ) ) {
+            c.type = synth_command_t::MIDI_BEND;
+        } else if ( !strcmp( type, "prog" ) ) {
+            c.type = synth_command_t::MIDI_PROGRAM;
+        } else if ( !strcmp( type, "set" ) ) {
+            c.type = synth_command_t::SET_PARAM;
+            ok = sscanf( args, "%31s %f", name, &c.amount ) == 2;
+            c.param = ok ? synth_param_find( name ) : 0;
+            if ( c.param < 0 ) {
+                ERROR_LOG( "unknown parameter '%s' on line %d", name, line_no );
+                return false;
+            }
+        } else {
+            ERROR_LOG( "unknown event '%s' on line %d", type, line_no );
+            return false;
+        }
+
+        if ( !ok ) {
+            ERROR_LOG( "bad event on line %d", line_no );
+            return false;
+        }
+        c.value = value;
+
+        commands.push_back( c );
+    }
+
+    std::stable_sort(
+        commands.begin(),
+        commands.end(),
+        []( const synth_command_t & a, const synth_command_t & b ) {
+            return a.frame < b.frame;
+        }
+    );
+
+    return true;
+}
+
+static bool load_events(
+    const char * path,
+    std::vector< synth_command_t > & commands
+)
+{
+    FILE * file = fopen( path, "rb" );
+    if ( !file ) {
+        ERROR_LOG( "failed to open %s", path );
+        return false;
+    }
+
+    const char * ext = strrchr( path, '.' );
+    bool is_midi = ext && ( !strcmp( ext, ".mid" ) || !strcmp( ext, ".midi" ) );
+
+    bool ok;
+    if ( is_midi ) {
+        std::vector< unsigned char > data;
+        unsigned char chunk[ 4096 ];
+        size_t n;
+        while ( ( n = fread( chunk, 1, sizeof( chunk ), file ) ) > 0 ) {
+            data.insert( data.end(), chunk, chunk + n );
+        }
+
+        ok = load_midi_file( data.data(), data.size(), commands );
+        if ( !ok ) ERROR_LOG( "failed to parse midi file %s", path );
+    } else {
+        ok = load_event_list( file, commands );
+    }
+
+    fclose( file );
+
+    return ok;
+}
+
+int offline_render(
+    const char * input_path,
+    const char * output_path,
+    const char * ir_path
+)
+{
+    std::vector< synth_command_t > commands;
+    if ( !load_events( input_path, commands ) ) return 1;
+
+    INFO_LOG( "loaded %d events from %s", (int) commands.size(), input_path );
+
+    wav_writer_t wav;
+    if ( wav_open( &wav, output_path, 2, SAMPLE_RATE ) ) return 1;
+
+    synth_t * s = new synth_t;
+    synth_init( s );
+
+    if ( ir_path && synth_load_ir( s, ir_path, true ) ) {
+        wav_close( &wav );
+        synth_destroy( s );
+        delete s;
+        return 1;
+    }
+
+    int64_t last_frame = commands.empty() ? 0 : commands.back().frame;
+
+    static float buffer[ OFFLINE_BLOCK * 2 ];
+    size_t next = 0;
+
+    // the convolver rings on for the length of its response after the
+    // voices went quiet
+    int64_t sounding = 0;
+
+    auto start = std::chrono::steady_clock::now();
+
+    for ( ;; ) {
+        bool queued = PaUtil_GetRingBufferReadAvailable( &s->command_queue );
+        bool busy = s->voice.count > 0 || s->pending_count > 0 || queued;
+        if ( busy ) sounding = s->frame;
+        bool ringing = s->frame < sounding + s->convolver.length;
+
+        if ( next == commands.size() && !busy && !ringing ) break;
+        if ( s->frame > last_frame + OFFLINE_MAX_TAIL ) break;
+
+        int64_t end = s->frame + OFFLINE_BLOCK;
+        while ( next < commands.size() && commands[ next ].frame < end &&
+                PaUtil_GetRingBufferWriteAvailable( &s->command_queue ) ) {
+            synth_send( s, commands[ next++ ] );
+        }
+
+        // if the queue filled up, stop right before the first event that
+        // did not fit so it is not applied late
+        int block = OFFLINE_BLOCK;
+        if ( next < commands.size() && commands[ next ].frame < end ) {
+            block = (int) ( commands[ next ].frame - s->frame );
+            if ( block < 1 ) block = 1;
+        }
+
+        synth_render( s, buffer, block );
+        wav_write( &wav, buffer, block );
+    }
+
+    auto stop = std::chrono::steady_clock::now();
+    double elapsed = std::chrono::duration< double >( stop - start ).count();
+    double length = (double) s->frame / SAMPLE_RATE;
+
+    INFO_LOG(
+        "rendered %.1f s in %.2f s (%.0fx realtime)",
+        length,
+        elapsed,
+        elapsed > 0.0 ? length / elapsed : 0.0
+    );
+
+    wav_close( &wav );
+
+    synth_destroy( s );
+    delete s;
+
+    return 0;
+}
+
+static float check_noise( uint32_t * seed )
+{
+    *seed = *seed * 1664525u + 1013904223u;
+    return (int32_t) *seed / 2147483648.0f;
+}
+
+/// runs in through c into out, in blocks of block frames or of random sizes
+/// up to 256 if block is 0, optionally as fast as the audio device would
+/// ask for them; returns the longest and the average time of one call
+static void check_run(
+    convolver_t * c,
+    std::vector< float > * in,
+    std::vector< float > * out,
+    int block,
+    bool paced,
+    double * longest,
+    double * average
+)
+{
+    out[ 0 ] = in[ 0 ];
+    out[ 1 ] = in[ 1 ];
+
+    uint32_t seed = 7;
+    double total = 0.0;
+    int calls = 0;
+    *longest = 0.0;
+
+    auto start = std::chrono::steady_clock::now();
+
+    for ( int done = 0; done < CHECK_FRAMES; calls++ ) {
+        int n = block;
+        if ( !block ) n = 1 + (int) ( ( check_noise( &seed ) + 1.0f ) * 128 );
+        if ( n > 256 ) n = 256;
+        if ( n > CHECK_FRAMES - done ) n = CHECK_FRAMES - done;
+
+        if ( paced ) {
+            double due = (double) done / SAMPLE_RATE;
+            std::this_thread::sleep_until(
+                start + std::chrono::duration< double >( due )
+            );
+        }
+
+        float * io[ 2 ] = { out[ 0 ].data() + done, out[ 1 ].data() + done };
+
+        auto t0 = std::chrono::steady_clock::now();
+        convolver_process( c, io, n );
+        auto t1 = std::chrono::steady_clock::now();
+
+        double took = std::chrono::duration< double >( t1 - t0 ).count();
+        if ( took > *longest ) *longest = took;
+        total += took;
+
+        done += n;
+    }
+
+    *average = total / calls;
+}
+
+int offline_check_convolver( const char * ir_path )
+{
+    uint32_t seed = 1;
+
+    std::vector< float > ir;
+    int channels = 2;
+    int frames = 2 * SAMPLE_RATE;
+
+    if ( ir_path ) {
+        float * samples;
+        int rate;
+        if ( wav_read( ir_path, &samples, &channels, &frames, &rate ) ) {
+            return 1;
+        }
+        ir.assign( samples, samples + (size_t) frames * channels );
+        delete[] samples;
+
+        if ( channels > 2 ) {
+            ERROR_LOG( "%s has %d channels", ir_path, channels );
+            return 1;
+        }
+    } else {
+        // 60 dB down at the end
+        ir.resize( (size_t) frames * channels );
+        for ( int i = 0; i < frames; i++ ) {
+            float env = expf( -6.9f * i / frames );
+            ir[ 2 * i ] = env * check_noise( &seed );
+            ir[ 2 * i + 1 ] = env * check_noise( &seed );
+        }
+    }
+
+    std::vector< float > in[ 2 ], out[ 2 ], paced[ 2 ];
+    for ( int ch = 0; ch < 2; ch++ ) {
+        in[ ch ].resize( CHECK_FRAMES );
+        for ( float & x : in[ ch ] ) x = 0.5f * check_noise( &seed );
+    }
+
+    convolver_t * c = new convolver_t;
+    convolver_init( c );
+
+    // everything on this thread, in uneven blocks
+    double longest, average;
+    convolver_load( c, ir.data(), channels, frames, true );
+    check_run( c, in, out, 0, false, &longest, &average );
+
+    // the same in the audio callback's blocks, for the cost of all levels
+    check_run( c, in, paced, CONVOLVER_HEAD, false, &longest, &average );
+    double all = average;
+
+    // half the points cover the joins between the levels, the rest spread
+    // over the whole run
+    double error = 0.0;
+    double peak = 0.0;
+    for ( int k = 0; k < CHECK_POINTS; k++ ) {
+        int range = k % 2 ? CHECK_FRAMES : 4 * CONVOLVER_TAIL_START;
+        int n = (int) ( ( check_noise( &seed ) + 1.0f ) * 0.5f * range );
+        n = std::min( std::max( n, 0 ), range - 1 );
+        int ch = k % 4 < 2 ? 0 : 1;
+        int channel = channels > 1 ? ch : 0;
+
+        double y = 0.0;
+        for ( int t = 0; t < frames && t <= n; t++ ) {
+            y += (double) ir[ t * channels + channel ] * in[ ch ][ n - t ];
+        }
+
+        double e = fabs( y - out[ ch ][ n ] );
+        if ( e > error ) error = e;
+        if ( fabs( y ) > peak ) peak = fabs( y );
+    }
+
+    // the worker doing the tail while this thread keeps real time
+    convolver_load( c, ir.data(), channels, frames, false );
+    check_run( c, in, paced, CONVOLVER_HEAD, true, &longest, &average );
+
+    // apart from late tail frames the worker changes nothing in the result
+    double difference = 0.0;
+    for ( int ch = 0; ch < 2; ch++ ) {
+        for ( int i = 0; i < CHECK_FRAMES; i++ ) {
+            double d = fabs( (double) paced[ ch ][ i ] - out[ ch ][ i ] );
+            if ( d > difference ) difference = d;
+        }
+    }
+
+    INFO_LOG(
+        "%.2f s response, %d KiB, error %.2e of peak %.3f",
+        (double) frames / SAMPLE_RATE,
+        convolver_memory( c ) / 1024,
+        error / peak,
+        peak
+    );
+    INFO_LOG(
+        "per %d frames: %.2f us with the worker (longest %.1f us), "
+        "%.2f us for all levels on one thread",
+        CONVOLVER_HEAD,
+        1e6 * average,
+        1e6 * longest,
+        1e6 * all
+    );
+    INFO_LOG(
+        "%lld tail frames late, %.2e from the single thread result",
+        (long long) c->tail_late,
+        difference
+    );
+
+    bool ok = error <= CHECK_TOLERANCE * peak && difference == 0.0;
+
+    convolver_free( c );
+    delete c;
+
+    return ok ? 0 : 1;
+}
+
+/// calls transform in rounds until CHECK_FFT_SECONDS have passed, returns
+/// the time of one call in ns in the fastest round
+template < typename F > static double check_time( F transform )
+{
+    double best = 1e30;
+    double total = 0.0;
+
+    do {
+        auto start = std::chrono::steady_clock::now();
+        for ( int i = 0; i < 16; i++ ) transform();
+        auto stop = std::chrono::steady_clock::now();
+
+        std::chrono::duration< double > elapsed = stop - start;
+        best = std::min( best, elapsed.count() / 16 );
+        total += elapsed.count();
+    } while ( total < CHECK_FFT_SECONDS );
+
+    return 1e9 * best;
+}
+
+/// largest difference between bins of the spectrum and a direct dft of the
+/// complex signal in, relative to the rms of the spectrum
+static double check_dft(
+    const std::vector< float > * in,
+    const float * re,
+    const float * im,
+    int size,
+    int bins,
+    uint32_t * seed
+)
+{
+    double power = 0.0;
+    for ( int k = 0; k < bins; k++ ) {
+        power += (double) re[ k ] * re[ k ] + (double) im[ k ] * im[ k ];
+    }
+    double rms = sqrt( power / bins );
+
+    double error = 0.0;
+    for ( int i = 0; i < CHECK_FFT_BINS; i++ ) {
+        int k = (int) ( ( check_noise( seed ) + 1.0f ) * 0.5f * bins );
+        k = std::min( std::max( k, 0 ), bins - 1 );
+
+        double sum_re = 0.0, sum_im = 0.0;
+        for ( int t = 0; t < size; t++ ) {
+            double w = -2.0 * M_PI * ( (int64_t) k * t % size ) / size;
+            double x_re = in[ 0 ][ t ];
+            double x_im = in[ 1 ].empty() ? 0.0 : in[ 1 ][ t ];
+            sum_re += x_re * cos( w ) - x_im * sin( w );
+            sum_im += x_re * sin( w ) + x_im * cos( w );
+        }
+
+        double e = hypot( sum_re - re[ k ], sum_im - im[ k ] );
+        if ( e > error ) error = e;
+    }
+
+    return error / rms;
+}
+
+int offline_check_fft()
+{
+    uint32_t seed = 1;
+    bool ok = true;
+
+    for ( int size = 64; size <= FFT_MAX_SIZE; size *= 2 ) {
+        std::vector< float > in[ 2 ], re( size ), im( size ), out( size );
+        for ( int ch = 0; ch < 2; ch++ ) {
+            in[ ch ].resize( size );
+            for ( float & x : in[ ch ] ) x = check_noise( &seed );
+        }
+
+        fft_plan_t plan;
+        fft_real_plan_t real;
+        if ( fft_plan_init( &plan, size ) ) return 1;
+        if ( fft_real_plan_init( &real, size ) ) return 1;
+
+        // complex, and the round trip back
+        re = in[ 0 ];
+        im = in[ 1 ];
+        fft_forward( &plan, re.data(), im.data() );
+        double error = check_dft( in, re.data(), im.data(), size, size, &seed );
+
+        fft_inverse( &plan, re.data(), im.data() );
+        double round = 0.0;
+        for ( int t = 0; t < size; t++ ) {
+            double e = hypot( re[ t ] / size - in[ 0 ][ t ],
+                              im[ t ] / size - in[ 1 ][ t ] );
+            if ( e > round ) round = e;
+        }
+
+        // real, with the nyquist bin moved out of the packed dc bin
+        std::vector< float > real_in[ 2 ] = { in[ 0 ], {} };
+        std::vector< float > real_re( size / 2 + 1 ), real_im( size / 2 + 1 );
+        fft_real_forward(
+            &real,
+            in[ 0 ].data(),
+            real_re.data(),
+            real_im.data()
+        );
+        real_re[ size / 2 ] = real_im[ 0 ];
+        real_im[ size / 2 ] = 0.0f;
+        real_im[ 0 ] = 0.0f;
+        double real_error = check_dft(
+            real_in,
+            real_re.data(),
+            real_im.data(),
+            size,
+            size / 2 + 1,
+            &seed
+        );
+
+        real_im[ 0 ] = real_re[ size / 2 ];
+        fft_real_inverse( &real, real_re.data(), real_im.data(), out.data() );
+        for ( int t = 0; t < size; t++ ) {
+            double e = fabs( out[ t ] / size - in[ 0 ][ t ] );
+            if ( e > round ) round = e;
+        }
+
+        // the transform takes as long whatever the data, and zeros stay
+        // zeros however often it runs in place
+        std::fill( re.begin(), re.end(), 0.0f );
+        std::fill( im.begin(), im.end(), 0.0f );
+        double complex_ns = check_time( [ & ] {
+            fft_forward( &plan, re.data(), im.data() );
+        } );
+        double real_ns = check_time( [ & ] {
+            fft_real_forward( &real, out.data(), re.data(), im.data() );
+        } );
+
+        INFO_LOG(
+            "%5d points: error %.1e / real %.1e, round trip %.1e, "
+            "%.0f ns complex, %.0f ns real",
+            size,
+            error,
+            real_error,
+            round,
+            complex_ns,
+            real_ns
+        );
+
+        ok = ok && error < CHECK_FFT_TOLERANCE &&
+             real_error < CHECK_FFT_TOLERANCE && round < CHECK_FFT_TOLERANCE;
+
+        fft_plan_free( &plan );
+        fft_real_plan_free( &real );
+    }
+
+    return ok ? 0 : 1;
+}
+
+/// runs the interleaved frames in through l in blocks of random sizes up to
+/// 256 frames, returns the lowest gain it applied
+static float check_limit( limiter_t * l, std::vector< float > * in )
+{
+    uint32_t seed = 7;
+    float lowest = 1.0f;
+
+    for ( int done = 0; done < CHECK_LIMITER_FRAMES; ) {
+        int n = 1 + (int) ( ( check_noise( &seed ) + 1.0f ) * 128 );
+        if ( n > 256 ) n = 256;
+        if ( n > CHECK_LIMITER_FRAMES - done ) n = CHECK_LIMITER_FRAMES - done;
+
+        limiter_process( l, in->data() + 2 * done, n, SAMPLE_RATE );
+        lowest = std::min( lowest, l->lowest_gain );
+
+        done += n;
+    }
+
+    return lowest;
+}
+
+int offline_check_limiter()
+{
+    uint32_t seed = 1;
+
+    // a quiet tone and noise, with every third tenth of a second up to 16
+    // times louder and the odd spike on top
+    std::vector< float > quiet( 2 * CHECK_LIMITER_FRAMES );
+    std::vector< float > loud( 2 * CHECK_LIMITER_FRAMES );
+    for ( int t = 0; t < CHECK_LIMITER_FRAMES; t++ ) {
+        float x = 0.5f * sinf( 2.0f * (float) M_PI * 220.0f * t / SAMPLE_RATE );
+        float y = 0.3f * check_noise( &seed );
+        quiet[ 2 * t ] = x + y;
+        quiet[ 2 * t + 1 ] = x - y;
+
+        int section = t / ( SAMPLE_RATE / 10 );
+        float level = section % 3 == 1 ? 4.0f * ( 1 + section % 4 ) : 1.0f;
+        loud[ 2 * t ] = level * quiet[ 2 * t ];
+        loud[ 2 * t + 1 ] = level * quiet[ 2 * t + 1 ];
+        if ( check_noise( &seed ) > 0.999f ) {
+            loud[ 2 * t + ( t & 1 ) ] = 20.0f * check_noise( &seed );
+        }
+    }
+
+    limiter_t * l = new limiter_t;
+    bool ok = true;
+
+    // below the ceiling the output is the input, only later
+    limiter_init( l, LIMITER_LOOKAHEAD, SAMPLE_RATE );
+    std::vector< float > out = quiet;
+    check_limit( l, &out );
+
+    const int delay = 2 * l->lookahead;
+    bool transparent = true;
+    for ( int i = 0; i < 2 * CHECK_LIMITER_FRAMES; i++ ) {
+        float x = i < delay ? 0.0f : quiet[ i - delay ];
+        transparent = transparent && out[ i ] == x;
+    }
+    ok = ok && transparent;
+
+    INFO_LOG(
+        "lookahead %d frames (%.2f ms of latency), %s below the ceiling",
+        l->lookahead,
+        1e3 * l->lookahead / SAMPLE_RATE,
+        transparent ? "transparent" : "NOT transparent"
+    );
+
+    for ( int soft = 0; soft < 2; soft++ ) {
+        limiter_init( l, LIMITER_LOOKAHEAD, SAMPLE_RATE );
+        l->soft_clip = soft;
+
+        out = loud;
+        float lowest = check_limit( l, &out );
+
+        float peak = 0.0f;
+        for ( float x : out ) peak = std::max( peak, fabsf( x ) );
+        ok = ok && peak <= l->ceiling;
+
+        // one callback's worth at a time, the cost does not depend on the
+        // signal since nothing in the limiter branches on it
+        std::vector< float > block( 2 * FRAMES_PER_BUFFER );
+        int at = 0;
+        double ns = check_time( [ & ] {
+            std::copy(
+                loud.begin() + 2 * at,
+                loud.begin() + 2 * ( at + FRAMES_PER_BUFFER ),
+                block.begin()
+            );
+            limiter_process( l, block.data(), FRAMES_PER_BUFFER, SAMPLE_RATE );
+            at = ( at + FRAMES_PER_BUFFER ) %
+                 ( CHECK_LIMITER_FRAMES - FRAMES_PER_BUFFER );
+        } );
+
+        INFO_LOG(
+            "%s clip: peak %.6f, ceiling %.6f, lowest gain %.4f, "
+            "%.0f ns per %d frames",
+            soft ? "soft" : "hard",
+            peak,
+            l->ceiling,
+            lowest,
+            ns,
+            FRAMES_PER_BUFFER
+        );
+    }
+
+    delete l;
+
+    return ok ? 0 : 1;
+}
+
+/// sends a note on for frame 0, which is applied at the start of the next
+/// block
+static void check_note( synth_t * s, int midi_no )
+{
+    synth_command_t c;
+    c.type = synth_command_t::MIDI_START;
+    c.value = midi_no;
+    c.frame = 0;
+    synth_send( s, c );
+}
+
+/// sends a SET_PARAM for frame 0 to the parameter called name
+static void check_set( synth_t * s, const char * name, float amount )
+{
+    synth_command_t c;
+    c.type = synth_command_t::SET_PARAM;
+    c.param = synth_param_find( name );
+    c.amount = amount;
+    c.frame = 0;
+    synth_send( s, c );
+}
+
+/// starts a full pool of notes on wave and renders past the crossfade to it
+static void check_pool( synth_t * s, int wave )
+{
+    synth_init( s );
+    check_set( s, "vco_wave", wave );
+    for ( int i = 0; i < VOICE_COUNT; i++ ) check_note( s, CHECK_NOTE + i );
+
+    std::vector< float > block( 2 * FRAMES_PER_BUFFER );
+    for ( int i = 0; i < KERNEL_FADE_FRAMES / FRAMES_PER_BUFFER; i++ ) {
+        synth_render( s, block.data(), FRAMES_PER_BUFFER );
+    }
+}
+
+int offline_check_voices()
+{
+    const double budget = 1e9 * FRAMES_PER_BUFFER / SAMPLE_RATE;
+
+    synth_t * s = new synth_t;
+    std::vector< float > block( 2 * FRAMES_PER_BUFFER );
+    bool ok = true;
+
+    for ( int count = 1; count <= VOICE_COUNT; count *= 2 ) {
+        synth_init( s );
+        for ( int i = 0; i < count; i++ ) check_note( s, CHECK_NOTE + i );
+
+        synth_render( s, block.data(), FRAMES_PER_BUFFER );
+        ok = ok && s->voice.count == count;
+
+        // the notes are held, so every call renders all of them
+        double ns = check_time( [ & ] {
+            synth_render( s, block.data(), FRAMES_PER_BUFFER );
+        } );
+        ok = ok && s->voice.count == count;
+
+        INFO_LOG(
+            "%2d voices: %6.0f ns per %d frames, %4.1f%% of the buffer, "
+            "%.0f ns per voice",
+            count,
+            ns,
+            FRAMES_PER_BUFFER,
+            100.0 * ns / budget,
+            ns / count
+        );
+
+        synth_destroy( s );
+    }
+
+    delete s;
+
+    return ok ? 0 : 1;
+}
+
+/// one build of the synth engine, see synth_scalar.cpp
+struct check_engine_t {
+    void ( *init )( synth_t * s );
+    void ( *destroy )( synth_t * s );
+    void ( *send )( synth_t * s, const synth_command_t & command );
+    void ( *render )( synth_t * s, float * out, int frames );
+};
+
+/// a chord that overflows one group of lanes, bent, with notes leaving and
+/// joining at odd frames so padding lanes and voice moves are covered
+static void check_simd_events( std::vector< synth_command_t > & commands )
+{
+    static const struct {
+        double seconds;
+        int on; // 1 on, 0 off, -1 bend
+        int value;
+    } events[] = {
+        { 0.0, 1, 48 },    { 0.0, 1, 52 },    { 0.0, 1, 55 },
+        { 0.0, 1, 59 },    { 0.0, 1, 62 },    { 0.1, -1, 12000 },
+        { 0.3013, 0, 52 }, { 0.3017, 1, 71 }, { 0.4, -1, 0x2000 },
+        { 0.5, 0, 48 },    { 0.5001, 0, 55 }, { 0.6, 1, 36 },
+        { 0.7, 0, 59 },    { 0.7, 0, 62 },    { 0.7, 0, 71 },
+        { 0.8, 0, 36 },
+    };
+
+    for ( const auto & e : events ) {
+        synth_command_t c;
+        c.type = e.on > 0    ? synth_command_t::MIDI_START
+                 : e.on == 0 ? synth_command_t::MIDI_STOP
+                             : synth_command_t::MIDI_BEND;
+        c.value = e.value;
+        c.frame = llround( e.seconds * SAMPLE_RATE );
+        commands.push_back( c );
+    }
+}
+
+/// renders commands through one engine with the given waveform and filter,
+/// in the audio callback's blocks; returns the time it took in seconds
+static double check_simd_render(
+    const check_engine_t & engine,
+    const std::vector< synth_command_t > & commands,
+    int wave,
+    int mode,
+    int unison,
+    std::vector< float > & out
+)
+{
+    synth_t * s = new synth_t;
+    engine.init( s );
+
+    s->vco.vco_wave = (float) wave;
+    s->vcf.vcf_mode = mode;
+    s->vcf.cutoff = 2000.0f;
+    s->vcf.resonance = 0.5f;
+    s->unison.count = unison;
+    s->unison.spread = unison > 1 ? 0.5f : 0.0f;
+
+    size_t next = 0;
+    auto start = std::chrono::steady_clock::now();
+
+    for ( size_t done = 0; done < out.size(); done += 2 * FRAMES_PER_BUFFER ) {
+        int64_t end = s->frame + FRAMES_PER_BUFFER;
+        while ( next < commands.size() && commands[ next ].frame < end ) {
+            engine.send( s, commands[ next++ ] );
+        }
+        engine.render( s, out.data() + done, FRAMES_PER_BUFFER );
+    }
+
+    auto stop = std::chrono::steady_clock::now();
+
+    engine.destroy( s );
+    delete s;
+
+    return std::chrono::duration< double >( stop - start ).count();
+}
+
+int offline_check_simd( const char * events_path )
+{
+    static const check_engine_t vector = {
+        synth_init,
+        synth_destroy,
+        synth_send,
+        synth_render,
+    };
+    static const check_engine_t scalar = {
+        synth_scalar_init,
+        synth_scalar_destroy,
+        synth_scalar_send,
+        synth_scalar_render,
+    };
+
+    std::vector< synth_command_t > commands;
+    if ( events_path ) {
+        if ( !load_events( events_path, commands ) ) return 1;
+    } else {
+        check_simd_events( commands );
+    }
+
+    int64_t last = commands.empty() ? 0 : commands.back().frame;
+    int blocks = (int) ( ( last + CHECK_SIMD_TAIL ) / FRAMES_PER_BUFFER ) + 1;
+    std::vector< float > a( 2 * FRAMES_PER_BUFFER * blocks );
+    std::vector< float > b( a.size() );
+
+    bool ok = true;
+    double vector_total = 0.0, scalar_total = 0.0;
+
+    // every waveform and filter, with one oscillator per note and three
+    const int count = VCO_WAVE_COUNT * 2 * VCF_MODE_COUNT;
+    for ( int k = 0; k < count; k++ ) {
+        int wave = k / ( VCF_MODE_COUNT * 2 );
+        int mode = k / 2 % VCF_MODE_COUNT;
+        int unison = 1 + k % 2 * 2;
+
+        double vector_time =
+            check_simd_render( vector, commands, wave, mode, unison, a );
+        double scalar_time =
+            check_simd_render( scalar, commands, wave, mode, unison, b );
+
+        float error = 0.0f, peak = 0.0f;
+        for ( size_t i = 0; i < a.size(); i++ ) {
+            error = std::max( error, fabsf( a[ i ] - b[ i ] ) );
+            peak = std::max( peak, fabsf( b[ i ] ) );
+        }
+        bool match = error <= CHECK_SIMD_TOLERANCE * peak;
+        ok = ok && match && peak > 0.0f;
+
+        INFO_LOG(
+            "wave %d filter %d unison %d: error %.1e of peak %.3f, "
+            "%.2f ms vector, %.2f ms scalar%s",
+            wave,
+            mode,
+            unison,
+            error,
+            peak,
+            1e3 * vector_time,
+            1e3 * scalar_time,
+            match ? "" : " MISMATCH"
+        );
+
+        vector_total += vector_time;
+        scalar_total += scalar_time;
+    }
+
+    INFO_LOG(
+        "%.1f s of audio per render, vector path %.1fx faster",
+        (double) blocks * FRAMES_PER_BUFFER / SAMPLE_RATE,
+        scalar_total / vector_total
+    );
+
+    return ok ? 0 : 1;
+}
+
+int offline_check_pitch()
+{
+    const double phase_per_hz = 4294967296.0 / SAMPLE_RATE;
+
+    // every cent over the whole keyboard against the exact frequency
+    double error = 0.0;
+    for ( int i = 0; i <= 127 * 100; i++ ) {
+        double pitch = i / 100.0;
+        double exact = 440.0 * pow( 2.0, ( pitch - 69.0 ) / 12.0 );
+        double freq = synth_pitch_to_freq( (float) pitch );
+        error = std::max( error, fabs( 1200.0 * log2( freq / exact ) ) );
+    }
+
+    // a full pool for one callback: pow() for every voice on every frame as
+    // before, against a lookup per voice per block and a ramp per frame
+    float pitch[ VOICE_COUNT ];
+    int32_t before[ VOICE_COUNT ], after[ VOICE_COUNT ];
+    int32_t step[ VOICE_COUNT ] = {};
+    for ( int j = 0; j < VOICE_COUNT; j++ ) pitch[ j ] = CHECK_NOTE + j;
+    float bend = 0.37f;
+
+    double per_frame = check_time( [ & ] {
+        for ( int t = 0; t < FRAMES_PER_BUFFER; t++ ) {
+            for ( int j = 0; j < VOICE_COUNT; j++ ) {
+                double p = pitch[ j ] + bend;
+                double freq = 440.0 * pow( 2.0, ( p - 69.0 ) / 12.0 );
+                before[ j ] = (int32_t) (uint32_t) ( freq * phase_per_hz );
+            }
+        }
+    } );
+
+    double per_block = check_time( [ & ] {
+        for ( int j = 0; j < VOICE_COUNT; j++ ) {
+            double freq = synth_pitch_to_freq( pitch[ j ] + bend );
+            after[ j ] = (int32_t) (uint32_t) ( freq * phase_per_hz + 0.5 );
+        }
+        for ( int t = 0; t < FRAMES_PER_BUFFER; t++ ) {
+            for ( int j = 0; j < VOICE_COUNT; j++ ) after[ j ] += step[ j ];
+        }
+    } );
+
+    // both land on the same increments, to the rounding of the table
+    double difference = 0.0;
+    for ( int j = 0; j < VOICE_COUNT; j++ ) {
+        double ratio = (double) (uint32_t) after[ j ] / (uint32_t) before[ j ];
+        difference = std::max( difference, fabs( 1200.0 * log2( ratio ) ) );
+    }
+
+    INFO_LOG(
+        "largest error %.5f cents, increments %.5f cents apart",
+        error,
+        difference
+    );
+    INFO_LOG(
+        "%d voices for %d frames: %.0f ns with pow() per frame, "
+        "%.0f ns per block (%.1fx)",
+        VOICE_COUNT,
+        FRAMES_PER_BUFFER,
+        per_frame,
+        per_block,
+        per_frame / per_block
+    );
+
+    return error < CHECK_CENTS && difference < CHECK_CENTS ? 0 : 1;
+}
+
+int offline_check_tuning()
+{
+    // centered, both ends and two odd positions of the wheel
+    static const int bends[] = { 0x2000, 0x0000, 0x3fff, 0x1234, 0x2001 };
+
+    synth_t * s = new synth_t;
+    std::vector< float > block( 2 * FRAMES_PER_BUFFER );
+    bool ok = true;
+
+    for ( int bend : bends ) {
+        double error = 0.0;
+        int worst = 0;
+
+        for ( int note = 0; note < 128; note++ ) {
+            synth_init( s );
+
+            // the bend comes in once the voice sounds, so the increment has
+            // to ramp over to it
+            synth_command_t c;
+            c.type = synth_command_t::MIDI_START;
+            c.value = note;
+            c.frame = 0;
+            synth_send( s, c );
+            c.type = synth_command_t::MIDI_BEND;
+            c.value = bend;
+            c.frame = FRAMES_PER_BUFFER + 13;
+            synth_send( s, c );
+
+            for ( int i = 0; i < 4; i++ ) {
+                synth_render( s, block.data(), FRAMES_PER_BUFFER );
+            }
+
+            double range = s->vco.bend_range;
+            double pitch = note + ( bend - 0x2000 ) / 8192.0 * range;
+            pitch = std::min( std::max( pitch, 0.0 ), 127.0 );
+            double exact = 440.0 * pow( 2.0, ( pitch - 69.0 ) / 12.0 );
+
+            uint32_t inc = (uint32_t) s->voice.phase_inc[ 0 ][ 0 ];
+            double freq = inc * (double) SAMPLE_RATE / 4294967296.0;
+            double cents = fabs( 1200.0 * log2( freq / exact ) );
+            if ( cents > error ) {
+                error = cents;
+                worst = note;
+            }
+
+            synth_destroy( s );
+        }
+
+        INFO_LOG(
+            "bend %04x: largest error %.5f cents, on note %d",
+            bend,
+            error,
+            worst
+        );
+        ok = ok && error < CHECK_CENTS;
+    }
+
+    delete s;
+
+    return ok ? 0 : 1;
+}
+
+/// renders the first count notes of a burst through a fresh synth, all of
+/// them queued before the block they start in
+static void check_burst(
+    synth_t * s,
+    const int * frames,
+    int count,
+    std::vector< float > & out
+)
+{
+    synth_init( s );
+
+    for ( int i = 0; i < count; i++ ) {
+        synth_command_t c;
+        c.type = synth_command_t::MIDI_START;
+        c.value = CHECK_NOTE + 5 * i;
+        c.frame = FRAMES_PER_BUFFER + frames[ i ];
+        synth_send( s, c );
+    }
+
+    for ( size_t done = 0; done < out.size(); done += 2 * FRAMES_PER_BUFFER ) {
+        synth_render( s, out.data() + done, FRAMES_PER_BUFFER );
+    }
+
+    synth_destroy( s );
+}
+
+int offline_check_onsets()
+{
+    // the second block, out of order and right up against both of its ends
+    static const int frames[ CHECK_ONSETS ] = {
+        0, 63, 1, 62, 17, 31, 32, 33, 5, 48, 6, 40,
+    };
+
+    synth_t * s = new synth_t;
+    std::vector< float > before( 2 * 3 * FRAMES_PER_BUFFER );
+    std::vector< float > after( before.size() );
+    bool ok = true;
+
+    // adding a note changes nothing until the frame it is due on, and that
+    // one already
+    check_burst( s, frames, 0, before );
+    for ( int k = 0; k < CHECK_ONSETS; k++ ) {
+        check_burst( s, frames, k + 1, after );
+
+        int onset = -1;
+        for ( size_t i = 0; i < after.size() && onset < 0; i++ ) {
+            if ( after[ i ] != before[ i ] ) onset = (int) i / 2;
+        }
+
+        int due = FRAMES_PER_BUFFER + frames[ k ];
+        if ( onset != due ) {
+            ERROR_LOG( "note %d due on frame %d started on %d", k, due, onset );
+            ok = false;
+        }
+
+        before.swap( after );
+    }
+
+    INFO_LOG(
+        "%d notes inside one %d frame block, %s",
+        CHECK_ONSETS,
+        FRAMES_PER_BUFFER,
+        ok ? "all started on their frame" : "NOT all on their frame"
+    );
+
+    delete s;
+
+    return ok ? 0 : 1;
+}
+
+int offline_check_jitter()
+{
+    const double period = (double) FRAMES_PER_BUFFER / SAMPLE_RATE;
+    const double output_latency = 0.01;
+
+    // stream time and porttime count from different starts
+    const double stream_start = 12.3456789;
+    const double pt_start = 3.7071;
+
+    uint32_t seed = 1;
+    auto uniform = [ & ] { return 0.5 * ( check_noise( &seed ) + 1.0f ); };
+
+    limiter_t * l = new limiter_t;
+    limiter_init( l, LIMITER_LOOKAHEAD, SAMPLE_RATE );
+
+    audio_clock_t clock = {};
+    clock.latency = output_latency + AUDIO_MIDI_LATENCY;
+    clock.lookahead = l->lookahead;
+
+    synth_t * s = new synth_t;
+    synth_init( s );
+    std::vector< float > block( 2 * FRAMES_PER_BUFFER );
+
+    // how far from their due frame the events were put, in frames
+    int events = 0;
+    double error_min = 0.0, error_max = 0.0, error_sum = 0.0, error_sq = 0.0;
+
+    // an event every 1 to 5 ms, each forwarded by the midi thread up to a
+    // millisecond after it happened
+    double event = 0.1;
+    double forwarded = event;
+
+    for ( int n = 0; n < CHECK_JITTER_CALLBACKS; n++ ) {
+        // callbacks run up to half a period after their slot, but their
+        // first frame always reaches the dac the output latency after it
+        double start = n * period + 0.5 * period * uniform();
+
+        // everything forwarded before the callback started is mapped on
+        // the anchor of the one before
+        while ( forwarded < start ) {
+            double pt_now = floor( ( forwarded + pt_start ) * 1e3 ) / 1e3;
+            double offset = forwarded + stream_start - pt_now;
+            int timestamp = (int) floor( ( event + pt_start ) * 1e3 );
+
+            synth_command_t c;
+            c.type = synth_command_t::MIDI_BEND;
+            c.value = 0x2000;
+            c.frame = audio_schedule_frame( &clock, timestamp, offset );
+            synth_send( s, c );
+
+            // frame 0 reached the dac the output latency after stream
+            // start, and every frame the lookahead after it was rendered
+            double heard = output_latency +
+                           (double) ( c.frame + clock.lookahead ) / SAMPLE_RATE;
+            double due = event + clock.latency;
+            double error = ( heard - due ) * SAMPLE_RATE;
+            error_min = events ? std::min( error_min, error ) : error;
+            error_max = events ? std::max( error_max, error ) : error;
+            error_sum += error;
+            error_sq += error * error;
+            events++;
+
+            event += 0.001 + 0.004 * uniform();
+            forwarded = event + 0.001 * uniform();
+        }
+
+        clock.anchor_frame = s->frame;
+        clock.anchor_dac_time = stream_start + n * period + output_latency;
+        synth_render( s, block.data(), FRAMES_PER_BUFFER );
+    }
+
+    double mean = error_sum / events;
+    double deviation = sqrt( std::max( error_sq / events - mean * mean, 0.0 ) );
+
+    INFO_LOG(
+        "%d events over %.0f s, %lld applied, %lld - %lld frames late",
+        events,
+        CHECK_JITTER_CALLBACKS * period,
+        (long long) s->timing.count,
+        (long long) s->timing.late_min,
+        (long long) s->timing.late_max
+    );
+    INFO_LOG(
+        "heard %.1f to %.1f frames from their due time, mean %.2f, "
+        "deviation %.2f frames",
+        error_min,
+        error_max,
+        mean,
+        deviation
+    );
+
+    // porttime's whole milliseconds put events up to one early, and until
+    // the offset between the clocks settles up to one late; rounding to the
+    // frame adds half a frame either way
+    const double bound = 0.001 * SAMPLE_RATE + 0.5;
+    bool ok = s->timing.count == events && s->timing.late_min == 0 &&
+              s->timing.late_max == 0 && error_min >= -bound &&
+              error_max <= bound;
+
+    synth_destroy( s );
+    delete s;
+    delete l;
+
+    return ok ? 0 : 1;
+}
+
+int offline_check_load()
+{
+    const int64_t budget_ns =
+        (int64_t) FRAMES_PER_BUFFER * 1000000000 / SAMPLE_RATE;
+
+    // callbacks taking every tenth of the budget from none to two and a
+    // half times it, with the odd xrun flagged; no stream ran in this
+    // process, so the statistics start out at zero
+    audio_load_t want = {};
+    int64_t busy_sum = 0, busy_max = 0;
+
+    for ( int i = 0; i < CHECK_LOAD_CALLBACKS; i++ ) {
+        int tenths = i % 25;
+        int64_t busy_ns = tenths * budget_ns / 10 + budget_ns / 20;
+
+        unsigned long flags = 0;
+        if ( i % 7 == 3 ) flags |= paOutputUnderflow;
+        if ( i % 11 == 5 ) flags |= paOutputOverflow;
+        if ( i < 3 ) flags |= paPrimingOutput;
+
+        audio_record_callback( busy_ns, FRAMES_PER_BUFFER, flags );
+
+        want.callbacks++;
+        want.underflows += !!( flags & paOutputUnderflow );
+        want.overflows += !!( flags & paOutputOverflow );
+        want.priming += !!( flags & paPrimingOutput );
+        want.histogram[ std::min( tenths, AUDIO_LOAD_BINS - 1 ) ]++;
+        busy_sum += busy_ns;
+        busy_max = std::max( busy_max, busy_ns );
+    }
+
+    want.load_avg = (float) busy_sum / ( budget_ns * CHECK_LOAD_CALLBACKS );
+    want.load_max = (float) busy_max / budget_ns;
+
+    audio_load_t load;
+    audio_get_load( &load );
+
+    bool ok = load.callbacks == want.callbacks &&
+              load.underflows == want.underflows &&
+              load.overflows == want.overflows &&
+              load.priming == want.priming &&
+              fabsf( load.load_avg - want.load_avg ) < 1e-5f &&
+              fabsf( load.load_max - want.load_max ) < 1e-5f;
+    for ( int i = 0; i < AUDIO_LOAD_BINS; i++ ) {
+        ok = ok && load.histogram[ i ] == want.histogram[ i ];
+    }
+
+    INFO_LOG(
+        "%d callbacks, %d underflows, %d overflows, %d priming, "
+        "load %.3f average, %.3f max: %s",
+        load.callbacks,
+        load.underflows,
+        load.overflows,
+        load.priming,
+        load.load_avg,
+        load.load_max,
+        ok ? "as counted" : "NOT as counted"
+    );
+
+    // what the callback spends on its own measurement, the two clock reads
+    // and the counting
+    double ns = check_time( [ & ] {
+        auto start = std::chrono::steady_clock::now();
+        auto end = std::chrono::steady_clock::now();
+        int64_t busy_ns =
+            std::chrono::duration_cast< std::chrono::nanoseconds >(
+                end - start
+            ).count();
+        audio_record_callback( busy_ns, FRAMES_PER_BUFFER, 0 );
+    } );
+
+    INFO_LOG(
+        "instrumentation %.0f ns per callback, %.3f%% of the budget",
+        ns,
+        100.0 * ns / budget_ns
+    );
+
+    return ok ? 0 : 1;
+}
+
+typedef void ( *check_vcf_kernel_t )(
+    f32x4 * buf,
+    int frames,
+    float * const * state,
+    const vcf_coef_t & from,
+    const vcf_coef_t & to
+);
+
+static const check_vcf_kernel_t check_vcf_kernels[ VCF_MODE_COUNT ] = {
+    vcf_block< VCF_ONE_POLE >,
+    vcf_block< VCF_SVF >,
+    vcf_block< VCF_LADDER >,
+};
+
+/// poles of each filter mode
+static const int check_vcf_poles[ VCF_MODE_COUNT ] = { 1, 2, 4 };
+
+/// impulse response of a filter with fixed coefficients, in the first lane
+static void check_vcf_response(
+    int mode,
+    const vcf_coef_t & coef,
+    std::vector< float > & response
+)
+{
+    SIMD_ALIGN float state[ VCF_STATE_COUNT ][ SIMD_LANES ] = {};
+    float * const lanes[ VCF_STATE_COUNT ] = {
+        state[ 0 ],
+        state[ 1 ],
+        state[ 2 ],
+        state[ 3 ],
+    };
+
+    f32x4 buf[ FRAMES_PER_BUFFER ];
+    SIMD_ALIGN float x[ SIMD_LANES ];
+
+    response.resize( CHECK_VCF_FRAMES );
+    for ( int done = 0; done < CHECK_VCF_FRAMES; done += FRAMES_PER_BUFFER ) {
+        for ( int i = 0; i < FRAMES_PER_BUFFER; i++ ) {
+            buf[ i ] = f32x4_set1( done + i == 0 ? 1.0f : 0.0f );
+        }
+
+        check_vcf_kernels[ mode ]( buf, FRAMES_PER_BUFFER, lanes, coef, coef );
+
+        for ( int i = 0; i < FRAMES_PER_BUFFER; i++ ) {
+            f32x4_store( x, buf[ i ] );
+            response[ done + i ] = x[ 0 ];
+        }
+    }
+}
+
+/// gain of an impulse response at freq, in dB
+static double check_vcf_gain(
+    const std::vector< float > & response,
+    double freq
+)
+{
+    std::complex< double > sum = 0.0;
+    for ( size_t n = 0; n < response.size(); n++ ) {
+        double w = -2.0 * M_PI * freq / SAMPLE_RATE * n;
+        sum += std::polar( (double) response[ n ], w );
+    }
+
+    return 20.0 * log10( std::abs( sum ) );
+}
+
+/// gain of the analog prototype of a mode at the prewarped frequency, in dB;
+/// the trapezoidal filters match it exactly
+static double check_vcf_expected(
+    int mode,
+    double cutoff,
+    double resonance,
+    double freq
+)
+{
+    double w = tan( M_PI * freq / SAMPLE_RATE ) /
+               tan( M_PI * cutoff / SAMPLE_RATE );
+    std::complex< double > s( 0.0, w );
+    std::complex< double > h;
+
+    if ( mode == VCF_ONE_POLE ) {
+        h = 1.0 / ( 1.0 + s );
+    } else if ( mode == VCF_SVF ) {
+        double k = 2.0 - 1.96 * resonance;
+        h = 1.0 / ( s * s + k * s + 1.0 );
+    } else {
+        double k = 3.9 * resonance;
+        h = ( 1.0 + k ) / ( std::pow( 1.0 + s, 4 ) + k );
+    }
+
+    return 20.0 * log10( std::abs( h ) );
+}
+
+int offline_check_vcf()
+{
+    static const float cutoffs[] = { 100.0f, 1000.0f, 5000.0f };
+    static const float resonances[] = { 0.0f, 0.5f, 0.9f };
+
+    // the analog gain at the cutoff with no resonance
+    static const double at_cutoff[ VCF_MODE_COUNT ] = {
+        -3.0103,
+        -6.0206,
+        -12.0412,
+    };
+
+    std::vector< float > response;
+    bool ok = true;
+
+    for ( int mode = 0; mode < VCF_MODE_COUNT; mode++ ) {
+        // the shape against the prototype, an octave apart from 25 Hz up
+        double error = 0.0;
+        for ( float cutoff : cutoffs ) {
+            for ( float resonance : resonances ) {
+                vcf_coef_t coef = vcf_coef( cutoff, resonance, SAMPLE_RATE );
+                check_vcf_response( mode, coef, response );
+
+                // far enough down single precision rounding is all
+                // that is left
+                for ( double f = 25.0; f < 0.45 * SAMPLE_RATE; f *= 2.0 ) {
+                    double want =
+                        check_vcf_expected( mode, cutoff, resonance, f );
+                    if ( want < CHECK_VCF_FLOOR ) continue;
+
+                    double gain = check_vcf_gain( response, f );
+                    error = std::max( error, fabs( gain - want ) );
+                }
+            }
+        }
+
+        // the gain at the cutoff, and the slope well above a low one where
+        // the prewarping hardly bends it
+        const float cutoff = 100.0f;
+        vcf_coef_t coef = vcf_coef( cutoff, 0.0f, SAMPLE_RATE );
+        check_vcf_response( mode, coef, response );
+        double gain = check_vcf_gain( response, cutoff );
+        double slope = check_vcf_gain( response, 16 * cutoff ) -
+                       check_vcf_gain( response, 8 * cutoff );
+        double want_slope = -6.0206 * check_vcf_poles[ mode ];
+
+        // the cost of one voice's sample
+        f32x4 buf[ FRAMES_PER_BUFFER ] = {};
+        SIMD_ALIGN float state[ VCF_STATE_COUNT ][ SIMD_LANES ] = {};
+        float * const lanes[ VCF_STATE_COUNT ] = {
+            state[ 0 ],
+            state[ 1 ],
+            state[ 2 ],
+            state[ 3 ],
+        };
+        double ns = check_time( [ & ] {
+            check_vcf_kernels[ mode ](
+                buf,
+                FRAMES_PER_BUFFER,
+                lanes,
+                coef,
+                coef
+            );
+        } );
+
+        INFO_LOG(
+            "mode %d: %.2f dB at the cutoff, %.2f dB per octave, "
+            "%.4f dB off the prototype, %.2f ns per voice per frame",
+            mode,
+            gain,
+            slope,
+            error,
+            ns / ( FRAMES_PER_BUFFER * SIMD_LANES )
+        );
+
+        ok = ok && error < CHECK_VCF_TOLERANCE &&
+             fabs( gain - at_cutoff[ mode ] ) < CHECK_VCF_TOLERANCE &&
+             fabs( slope - want_slope ) < CHECK_VCF_SLOPE;
+    }
+
+    // the mode and the mapped controllers reach the filter
+    synth_t * s = new synth_t;
+    synth_init( s );
+
+    synth_command_t c;
+    c.frame = 0;
+    c.type = synth_command_t::SET_PARAM;
+    c.param = synth_param_find( "vcf_mode" );
+    c.amount = VCF_LADDER;
+    synth_send( s, c );
+    c.type = synth_command_t::MIDI_CONTROL;
+    c.param = 74;
+    c.value = 0x7f;
+    synth_send( s, c );
+    c.param = 71;
+    c.value = 0;
+    synth_send( s, c );
+
+    std::vector< float > block( 2 * FRAMES_PER_BUFFER );
+    synth_render( s, block.data(), FRAMES_PER_BUFFER );
+
+    bool routed = s->kernel.vcf_mode == VCF_LADDER &&
+                  s->vcf.cutoff == 20000.0f && s->vcf.resonance == 0.0f;
+    INFO_LOG(
+        "vcf_mode, cc 74 and cc 71 %s",
+        routed ? "reach the filter" : "do NOT reach the filter"
+    );
+    ok = ok && routed;
+
+    synth_destroy( s );
+    delete s;
+
+    return ok ? 0 : 1;
+}
+
+/// renders a frame at a time while the first voice stays in stage and keeps
+/// its envelope, including the frame it left the stage on
+static void check_eg_stage(
+    synth_t * s,
+    int stage,
+    std::vector< double > & trace
+)
+{
+    float frame[ 2 ];
+    trace.clear();
+
+    do {
+        synth_render( s, frame, 1 );
+        trace.push_back( s->voice.eg_out[ 0 ] );
+    } while ( s->voice.count > 0 && s->voice.eg_stage[ 0 ] == stage &&
+              trace.size() < OFFLINE_MAX_TAIL );
+}
+
+/// compares a segment from start to limit with the exponential it should
+/// follow, one that covers distance in seconds heading for limit +
+/// overshoot; returns the length error relative to the expected length
+static double check_eg_segment(
+    const std::vector< double > & trace,
+    double start,
+    double limit,
+    double overshoot,
+    double distance,
+    double seconds,
+    double * level_error
+)
+{
+    double target = limit + overshoot;
+    double rate = log( fabs( overshoot ) / ( distance + fabs( overshoot ) ) ) /
+                  ( seconds * SAMPLE_RATE );
+    double frames = log( fabs( overshoot / ( start - target ) ) ) / rate;
+
+    // the last frame is clamped to the limit
+    for ( size_t n = 0; n + 1 < trace.size(); n++ ) {
+        double want = target + ( start - target ) * exp( rate * ( n + 1 ) );
+        *level_error = std::max( *level_error, fabs( trace[ n ] - want ) );
+    }
+
+    double error = fabs( trace.size() - frames );
+    return error <= 1.0 ? 0.0 : error / frames;
+}
+
+int offline_check_eg()
+{
+    // attack, decay, sustain and release
+    static const float settings[][ 4 ] = {
+        { 0.005f, 0.05f, 0.5f, 0.1f },
+        { 0.05f, 0.2f, 0.25f, 0.3f },
+        { 0.5f, 1.0f, 0.7f, 2.0f },
+    };
+
+    synth_t * s = new synth_t;
+    std::vector< double > trace;
+    bool ok = true;
+
+    for ( const auto & setting : settings ) {
+        const float sustain = setting[ 2 ];
+
+        synth_init( s );
+        check_set( s, "attack", setting[ 0 ] );
+        check_set( s, "decay", setting[ 1 ] );
+        check_set( s, "sustain", sustain );
+        check_set( s, "release", setting[ 3 ] );
+        check_note( s, CHECK_NOTE );
+
+        double level = 0.0;
+        double length[ 3 ];
+        bool reached = true;
+
+        check_eg_stage( s, EG_ATTACK, trace );
+        length[ 0 ] = check_eg_segment(
+            trace,
+            0.0,
+            1.0,
+            EG_ATTACK_OVERSHOOT,
+            1.0,
+            setting[ 0 ],
+            &level
+        );
+        reached = reached && trace.back() == 1.0;
+
+        check_eg_stage( s, EG_DECAY, trace );
+        length[ 1 ] = check_eg_segment(
+            trace,
+            1.0,
+            sustain,
+            -EG_RELEASE_OVERSHOOT,
+            1.0 - sustain,
+            setting[ 1 ],
+            &level
+        );
+        reached = reached && trace.back() == sustain &&
+                  s->voice.eg_stage[ 0 ] == EG_SUSTAIN;
+
+        synth_command_t c;
+        c.type = synth_command_t::MIDI_STOP;
+        c.value = CHECK_NOTE;
+        c.frame = 0;
+        synth_send( s, c );
+
+        // release is timed from full scale, it starts at the sustain level
+        check_eg_stage( s, EG_RELEASE, trace );
+        length[ 2 ] = check_eg_segment(
+            trace,
+            sustain,
+            0.0,
+            -EG_RELEASE_OVERSHOOT,
+            1.0,
+            setting[ 3 ],
+            &level
+        );
+        reached = reached && s->voice.count == 0;
+
+        INFO_LOG(
+            "a %.3f d %.3f s %.2f r %.3f: lengths off by %.2f%%, %.2f%%, "
+            "%.2f%%, level by %.1e%s",
+            setting[ 0 ],
+            setting[ 1 ],
+            sustain,
+            setting[ 3 ],
+            100.0 * length[ 0 ],
+            100.0 * length[ 1 ],
+            100.0 * length[ 2 ],
+            level,
+            reached ? "" : ", a target was NOT reached"
+        );
+
+        ok = ok && reached && level < CHECK_EG_LEVEL;
+        for ( double error : length ) ok = ok && error < CHECK_EG_TOLERANCE;
+
+        synth_destroy( s );
+    }
+
+    // a full pool of voices that stay in their attack, and the same voices
+    // once they have been released and freed
+    std::vector< float > block( 2 * FRAMES_PER_BUFFER );
+
+    synth_init( s );
+    check_set( s, "attack", 10.0f );
+    check_set( s, "release", 0.001f );
+    for ( int i = 0; i < VOICE_COUNT; i++ ) check_note( s, CHECK_NOTE + i );
+    synth_render( s, block.data(), FRAMES_PER_BUFFER );
+
+    double held = check_time( [ & ] {
+        synth_render( s, block.data(), FRAMES_PER_BUFFER );
+    } );
+    ok = ok && s->voice.count == VOICE_COUNT;
+
+    for ( int i = 0; i < VOICE_COUNT; i++ ) {
+        synth_command_t c;
+        c.type = synth_command_t::MIDI_STOP;
+        c.value = CHECK_NOTE + i;
+        c.frame = 0;
+        synth_send( s, c );
+    }
+    for ( int i = 0; i < 4; i++ ) {
+        synth_render( s, block.data(), FRAMES_PER_BUFFER );
+    }
+
+    double idle = check_time( [ & ] {
+        synth_render( s, block.data(), FRAMES_PER_BUFFER );
+    } );
+
+    INFO_LOG(
+        "%d voices: %.2f ns per voice per frame, %d left after the release "
+        "at %.0f ns per %d frames",
+        VOICE_COUNT,
+        held / ( VOICE_COUNT * FRAMES_PER_BUFFER ),
+        s->voice.count,
+        idle,
+        FRAMES_PER_BUFFER
+    );
+    ok = ok && s->voice.count == 0;
+
+    synth_destroy( s );
+    delete s;
+
+    return ok ? 0 : 1;
+}
+
+/// holds a note for a second and returns how far the first voice's pitch
+/// swung, in semitones, and the filter cutoff, in octaves, seen at the end
+/// of every control block
+static void check_mod_swing(
+    synth_t * s,
+    double * pitch,
+    double * cutoff
+)
+{
+    float block[ 2 * CONTROL_INTERVAL ];
+    check_note( s, CHECK_NOTE );
+
+    uint32_t low_inc = UINT32_MAX, high_inc = 0;
+    double low_cutoff = 1e30, high_cutoff = 0.0;
+
+    for ( int n = 0; n < SAMPLE_RATE; n += CONTROL_INTERVAL ) {
+        synth_render( s, block, CONTROL_INTERVAL );
+
+        uint32_t inc = (uint32_t) s->voice.phase_inc[ 0 ][ 0 ];
+        low_inc = std::min( low_inc, inc );
+        high_inc = std::max( high_inc, inc );
+
+        // back from the one pole gain G = g / ( 1 + g ), g = tan( pi f / fs )
+        double G = s->vcf.coef.G;
+        double f = atan( G / ( 1.0 - G ) ) * SAMPLE_RATE / M_PI;
+        low_cutoff = std::min( low_cutoff, f );
+        high_cutoff = std::max( high_cutoff, f );
+    }
+
+    *pitch = 12.0 * log2( (double) high_inc / low_inc );
+    *cutoff = log2( high_cutoff / low_cutoff );
+}
+
+int offline_check_mod()
+{
+    synth_t * s = new synth_t;
+    double pitch, cutoff;
+    bool ok = true;
+
+    // nothing routed, the mod wheel's slot is at no depth
+    synth_init( s );
+    check_mod_swing( s, &pitch, &cutoff );
+    INFO_LOG(
+        "unrouted: pitch swings %.4f semitones, cutoff %.4f octaves",
+        pitch,
+        cutoff
+    );
+    ok = ok && pitch == 0.0 && cutoff == 0.0;
+    synth_destroy( s );
+
+    // the mod wheel all the way up, lfo 1 on the pitch 4 semitones each way
+    synth_init( s );
+    synth_command_t c;
+    c.type = synth_command_t::MIDI_CONTROL;
+    c.param = 1;
+    c.value = 0x7f;
+    c.frame = 0;
+    synth_send( s, c );
+    check_mod_swing( s, &pitch, &cutoff );
+    INFO_LOG(
+        "mod wheel: pitch swings %.4f semitones, cutoff %.4f octaves",
+        pitch,
+        cutoff
+    );
+    ok = ok && fabs( pitch - 8.0 ) < CHECK_MOD_TOLERANCE && cutoff == 0.0;
+    synth_destroy( s );
+
+    // lfo 2 routed to the cutoff 2 octaves each way by name
+    synth_init( s );
+    check_set( s, "lfo2_rate", 4.0f );
+    check_set( s, "lfo2_wave", LFO_SINE );
+    check_set( s, "mod2_source", MOD_SOURCE_LFO2 );
+    check_set( s, "mod2_dest", MOD_DEST_CUTOFF );
+    check_set( s, "mod2_amount", 2.0f );
+    check_mod_swing( s, &pitch, &cutoff );
+    INFO_LOG(
+        "mod2 lfo2 to cutoff: pitch swings %.4f semitones, cutoff %.4f "
+        "octaves",
+        pitch,
+        cutoff
+    );
+    ok = ok && pitch == 0.0 && fabs( cutoff - 4.0 ) < CHECK_MOD_TOLERANCE;
+    synth_destroy( s );
+
+    delete s;
+
+    // the modulation of one buffer with every slot routed, evaluated once
+    // per control block as the synth does, against once per frame
+    lfo_state_t lfo[ LFO_COUNT ];
+    for ( int i = 0; i < LFO_COUNT; i++ ) lfo_init( &lfo[ i ], i + 1 );
+
+    mod_slot_t slots[ MOD_SLOT_COUNT ];
+    for ( int i = 0; i < MOD_SLOT_COUNT; i++ ) {
+        slots[ i ].source = MOD_SOURCE_LFO1 + i % LFO_COUNT;
+        slots[ i ].dest = i % MOD_DEST_COUNT;
+        slots[ i ].amount = 0.5f;
+    }
+
+    float dest[ MOD_DEST_COUNT ];
+    vcf_coef_t coef;
+    float freq;
+    auto update = [ & ]( int frames ) {
+        float sources[ MOD_SOURCE_COUNT ] = {};
+        for ( int i = 0; i < LFO_COUNT; i++ ) {
+            sources[ MOD_SOURCE_LFO1 + i ] =
+                lfo_advance( &lfo[ i ], 5.0f, LFO_SINE, frames, SAMPLE_RATE );
+        }
+        mod_apply( slots, MOD_SLOT_COUNT, sources, dest );
+
+        float f = 500.0f * exp2f( dest[ MOD_DEST_CUTOFF ] );
+        coef = vcf_coef( f, 0.5f, SAMPLE_RATE );
+        freq = synth_pitch_to_freq( CHECK_NOTE + dest[ MOD_DEST_PITCH ] );
+    };
+
+    double control_rate = check_time( [ & ] {
+        for ( int n = 0; n < FRAMES_PER_BUFFER; n += CONTROL_INTERVAL ) {
+            update( CONTROL_INTERVAL );
+        }
+    } );
+    double audio_rate = check_time( [ & ] {
+        for ( int n = 0; n < FRAMES_PER_BUFFER; n++ ) update( 1 );
+    } );
+
+    INFO_LOG(
+        "%d slots for %d frames: %.0f ns every %d frames, %.0f ns every "
+        "frame (%.1fx)",
+        MOD_SLOT_COUNT,
+        FRAMES_PER_BUFFER,
+        control_rate,
+        CONTROL_INTERVAL,
+        audio_rate,
+        audio_rate / control_rate
+    );
+    ok = ok && isfinite( coef.G ) && isfinite( freq );
+
+    return ok ? 0 : 1;
+}
+
+/// holds a note and renders it through count program changes at the given
+/// frames, keeping the left channel
+static void check_fade_render(
+    synth_t * s,
+    const int * waves,
+    const int * frames,
+    int count,
+    std::vector< float > & out
+)
+{
+    synth_init( s );
+    check_note( s, CHECK_NOTE + 24 );
+    for ( int i = 0; i < count; i++ ) {
+        synth_command_t c;
+        c.type = synth_command_t::MIDI_PROGRAM;
+        c.value = waves[ i ];
+        c.frame = frames[ i ];
+        synth_send( s, c );
+    }
+
+    std::vector< float > block( 2 * CHECK_FADE_FRAMES );
+    synth_render( s, block.data(), CHECK_FADE_FRAMES );
+
+    out.resize( CHECK_FADE_FRAMES );
+    for ( int i = 0; i < CHECK_FADE_FRAMES; i++ ) out[ i ] = block[ 2 * i ];
+}
+
+/// the largest difference between neighbouring frames from first on
+static double check_fade_step( const std::vector< float > & out, int first )
+{
+    double step = 0.0;
+    for ( size_t i = first + 1; i < out.size(); i++ ) {
+        step = std::max( step, fabs( (double) out[ i ] - out[ i - 1 ] ) );
+    }
+    return step;
+}
+
+int offline_check_fade()
+{
+    const int change = CHECK_FADE_FRAMES / 4;
+    const int waves[] = { VCO_BLEP_SAWTOOTH, VCO_TRIANGLE };
+    const int frames[] = { change, change + KERNEL_FADE_FRAMES / 4 };
+
+    synth_t * s = new synth_t;
+    std::vector< float > once, twice;
+    bool ok = true;
+
+    // one change, and a second one a quarter into its crossfade, which
+    // has to wait for the first to finish
+    check_fade_render( s, waves, frames, 1, once );
+    check_fade_render( s, waves, frames, 2, twice );
+    bool switched = s->kernel.vco_wave == VCO_TRIANGLE;
+    synth_destroy( s );
+
+    const int end = change + KERNEL_FADE_FRAMES;
+    bool queued = std::equal( once.begin(), once.begin() + end, twice.begin() );
+
+    double step_once = check_fade_step( once, change );
+    double step_twice = check_fade_step( twice, change );
+    INFO_LOG(
+        "second change %s, %s; largest step %.4f against %.4f for one",
+        queued ? "waits for the first fade" : "CUTS the first fade short",
+        switched ? "then plays" : "then is LOST",
+        step_twice,
+        step_once
+    );
+    ok = ok && queued && switched && step_twice <= step_once;
+
+    // a full pool per buffer, through the one kernel the table picked for
+    // the block and through two while crossfading
+    std::vector< float > block( 2 * FRAMES_PER_BUFFER );
+    for ( int wave = 0; wave < VCO_WAVE_COUNT; wave++ ) {
+        check_pool( s, wave );
+
+        double steady = check_time( [ & ] {
+            synth_render( s, block.data(), FRAMES_PER_BUFFER );
+        } );
+
+        // restart the crossfade before every call
+        double fading = check_time( [ & ] {
+            s->kernel.fade_wave = ( wave + 1 ) % VCO_WAVE_COUNT;
+            s->kernel.fade_mode = s->kernel.vcf_mode;
+            s->kernel.fade_left = KERNEL_FADE_FRAMES;
+            synth_render( s, block.data(), FRAMES_PER_BUFFER );
+        } );
+
+        INFO_LOG(
+            "wave %d: %.2f ns per voice per frame, %.2f crossfading",
+            wave,
+            steady / ( VOICE_COUNT * FRAMES_PER_BUFFER ),
+            fading / ( VOICE_COUNT * FRAMES_PER_BUFFER )
+        );
+
+        synth_destroy( s );
+    }
+
+    delete s;
+
+    return ok ? 0 : 1;
+}
+
+/// plays note on a synth set up by the caller, with the filter open, and
+/// keeps CHECK_BLEP_SIZE frames of the left channel once it has settled;
+/// returns the exact frequency
+static double check_blep_render(
+    synth_t * s,
+    int note,
+    std::vector< float > & out
+)
+{
+    check_set( s, "cutoff", 20000.0f );
+    check_set( s, "attack", 0.001f );
+    check_note( s, note );
+
+    std::vector< float > block( 2 * CHECK_BLEP_SIZE );
+    synth_render( s, block.data(), CHECK_BLEP_SETTLE );
+    synth_render( s, block.data(), CHECK_BLEP_SIZE );
+
+    out.resize( CHECK_BLEP_SIZE );
+    for ( int i = 0; i < CHECK_BLEP_SIZE; i++ ) out[ i ] = block[ 2 * i ];
+
+    uint32_t inc = (uint32_t) s->voice.phase_inc[ 0 ][ 0 ];
+    synth_destroy( s );
+
+    return inc * (double) SAMPLE_RATE / 4294967296.0;
+}
+
+/// power in every bin of out under a 4 term blackman-harris window, whose
+/// side lobes are 92 dB down
+static void check_blep_power(
+    fft_real_plan_t * plan,
+    const std::vector< float > & out,
+    std::vector< double > & power
+)
+{
+    const int size = CHECK_BLEP_SIZE;
+    std::vector< float > in( size ), re( size / 2 ), im( size / 2 );
+    for ( int i = 0; i < size; i++ ) {
+        double x = 2.0 * M_PI * i / size;
+        double w = 0.35875 - 0.48829 * cos( x ) + 0.14128 * cos( 2 * x ) -
+                   0.01168 * cos( 3 * x );
+        in[ i ] = (float) ( out[ i ] * w );
+    }
+
+    fft_real_forward( plan, in.data(), re.data(), im.data() );
+
+    // the triangle is -| 2t - 1 | and sits on a dc of -0.5, which is left
+    // out with the window's lobe around it and the nyquist bin packed in
+    power.assign( size / 2, 0.0 );
+    for ( int k = CHECK_BLEP_BINS + 1; k < size / 2; k++ ) {
+        power[ k ] = (double) re[ k ] * re[ k ] + (double) im[ k ] * im[ k ];
+    }
+}
+
+/// power within CHECK_BLEP_BINS of harmonic h of f0, and the bins a lower
+/// harmonic has taken already are counted there
+static double check_blep_harmonic(
+    const std::vector< double > & power,
+    double f0,
+    int h,
+    std::vector< bool > & taken
+)
+{
+    const int size = CHECK_BLEP_SIZE;
+    int center = (int) lround( h * f0 * size / SAMPLE_RATE );
+
+    double sum = 0.0;
+    for ( int k = center - CHECK_BLEP_BINS; k <= center + CHECK_BLEP_BINS;
+          k++ ) {
+        if ( k < 1 || k >= (int) power.size() || taken[ k ] ) continue;
+        sum += power[ k ];
+        taken[ k ] = true;
+    }
+    return sum;
+}
+
+/// power in everything but the harmonics of f0 below band Hz against the
+/// harmonics, in dB, which for an oscillator is its aliasing
+static double check_blep_alias(
+    fft_real_plan_t * plan,
+    const std::vector< float > & out,
+    double f0,
+    double band
+)
+{
+    std::vector< double > power;
+    check_blep_power( plan, out, power );
+    power.resize( (size_t) ( band * CHECK_BLEP_SIZE / SAMPLE_RATE ) );
+
+    std::vector< bool > taken( power.size() );
+    double harmonics = 0.0, total = 0.0;
+    for ( int h = 1; h * f0 < band; h++ ) {
+        harmonics += check_blep_harmonic( power, f0, h, taken );
+    }
+    for ( double p : power ) total += p;
+
+    return 10.0 * log10( std::max( total - harmonics, 1e-30 ) / harmonics );
+}
+
+int offline_check_blep()
+{
+    static const int notes[] = { 72, 96 };
+
+    // the same shapes from the tables and from the polynomials
+    static const struct {
+        const char * name;
+        int table;
+        int blep;
+    } pairs[] = {
+        { "sawtooth", VCO_SAWTOOTH, VCO_BLEP_SAWTOOTH },
+        { "triangle", VCO_TRIANGLE, VCO_BLEP_TRIANGLE },
+        { "pulse", -1, VCO_BLEP_PULSE },
+    };
+
+    fft_real_plan_t plan;
+    if ( fft_real_plan_init( &plan, CHECK_BLEP_SIZE ) ) return 1;
+
+    synth_t * s = new synth_t;
+    std::vector< float > out;
+    std::vector< double > power;
+    bool ok = true;
+
+    auto alias = [ & ]( int wave, int note ) {
+        synth_init( s );
+        check_set( s, "vco_wave", wave );
+        double f0 = check_blep_render( s, note, out );
+        return check_blep_alias( &plan, out, f0, 0.5 * SAMPLE_RATE );
+    };
+
+    for ( const auto & pair : pairs ) {
+        for ( int note : notes ) {
+            double blep = alias( pair.blep, note );
+            ok = ok && blep < CHECK_BLEP_ALIAS;
+
+            if ( pair.table < 0 ) {
+                INFO_LOG(
+                    "%s note %d: aliasing %.1f dB with blep",
+                    pair.name,
+                    note,
+                    blep
+                );
+                continue;
+            }
+
+            double table = alias( pair.table, note );
+            ok = ok && table < CHECK_BLEP_TABLE_ALIAS;
+            INFO_LOG(
+                "%s note %d: aliasing %.1f dB from the table, %.1f dB with "
+                "blep",
+                pair.name,
+                note,
+                table,
+                blep
+            );
+        }
+    }
+
+    // a pulse a quarter of a cycle wide has no 4th harmonic
+    synth_init( s );
+    check_set( s, "vco_wave", VCO_BLEP_PULSE );
+    check_set( s, "pulse_width", 0.25f );
+    double f0 = check_blep_render( s, CHECK_NOTE + 12, out );
+    check_blep_power( &plan, out, power );
+    std::vector< bool > taken( CHECK_BLEP_SIZE / 2 );
+    double first = check_blep_harmonic( power, f0, 1, taken );
+    double fourth = check_blep_harmonic( power, f0, 4, taken );
+    double null = 10.0 * log10( fourth / first );
+    INFO_LOG( "pulse width 0.25: 4th harmonic %.1f dB below the 1st", -null );
+    ok = ok && null < CHECK_BLEP_NULL;
+
+    fft_real_plan_free( &plan );
+
+    // the cost of a full pool on every waveform
+    std::vector< float > block( 2 * FRAMES_PER_BUFFER );
+    for ( int wave = 0; wave < VCO_WAVE_COUNT; wave++ ) {
+        check_pool( s, wave );
+        double ns = check_time( [ & ] {
+            synth_render( s, block.data(), FRAMES_PER_BUFFER );
+        } );
+        INFO_LOG(
+            "wave %d: %.2f ns per voice per frame",
+            wave,
+            ns / ( VOICE_COUNT * FRAMES_PER_BUFFER )
+        );
+        synth_destroy( s );
+    }
+
+    delete s;
+
+    return ok ? 0 : 1;
+}
+
+int offline_check_oversample()
+{
+    static const int factors[] = { 1, 2, 4 };
+    static const int notes[] = { 84, 96 };
+
+    fft_real_plan_t plan;
+    if ( fft_real_plan_init( &plan, CHECK_BLEP_SIZE ) ) return 1;
+
+    synth_t * s = new synth_t;
+    std::vector< float > out;
+    bool ok = true;
+
+    // a sine driven into the saturation, whose harmonics go on far past
+    // nyquist and fold back unless the stage runs oversampled
+    for ( int note : notes ) {
+        double alias[ 3 ];
+        for ( int i = 0; i < 3; i++ ) {
+            synth_init( s );
+            check_set( s, "vco_wave", VCO_SINE );
+            check_set( s, "drive", CHECK_OVERSAMPLE_DRIVE );
+            check_set( s, "oversample", factors[ i ] );
+            double f0 = check_blep_render( s, note, out );
+            alias[ i ] =
+                check_blep_alias( &plan, out, f0, CHECK_OVERSAMPLE_BAND );
+        }
+
+        INFO_LOG(
+            "note %d driven %.0fx: aliasing %.1f dB at 1x, %.1f dB at 2x, "
+            "%.1f dB at 4x",
+            note,
+            CHECK_OVERSAMPLE_DRIVE,
+            alias[ 0 ],
+            alias[ 1 ],
+            alias[ 2 ]
+        );
+        ok = ok && alias[ 1 ] < alias[ 0 ] &&
+             alias[ 2 ] < alias[ 1 ] + CHECK_OVERSAMPLE_FLOOR &&
+             alias[ 2 ] < CHECK_OVERSAMPLE_ALIAS;
+    }
+
+    fft_real_plan_free( &plan );
+
+    // what the stage adds to a buffer of one note, per frame of both
+    // channels
+    std::vector< float > block( 2 * FRAMES_PER_BUFFER );
+    auto time = [ & ]( float drive, int factor ) {
+        synth_init( s );
+        check_set( s, "drive", drive );
+        check_set( s, "oversample", factor );
+        check_note( s, CHECK_NOTE );
+        synth_render( s, block.data(), FRAMES_PER_BUFFER );
+
+        double ns = check_time( [ & ] {
+            synth_render( s, block.data(), FRAMES_PER_BUFFER );
+        } );
+        ok = ok && s->drive.oversample == factor;
+        synth_destroy( s );
+
+        return ns / FRAMES_PER_BUFFER;
+    };
+
+    double bypassed = time( 0.0f, 1 );
+    for ( int factor : factors ) {
+        double ns = time( CHECK_OVERSAMPLE_DRIVE, factor );
+        INFO_LOG(
+            "%dx: %.2f ns per frame over the %.2f ns bypassed",
+            factor,
+            ns - bypassed,
+            bypassed
+        );
+    }
+
+    delete s;
+
+    return ok ? 0 : 1;
+}
+
+/// holds a sawtooth note on count detuned oscillators spread by spread and
+/// returns the level of the mix in dB and the correlation of left and right
+static void check_unison_render(
+    synth_t * s,
+    int note,
+    int count,
+    float spread,
+    double * level,
+    double * correlation
+)
+{
+    synth_init( s );
+    check_set( s, "vco_wave", VCO_SAWTOOTH );
+    check_set( s, "cutoff", 20000.0f );
+    check_set( s, "attack", 0.001f );
+    check_set( s, "unison", count );
+    check_set( s, "spread", spread );
+    check_note( s, note );
+
+    std::vector< float > out( 2 * CHECK_UNISON_FRAMES );
+    synth_render( s, out.data(), CHECK_BLEP_SETTLE );
+    synth_render( s, out.data(), CHECK_UNISON_FRAMES );
+    synth_destroy( s );
+
+    // around the means, the triangle is not the only shape with a dc
+    double mean[ 2 ] = {};
+    for ( int i = 0; i < CHECK_UNISON_FRAMES; i++ ) {
+        mean[ 0 ] += out[ 2 * i ];
+        mean[ 1 ] += out[ 2 * i + 1 ];
+    }
+    mean[ 0 ] /= CHECK_UNISON_FRAMES;
+    mean[ 1 ] /= CHECK_UNISON_FRAMES;
+
+    double ll = 0.0, rr = 0.0, lr = 0.0;
+    for ( int i = 0; i < CHECK_UNISON_FRAMES; i++ ) {
+        double l = out[ 2 * i ] - mean[ 0 ];
+        double r = out[ 2 * i + 1 ] - mean[ 1 ];
+        ll += l * l;
+        rr += r * r;
+        lr += l * r;
+    }
+
+    *level = 10.0 * log10( ( ll + rr ) / ( 2.0 * CHECK_UNISON_FRAMES ) );
+    *correlation = lr / sqrt( ll * rr );
+}
+
+int offline_check_unison()
+{
+    static const int notes[] = { CHECK_NOTE + 4, CHECK_NOTE + 24 };
+    static const float spreads[] = { 0.0f, 0.5f, 1.0f };
+
+    synth_t * s = new synth_t;
+    double level, correlation;
+    bool ok = true;
+
+    // equal power over the stack, the oscillators start at unrelated phases
+    // and drift apart, so the level stays that of one
+    for ( int note : notes ) {
+        double single;
+        check_unison_render( s, note, 1, 0.0f, &single, &correlation );
+        for ( int count = 2; count <= UNISON_MAX; count *= 2 ) {
+            check_unison_render( s, note, count, 0.0f, &level, &correlation );
+            INFO_LOG(
+                "note %d on %2d oscillators: level %+.2f dB against one",
+                note,
+                count,
+                level - single
+            );
+            ok = ok && fabs( level - single ) < CHECK_UNISON_LEVEL;
+        }
+    }
+
+    // mono without spread, and wider the more of it there is
+    double last = 2.0;
+    for ( float spread : spreads ) {
+        check_unison_render(
+            s,
+            CHECK_NOTE + 24,
+            8,
+            spread,
+            &level,
+            &correlation
+        );
+        INFO_LOG(
+            "8 oscillators, spread %.1f: left and right correlate %.4f",
+            spread,
+            correlation
+        );
+        ok = ok && correlation < last;
+        if ( spread == 0.0f ) ok = ok && correlation > 0.9999;
+        last = correlation;
+    }
+
+    // a full pool on ever wider stacks, mono and spread, against the
+    // buffer's time
+    const double budget = 1e9 * FRAMES_PER_BUFFER / SAMPLE_RATE;
+    std::vector< float > block( 2 * FRAMES_PER_BUFFER );
+    for ( int count = 1; count <= UNISON_MAX; count *= 2 ) {
+        double ns[ 2 ];
+        for ( int stereo = 0; stereo < 2; stereo++ ) {
+            check_pool( s, VCO_SAWTOOTH );
+            check_set( s, "unison", count );
+            check_set( s, "spread", stereo ? 1.0f : 0.0f );
+            synth_render( s, block.data(), FRAMES_PER_BUFFER );
+
+            ns[ stereo ] = check_time( [ & ] {
+                synth_render( s, block.data(), FRAMES_PER_BUFFER );
+            } );
+            synth_destroy( s );
+        }
+
+        const double oscillators = (double) VOICE_COUNT * count;
+        INFO_LOG(
+            "%2d x %d voices: %.2f ns per oscillator per frame mono, %.2f "
+            "spread, %.0f%% of the buffer",
+            count,
+            VOICE_COUNT,
+            ns[ 0 ] / ( oscillators * FRAMES_PER_BUFFER ),
+            ns[ 1 ] / ( oscillators * FRAMES_PER_BUFFER ),
+            100.0 * ns[ 1 ] / budget
+        );
+    }
+
+    delete s;
+
+    return ok ? 0 : 1;
+}
+
+/// runs the two channels of in through an effect in buffers of
+/// FRAMES_PER_BUFFER frames, the way the callback would
+template < typename F >
+static void check_delay_run( std::vector< float > * in, F process )
+{
+    const int size = (int) in[ 0 ].size();
+    for ( int i = 0; i < size; i += FRAMES_PER_BUFFER ) {
+        float * const io[ 2 ] = { in[ 0 ].data() + i, in[ 1 ].data() + i };
+        process( io, std::min( FRAMES_PER_BUFFER, size - i ) );
+    }
+}
+
+/// where the first repeat of an impulse at frame 0 lands, in samples: the
+/// centroid around the loudest sample, which the interpolation keeps on the
+/// exact fractional delay
+static double check_delay_repeat(
+    const std::vector< float > & out,
+    double * peak
+)
+{
+    size_t loudest = 0;
+    for ( size_t i = 0; i < out.size(); i++ ) {
+        if ( fabsf( out[ i ] ) > fabsf( out[ loudest ] ) ) loudest = i;
+    }
+
+    double sum = 0.0, moment = 0.0;
+    for ( size_t i = loudest - 4; i <= loudest + 4; i++ ) {
+        sum += out[ i ];
+        moment += out[ i ] * (double) i;
+    }
+
+    *peak = sum;
+    return moment / sum;
+}
+
+/// the delay a swept effect applied over a ramp, which it passes through
+/// unchanged but late; the shortest and the longest, in samples
+static void check_delay_sweep(
+    const std::vector< float > * out,
+    double * shortest,
+    double * longest
+)
+{
+    *shortest = 1e30;
+    *longest = 0.0;
+
+    // after the longest delay has filled up with the ramp
+    for ( int c = 0; c < 2; c++ ) {
+        for ( size_t i = SAMPLE_RATE / 10; i < out[ c ].size(); i++ ) {
+            double delay = (double) i - out[ c ][ i ];
+            *shortest = std::min( *shortest, delay );
+            *longest = std::max( *longest, delay );
+        }
+    }
+}
+
+int offline_check_delay()
+{
+    const int frames = CHECK_DELAY_SECONDS * SAMPLE_RATE;
+    std::vector< float > io[ 2 ];
+    bool ok = true;
+
+    // an impulse through the echo with only the repeats mixed in, the right
+    // time off the sample grid
+    echo_t * echo = new echo_t;
+    echo_init( echo, SAMPLE_RATE );
+    echo->time_left = 0.25f;
+    echo->time_right = 0.3333f;
+    echo->feedback = 0.5f;
+    echo->mix = 1.0f;
+
+    for ( int c = 0; c < 2; c++ ) {
+        io[ c ].assign( frames, 0.0f );
+        io[ c ][ 0 ] = 1.0f;
+    }
+    check_delay_run( io, [ & ]( float * const * x, int n ) {
+        echo_process( echo, x, n, SAMPLE_RATE );
+    } );
+
+    const float times[ 2 ] = { echo->time_left, echo->time_right };
+    for ( int c = 0; c < 2; c++ ) {
+        double want = times[ c ] * SAMPLE_RATE;
+        double first, second;
+        double at = check_delay_repeat( io[ c ], &first );
+
+        // the second repeat, feedback times quieter
+        const size_t skip = (size_t) ( 1.5 * want );
+        std::vector< float > rest( io[ c ].begin() + skip, io[ c ].end() );
+        double again = skip + check_delay_repeat( rest, &second );
+
+        INFO_LOG(
+            "echo %s: repeats at %.3f and %.3f samples for %.3f, %.4f "
+            "then %.4f",
+            c ? "right" : "left",
+            at,
+            again,
+            want,
+            first,
+            second
+        );
+        ok = ok && fabs( at - want ) < CHECK_DELAY_TOLERANCE &&
+             fabs( again - 2.0 * want ) < CHECK_DELAY_TOLERANCE &&
+             fabs( first - 1.0 ) < 1e-3 && fabs( second - 0.5 ) < 1e-3;
+    }
+
+    // a ramp through the chorus and the flanger, swept faster than they
+    // would be so the run holds several cycles
+    chorus_t * chorus = new chorus_t;
+    chorus_init( chorus, SAMPLE_RATE );
+    chorus->rate = 2.0f;
+    chorus->delay = 0.015f;
+    chorus->depth = 0.004f;
+    chorus->mix = 1.0f;
+
+    flanger_t * flanger = new flanger_t;
+    flanger_init( flanger, SAMPLE_RATE );
+    flanger->rate = 2.0f;
+    flanger->delay = 0.001f;
+    flanger->depth = 0.004f;
+    flanger->feedback = 0.0f;
+    flanger->mix = 1.0f;
+
+    for ( int swept = 0; swept < 2; swept++ ) {
+        for ( int c = 0; c < 2; c++ ) {
+            io[ c ].resize( frames );
+            for ( int i = 0; i < frames; i++ ) io[ c ][ i ] = (float) i;
+        }
+
+        double low, high;
+        if ( swept == 0 ) {
+            check_delay_run( io, [ & ]( float * const * x, int n ) {
+                chorus_process( chorus, x, n, SAMPLE_RATE );
+            } );
+            low = ( chorus->delay - chorus->depth ) * SAMPLE_RATE;
+            high = ( chorus->delay + chorus->depth ) * SAMPLE_RATE;
+        } else {
+            check_delay_run( io, [ & ]( float * const * x, int n ) {
+                flanger_process( flanger, x, n, SAMPLE_RATE );
+            } );
+            low = flanger->delay * SAMPLE_RATE;
+            high = ( flanger->delay + flanger->depth ) * SAMPLE_RATE;
+        }
+
+        double shortest, longest;
+        check_delay_sweep( io, &shortest, &longest );
+        INFO_LOG(
+            "%s: delay swept %.3f - %.3f samples for %.3f - %.3f",
+            swept ? "flanger" : "chorus",
+            shortest,
+            longest,
+            low,
+            high
+        );
+        ok = ok && fabs( shortest - low ) < CHECK_DELAY_TOLERANCE &&
+             fabs( longest - high ) < CHECK_DELAY_TOLERANCE;
+    }
+
+    // each effect on noise at the callback's block size, and bypassed
+    uint32_t seed = 1;
+    float noise[ 2 ][ FRAMES_PER_BUFFER ];
+    for ( int c = 0; c < 2; c++ ) {
+        for ( int i = 0; i < FRAMES_PER_BUFFER; i++ ) {
+            noise[ c ][ i ] = check_noise( &seed );
+        }
+    }
+    float * const block[ 2 ] = { noise[ 0 ], noise[ 1 ] };
+
+    auto time = [ & ]( const char * name, float * mix, auto process ) {
+        *mix = 0.5f;
+        double on = check_time( process );
+        *mix = 0.0f;
+        double off = check_time( process );
+
+        INFO_LOG(
+            "%s: %.0f ns per %d frames, %.1f ns bypassed",
+            name,
+            on,
+            FRAMES_PER_BUFFER,
+            off
+        );
+    };
+
+    flanger->feedback = 0.6f;
+    time( "echo", &echo->mix, [ & ] {
+        echo_process( echo, block, FRAMES_PER_BUFFER, SAMPLE_RATE );
+    } );
+    time( "chorus", &chorus->mix, [ & ] {
+        chorus_process( chorus, block, FRAMES_PER_BUFFER, SAMPLE_RATE );
+    } );
+    time( "flanger", &flanger->mix, [ & ] {
+        flanger_process( flanger, block, FRAMES_PER_BUFFER, SAMPLE_RATE );
+    } );
+
+    // the parameters reach the effects by name
+    synth_t * s = new synth_t;
+    synth_init( s );
+    check_set( s, "echo_time_left", 0.3f );
+    check_set( s, "chorus_depth", 0.002f );
+    check_set( s, "flanger_feedback", -0.5f );
+    synth_command_t c;
+    c.type = synth_command_t::MIDI_CONTROL;
+    c.param = 93;
+    c.value = 0x7f;
+    c.frame = 0;
+    synth_send( s, c );
+
+    float out[ 2 * FRAMES_PER_BUFFER ];
+    synth_render( s, out, FRAMES_PER_BUFFER );
+
+    bool routed = s->echo.time_left == 0.3f && s->chorus.depth == 0.002f &&
+                  s->flanger.feedback == -0.5f && s->chorus.mix == 1.0f;
+    INFO_LOG(
+        "echo, chorus and flanger parameters and cc 93 %s",
+        routed ? "reach the effects" : "do NOT reach the effects"
+    );
+    ok = ok && routed;
+
+    synth_destroy( s );
+    delete s;
+
+    echo_free( echo );
+    chorus_free( chorus );
+    flanger_free( flanger );
+    delete echo;
+    delete chorus;
+    delete flanger;
+
+    return ok ? 0 : 1;
+}
+
+/// the decay an impulse through the reverb takes to fall by 60 dB in the
+/// octave around CHECK_REVERB_BAND, from the slope of its schroeder integral,
+/// the energy left after every frame
+static double check_reverb_decay( float decay, float damping )
+{
+    reverb_t * r = new reverb_t;
+    reverb_init( r, SAMPLE_RATE );
+    r->decay = decay;
+    r->damping = damping;
+    r->mix = 1.0f;
+
+    const int frames = (int) ( CHECK_REVERB_LENGTH * decay * SAMPLE_RATE );
+    std::vector< float > io[ 2 ];
+    io[ 0 ].assign( frames, 0.0f );
+    io[ 1 ].assign( frames, 0.0f );
+    io[ 0 ][ 0 ] = io[ 1 ][ 0 ] = 1.0f;
+
+    check_delay_run( io, [ & ]( float * const * x, int n ) {
+        reverb_process( r, x, n, SAMPLE_RATE );
+    } );
+
+    reverb_free( r );
+    delete r;
+
+    // one octave bandpass, 0 dB at the band
+    const double w = 2.0 * M_PI * CHECK_REVERB_BAND / SAMPLE_RATE;
+    const double alpha = sin( w ) * sinh( 0.5 * log( 2.0 ) * w / sin( w ) );
+    const double a0 = 1.0 + alpha;
+    const double b0 = alpha / a0;
+    const double a1 = -2.0 * cos( w ) / a0;
+    const double a2 = ( 1.0 - alpha ) / a0;
+
+    std::vector< double > energy( frames, 0.0 );
+    for ( int c = 0; c < 2; c++ ) {
+        double x1 = 0.0, x2 = 0.0, y1 = 0.0, y2 = 0.0;
+        for ( int i = 0; i < frames; i++ ) {
+            double x = io[ c ][ i ];
+            double y = b0 * ( x - x2 ) - a1 * y1 - a2 * y2;
+            x2 = x1;
+            x1 = x;
+            y2 = y1;
+            y1 = y;
+            energy[ i ] += y * y;
+        }
+    }
+
+    std::vector< double > left( frames + 1, 0.0 );
+    for ( int i = frames - 1; i >= 0; i-- ) {
+        left[ i ] = left[ i + 1 ] + energy[ i ];
+    }
+
+    // least squares line through the level between -5 and -35 dB
+    double n = 0.0, st = 0.0, sl = 0.0, stt = 0.0, stl = 0.0;
+    for ( int i = 0; i < frames; i++ ) {
+        double level = 10.0 * log10( left[ i ] / left[ 0 ] );
+        if ( level > -5.0 ) continue;
+        if ( level < -35.0 ) break;
+
+        double t = (double) i / SAMPLE_RATE;
+        n += 1.0;
+        st += t;
+        sl += level;
+        stt += t * t;
+        stl += t * level;
+    }
+
+    double slope = ( n * stl - st * sl ) / ( n * stt - st * st );
+    return -60.0 / slope;
+}
+
+int offline_check_reverb()
+{
+    bool ok = true;
+
+    // the feedback matrix column by column, from every line alone
+    const int vectors = REVERB_LINES / SIMD_LANES;
+    float matrix[ REVERB_LINES ][ REVERB_LINES ];
+    for ( int k = 0; k < REVERB_LINES; k++ ) {
+        SIMD_ALIGN float x[ REVERB_LINES ] = {};
+        x[ k ] = 1.0f;
+
+        f32x4 v[ vectors ];
+        for ( int j = 0; j < vectors; j++ ) {
+            v[ j ] = f32x4_load( x + SIMD_LANES * j );
+        }
+        reverb_mix( v );
+        for ( int j = 0; j < vectors; j++ ) {
+            f32x4_store( x + SIMD_LANES * j, v[ j ] );
+        }
+
+        for ( int j = 0; j < REVERB_LINES; j++ ) matrix[ j ][ k ] = x[ j ];
+    }
+
+    // orthogonal keeps the energy of any vector, and entries all of one
+    // size mean every line feeds every other as much
+    double off = 0.0;
+    double spread = 0.0;
+    for ( int a = 0; a < REVERB_LINES; a++ ) {
+        for ( int b = 0; b < REVERB_LINES; b++ ) {
+            double dot = 0.0;
+            for ( int j = 0; j < REVERB_LINES; j++ ) {
+                dot += (double) matrix[ j ][ a ] * matrix[ j ][ b ];
+            }
+            off = std::max( off, fabs( dot - ( a == b ? 1.0 : 0.0 ) ) );
+            spread = std::max( spread, fabs( fabs( matrix[ a ][ b ] ) -
+                                             1.0 / sqrt( REVERB_LINES ) ) );
+        }
+    }
+
+    bool lossless = off <= CHECK_REVERB_LOSSLESS &&
+                    spread <= CHECK_REVERB_LOSSLESS;
+    INFO_LOG(
+        "feedback matrix: %g off orthogonal, entries %g off 1/%d, %s",
+        off,
+        spread,
+        (int) sqrt( REVERB_LINES ),
+        lossless ? "lossless" : "NOT lossless"
+    );
+    ok = ok && lossless;
+
+    // with the damping open the decay is the one the line gains are set for
+    const float decays[] = { 0.5f, 2.0f, 8.0f };
+    for ( float decay : decays ) {
+        double measured = check_reverb_decay( decay, 20000.0f );
+        bool good = fabs( measured / decay - 1.0 ) <= CHECK_REVERB_TOLERANCE;
+        INFO_LOG(
+            "decay %.1f s: RT60 %.3f s at %.0f Hz%s",
+            decay,
+            measured,
+            CHECK_REVERB_BAND,
+            good ? "" : ", OFF"
+        );
+        ok = ok && good;
+    }
+
+    // the damping takes the band away faster once it comes down near it
+    double damped = check_reverb_decay( 2.0f, 1000.0f );
+    INFO_LOG(
+        "decay 2.0 s damped at 1000 Hz: RT60 %.3f s at %.0f Hz",
+        damped,
+        CHECK_REVERB_BAND
+    );
+
+    // cost of one callback's block, running and bypassed, and the memory
+    reverb_t * r = new reverb_t;
+    reverb_init( r, SAMPLE_RATE );
+
+    float left[ FRAMES_PER_BUFFER ];
+    float right[ FRAMES_PER_BUFFER ];
+    float * const block[ 2 ] = { left, right };
+    uint32_t seed = 1;
+    for ( int i = 0; i < FRAMES_PER_BUFFER; i++ ) {
+        left[ i ] = right[ i ] = check_noise( &seed );
+    }
+
+    r->mix = 0.3f;
+    double on = check_time( [ & ] {
+        reverb_process( r, block, FRAMES_PER_BUFFER, SAMPLE_RATE );
+    } );
+    r->mix = 0.0f;
+    double bypassed = check_time( [ & ] {
+        reverb_process( r, block, FRAMES_PER_BUFFER, SAMPLE_RATE );
+    } );
+
+    INFO_LOG(
+        "reverb: %.0f ns per %d frames, %.1f ns bypassed, %d lines in %d "
+        "bytes",
+        on,
+        FRAMES_PER_BUFFER,
+        bypassed,
+        REVERB_LINES,
+        reverb_memory( r ) + (int) sizeof( reverb_t )
+    );
+
+    reverb_free( r );
+    delete r;
+
+    // the parameters reach the reverb by name, and cc 91
+    synth_t * s = new synth_t;
+    synth_init( s );
+    check_set( s, "reverb_decay", 5.0f );
+    check_set( s, "reverb_damping", 3000.0f );
+    synth_command_t c;
+    c.type = synth_command_t::MIDI_CONTROL;
+    c.param = 91;
+    c.value = 0x7f;
+    c.frame = 0;
+    synth_send( s, c );
+
+    float out[ 2 * FRAMES_PER_BUFFER ];
+    synth_render( s, out, FRAMES_PER_BUFFER );
+
+    bool routed = s->reverb.decay == 5.0f && s->reverb.damping == 3000.0f &&
+                  s->reverb.mix == 1.0f;
+    INFO_LOG(
+        "reverb parameters and cc 91 %s",
+        routed ? "reach the reverb" : "do NOT reach the reverb"
+    );
+    ok = ok && routed;
+
+    synth_destroy( s );
+    delete s;
+
+    return ok ? 0 : 1;
+}
@@ -0,0 +1,105 @@
+#pragma once
+
+/// renders a midi file (.mid / .midi) or a text event list through the synth
+/// as fast as possible and writes the result to a stereo float wav file
+///
+/// event lists have one event per line, "<seconds> <on|off|bend|prog>
+/// <value>", "<seconds> cc [controller] <value>" or "<seconds> set <name>
+/// <value>" for a synth_param_t by name; lines starting with '#' are
+/// ignored; ir_path, if not null, is an impulse response for the convolver
+int offline_render(
+    const char * input_path,
+    const char * output_path,
+    const char * ir_path
+);
+
+/// checks the convolver against direct convolution with the impulse response
+/// at ir_path, or 2 s of decaying noise if it is null, and times it
+int offline_check_convolver( const char * ir_path );
+
+/// checks the fft against a direct dft at every size from 64 to 65536
+/// points and times the complex and the real transforms
+int offline_check_fft();
+
+/// runs a signal with loud sections and spikes through the limiter, checks
+/// that no sample gets past the ceiling, with and without the soft clipper,
+/// and that it only delays a quiet one; times it and reports its latency
+int offline_check_limiter();
+
+/// holds 1 to VOICE_COUNT notes and times the audio callback's block of
+/// frames for each voice count
+int offline_check_voices();
+
+/// renders the event list at events_path, or a built in one if it is null,
+/// through the vector and the scalar build of the synth for every waveform
+/// and filter, checks they agree and times both
+int offline_check_simd( const char * events_path );
+
+/// checks the pitch to frequency conversion against pow() on every cent and
+/// times a block of pitch updates for a full voice pool, per frame with pow()
+/// against once per block through the note table
+int offline_check_pitch();
+
+/// plays every midi note at several pitch wheel positions and checks the
+/// oscillator's phase increment against the exact equal tempered frequency
+int offline_check_tuning();
+
+/// starts a burst of notes on different frames inside one block and checks
+/// that each one is heard first on exactly its frame
+int offline_check_onsets();
+
+/// maps midi timestamps to frames the way the audio callback does, on a
+/// simulated clock with callbacks and the midi thread running late, and
+/// checks every event is applied on time and heard at a constant latency
+int offline_check_jitter();
+
+/// counts synthetic callbacks of known length and status into the load
+/// statistics, checks audio_get_load() reads back the same histogram, load
+/// and xrun counts, and times the instrumentation itself
+int offline_check_load();
+
+/// measures the impulse response of every filter mode against its analog
+/// prototype, the gain at the cutoff and the slope above it, times them,
+/// and checks the mode and the mapped controllers reach the filter
+int offline_check_vcf();
+
+/// runs the envelope through every stage for a few settings and checks each
+/// segment's length and shape against the exponential it should follow,
+/// then times a full pool of voices and checks released ones are freed
+int offline_check_eg();
+
+/// routes the lfos to the pitch and the cutoff through the mod wheel and by
+/// parameter name and checks they swing by the amount set, and not at all
+/// unrouted; times the modulation per control block against per frame
+int offline_check_mod();
+
+/// changes the waveform twice within one crossfade and checks the second
+/// change waits for the first to finish without a jump, then times a full
+/// pool through every waveform's kernel, alone and crossfading
+int offline_check_fade();
+
+/// measures the aliasing of every waveform from the tables and with blep at
+/// two high notes, checks a quarter wide pulse has no 4th harmonic, and
+/// times a full pool on every waveform
+int offline_check_blep();
+
+/// saturates a sine with the drive at 1x, 2x and 4x oversampling, checks
+/// the aliasing falls with every factor and is low at 4x, and times what
+/// the stage costs at each factor
+int offline_check_oversample();
+
+/// checks the level of a note stays the same from 1 to UNISON_MAX detuned
+/// oscillators and that the spread takes left and right apart, and times a
+/// full pool of ever wider stacks per oscillator
+int offline_check_unison();
+
+/// checks an impulse through the echo repeats at its set times and a ramp
+/// through the chorus and the flanger comes out delayed over their set
+/// sweep, times each at the callback's block size and bypassed, and checks
+/// the parameters reach them
+int offline_check_delay();
+
+/// checks the reverb's feedback matrix is lossless and an impulse decays at
+/// the RT60 set, times it at the callback's block size and bypassed, reports
+/// its memory, and checks the parameters reach it
+int offline_check_reverb();
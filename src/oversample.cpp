@@ -0,0 +1,236 @@
+#include "oversample.hpp"
+
+#include <math.h>
+#include <string.h>
+
+#ifndef M_PI
+#define M_PI ( 3.14159265 )
+#endif
+
+/// odd taps of the stage next to the base rate, its transition band sits
+/// around the base nyquist and has to be narrow
+#define HALFBAND_TAPS_FIRST 32
+
+/// odd taps of the second 4x stage, which only has to reject what is left
+/// above 1.5 times the base rate
+#define HALFBAND_TAPS_SECOND 8
+
+/// kaiser window shape, about 90 dB of stopband rejection
+#define HALFBAND_KAISER_BETA 8.5
+
+/// zeroth order modified bessel function, for the kaiser window
+static double bessel_i0( double x )
+{
+    double sum = 1.0;
+    double term = 1.0;
+    for ( int k = 1; k < 32; k++ ) {
+        term *= ( x / ( 2.0 * k ) ) * ( x / ( 2.0 * k ) );
+        sum += term;
+    }
+    return sum;
+}
+
+/// kaiser windowed sinc with its cutoff at half the base rate nyquist
+static void halfband_init( halfband_t * h, int taps )
+{
+    memset( h, 0, sizeof( *h ) );
+    h->taps = taps;
+
+    const int half = taps / 2;
+    const double norm = bessel_i0( HALFBAND_KAISER_BETA );
+
+    double sum = 0.0;
+    double coef[ HALFBAND_MAX_TAPS ];
+    for ( int a = 0; a < taps; a++ ) {
+        // the tap at age a multiplies filter index 2 ( a - half ) + 1
+        int k = 2 * ( a - half ) + 1;
+        double x = (double) k / taps;
+        double w = bessel_i0( HALFBAND_KAISER_BETA * sqrt( 1.0 - x * x ) );
+
+        coef[ a ] = sin( M_PI * k / 2 ) / ( M_PI * k ) * w / norm;
+        sum += coef[ a ];
+    }
+
+    // the odd taps add up to 0.5 for unity gain at dc
+    for ( int a = 0; a < taps; a++ ) {
+        h->coef[ a ] = (float) ( coef[ a ] * 0.5 / sum );
+    }
+}
+
+/// samples a stage takes at once, longer calls are split up
+#define HALFBAND_BLOCK 64
+
+/// the odd taps over the windows starting at x, x + 1, x + 2 and x + 3, so
+/// the lanes are four consecutive outputs
+///
+/// running along time instead of along the taps needs no horizontal sum, and
+/// the four accumulators keep the adds from waiting on each other
+static inline f32x4 halfband_fir( const halfband_t * h, const float * x )
+{
+    f32x4 acc0 = f32x4_zero();
+    f32x4 acc1 = f32x4_zero();
+    f32x4 acc2 = f32x4_zero();
+    f32x4 acc3 = f32x4_zero();
+
+    const float * c = h->coef;
+    for ( int k = 0; k < h->taps; k += 4 ) {
+        acc0 += f32x4_loadu( x + k ) * f32x4_set1( c[ k ] );
+        acc1 += f32x4_loadu( x + k + 1 ) * f32x4_set1( c[ k + 1 ] );
+        acc2 += f32x4_loadu( x + k + 2 ) * f32x4_set1( c[ k + 2 ] );
+        acc3 += f32x4_loadu( x + k + 3 ) * f32x4_set1( c[ k + 3 ] );
+    }
+
+    return ( acc0 + acc1 ) + ( acc2 + acc3 );
+}
+
+/// interpolates up to HALFBAND_BLOCK samples, frames in become 2 frames out
+///
+/// the input is appended to the history in one linear buffer first, the
+/// filter then only reads from it, so no load waits on a store just made
+static void halfband_up(
+    halfband_t * h,
+    const float * in,
+    int frames,
+    float * out
+)
+{
+    const int taps = h->taps;
+
+    // the last group of outputs may read up to SIMD_LANES - 1 past the input
+    float x[ HALFBAND_MAX_TAPS + HALFBAND_BLOCK + SIMD_LANES ] = {};
+    memcpy( x, h->history, sizeof( float ) * taps );
+    memcpy( x + taps, in, sizeof( float ) * frames );
+
+    for ( int i = 0; i < frames; i += SIMD_LANES ) {
+        SIMD_ALIGN float odd[ SIMD_LANES ];
+        f32x4_store( odd, halfband_fir( h, x + i + 1 ) );
+
+        int count = frames - i < SIMD_LANES ? frames - i : SIMD_LANES;
+        for ( int l = 0; l < count; l++ ) {
+            // the centre tap lines up with the sample half the taps ago,
+            // both branches are scaled by 2 to make up for the zeros
+            // stuffed in between
+            out[ 2 * ( i + l ) ] = x[ i + l + taps - taps / 2 ];
+            out[ 2 * ( i + l ) + 1 ] = 2.0f * odd[ l ];
+        }
+    }
+
+    memcpy( h->history, x + frames, sizeof( float ) * taps );
+}
+
+/// decimates up to 2 HALFBAND_BLOCK samples, 2 frames in become frames out
+static void halfband_down(
+    halfband_t * h,
+    const float * in,
+    int frames,
+    float * out
+)
+{
+    const int taps = h->taps;
+
+    // the even branch lines up with the odd one a sample earlier than when
+    // interpolating, since the odd sample is the newer one of each pair
+    const int depth = taps / 2 - 1;
+
+    float odd[ HALFBAND_MAX_TAPS + HALFBAND_BLOCK + SIMD_LANES ] = {};
+    float even[ HALFBAND_MAX_TAPS / 2 + HALFBAND_BLOCK ];
+    memcpy( odd, h->history, sizeof( float ) * taps );
+    memcpy( even, h->delay, sizeof( float ) * depth );
+    for ( int i = 0; i < frames; i++ ) {
+        even[ depth + i ] = in[ 2 * i ];
+        odd[ taps + i ] = in[ 2 * i + 1 ];
+    }
+
+    for ( int i = 0; i < frames; i += SIMD_LANES ) {
+        SIMD_ALIGN float y[ SIMD_LANES ];
+        f32x4_store( y, halfband_fir( h, odd + i + 1 ) );
+
+        int count = frames - i < SIMD_LANES ? frames - i : SIMD_LANES;
+        for ( int l = 0; l < count; l++ ) {
+            out[ i + l ] = 0.5f * even[ i + l ] + y[ l ];
+        }
+    }
+
+    memcpy( h->history, odd + frames, sizeof( float ) * taps );
+    memcpy( h->delay, even + frames, sizeof( float ) * depth );
+}
+
+void oversampler_init( oversampler_t * o, int factor )
+{
+    o->factor = factor >= 4 ? 4 : factor >= 2 ? 2 : 1;
+
+    halfband_init( &o->up[ 0 ], HALFBAND_TAPS_FIRST );
+    halfband_init( &o->up[ 1 ], HALFBAND_TAPS_SECOND );
+    halfband_init( &o->down[ 0 ], HALFBAND_TAPS_FIRST );
+    halfband_init( &o->down[ 1 ], HALFBAND_TAPS_SECOND );
+}
+
+void oversampler_up(
+    oversampler_t * o,
+    const float * in,
+    int frames,
+    float * out
+)
+{
+    if ( o->factor == 1 ) {
+        memmove( out, in, sizeof( float ) * frames );
+        return;
+    }
+
+    while ( frames > 0 ) {
+        int block = frames < HALFBAND_BLOCK / 2 ? frames : HALFBAND_BLOCK / 2;
+
+        if ( o->factor == 2 ) {
+            halfband_up( &o->up[ 0 ], in, block, out );
+        } else {
+            float x2[ HALFBAND_BLOCK ];
+            halfband_up( &o->up[ 0 ], in, block, x2 );
+            halfband_up( &o->up[ 1 ], x2, 2 * block, out );
+        }
+
+        in += block;
+        out += block * o->factor;
+        frames -= block;
+    }
+}
+
+void oversampler_down(
+    oversampler_t * o,
+    const float * in,
+    int frames,
+    float * out
+)
+{
+    if ( o->factor == 1 ) {
+        memmove( out, in, sizeof( float ) * frames );
+        return;
+    }
+
+    while ( frames > 0 ) {
+        int block = frames < HALFBAND_BLOCK / 2 ? frames : HALFBAND_BLOCK / 2;
+
+        if ( o->factor == 2 ) {
+            halfband_down( &o->down[ 0 ], in, block, out );
+        } else {
+            float x2[ HALFBAND_BLOCK ];
+            halfband_down( &o->down[ 1 ], in, 2 * block, x2 );
+            halfband_down( &o->down[ 0 ], x2, block, out );
+        }
+
+        in += block * o->factor;
+        out += block;
+        frames -= block;
+    }
+}
+
+float oversampler_latency( const oversampler_t * o )
+{
+    if ( o->factor == 1 ) return 0.0f;
+
+    // a round trip through a stage is 2 ( taps - 1 ) samples at its higher
+    // rate, half of it each way
+    float latency = HALFBAND_TAPS_FIRST - 1.0f;
+    if ( o->factor == 4 ) latency += ( HALFBAND_TAPS_SECOND - 1.0f ) / 2.0f;
+
+    return latency;
+}
@@ -0,0 +1,63 @@
+#pragma once
+
+#include "simd.hpp"
+
+/// highest oversampling factor
+#define OVERSAMPLE_MAX 4
+
+/// most odd taps a half-band stage can have
+#define HALFBAND_MAX_TAPS 32
+
+/// one 2x half-band FIR stage, split into its two polyphase branches
+///
+/// a half-band lowpass has a centre tap of 0.5 and every other even tap
+/// zero, so one branch is a plain delay and only the odd taps are computed,
+/// at the lower of the two rates
+struct halfband_t {
+    int taps; // odd taps, a multiple of 4
+
+    /// odd taps ordered by the age of the sample they multiply, newest first
+    /// the taps are symmetric, so the same order also works oldest first
+    SIMD_ALIGN float coef[ HALFBAND_MAX_TAPS ];
+
+    /// the last taps samples of the filtered branch, oldest first
+    float history[ HALFBAND_MAX_TAPS ];
+
+    /// the last taps / 2 - 1 samples of the delayed branch when decimating
+    float delay[ HALFBAND_MAX_TAPS / 2 ];
+};
+
+/// runs a stage at 2x or 4x the rate around a nonlinear module: upsample,
+/// process factor times as many samples, downsample
+///
+/// 4x cascades a long stage for the sharp transition at the base rate with a
+/// short one for the much wider transition at 2x; the round trip delays the
+/// signal by oversampler_latency() base rate samples
+struct oversampler_t {
+    int factor; // 1, 2 or 4
+
+    halfband_t up[ 2 ];
+    halfband_t down[ 2 ];
+};
+
+/// factor is rounded down to 1, 2 or 4, and all history is cleared
+void oversampler_init( oversampler_t * o, int factor );
+
+/// interpolates frames samples into frames * factor samples
+void oversampler_up(
+    oversampler_t * o,
+    const float * in,
+    int frames,
+    float * out
+);
+
+/// decimates frames * factor samples back into frames samples
+void oversampler_down(
+    oversampler_t * o,
+    const float * in,
+    int frames,
+    float * out
+);
+
+/// delay of an up and down round trip in base rate samples
+float oversampler_latency( const oversampler_t * o );
@@ -1,151 +1,225 @@
 #include "audio.hpp"
+#include "limiter.hpp"
+#include "logging.hpp"
+#include "scope.hpp"
+#include "synth.hpp"
+#include "triple_buffer.hpp"
 
-#include <pa_ringbuffer.h>
 #include <portaudio.h>
+#include <porttime.h>
 
 #include <math.h>
 #include <stdio.h>
 
-#define NUM_SECONDS       ( 5 )
-#define SAMPLE_RATE       ( 44100 )
-#define FRAMES_PER_BUFFER ( 64 )
+#include <atomic>
+#include <chrono>
+#include <mutex>
 
-#define OSC_TABLE_SIZE 4096
+/// where the callback statistics are dumped on exit
+#define AUDIO_STATS_PATH "audio_stats.json"
 
-#ifndef M_PI
-#define M_PI ( 3.14159265 )
-#endif
+/// seconds between load reports in the log
+#define AUDIO_STATS_INTERVAL 5.0
 
-struct synth_command_t {
-    enum {
-        MIDI_START,
-        MIDI_STOP,
-        MIDI_CONTROL,
-    } type;
-
-    int value;
-};
+struct {
+    PaStream * stream;
+    synth_t synth;
 
-struct synth_t {
-    PaUtilRingBuffer command_queue;
+    /// keeps whatever the synth renders inside the device's range
+    limiter_t limiter;
 
-    int midi_enable;
-    int midi_no;
-    int phase;
+    /// stream time the first frame of the last callback reaches the dac,
+    /// published by the audio callback under a sequence lock
+    std::atomic< unsigned int > anchor_seq;
+    std::atomic< int64_t > anchor_frame;
+    std::atomic< double > anchor_dac_time;
 
-    /// voltage controlled oscillator
-    struct vco_t {
-        float pitch;
-        float vco_wave;
-        float pulse_width;
-    } vco;
+    double output_latency;
 
-    /// voltage controlled filter
-    struct vcf_t {
-        float cutoff;
-        float resonance;
+    /// how far ahead of their timestamp midi events are played
+    float midi_latency;
 
-        float out;
+    /// wav file loaded into the convolver when the stream opens
+    const char * ir_path;
 
-        float process( float in );
-    } vcf;
+    /// stream time minus porttime, in seconds
+    double pt_offset;
 
-    /// voltage controlled amplifier
-    struct vca_t {
-        float volume;
-        int vca_mode; // 0 - ON   1 - EG
-    } vca;
+    /// commands come from the midi thread and the render loop, but the
+    /// command queue has a single producer side
+    std::mutex send_mutex;
 
-    /// low frequency oscillator
-    struct lfo_t {
-        float lfo_rate;
-        float lfo_wave;
-    } lfo;
+    /// callback statistics, written by the audio thread only
+    struct {
+        std::atomic< int > callbacks;
+        std::atomic< int > underflows;
+        std::atomic< int > overflows;
+        std::atomic< int > priming;
+        std::atomic< int64_t > busy_ns;
+        std::atomic< int64_t > max_ns;
+        std::atomic< int64_t > budget_ns;
+        std::atomic< int > histogram[ AUDIO_LOAD_BINS ];
+    } stats;
 
-    /// envelope generator
-    struct eg_t {
-        float attack;
-        float decay;
-        float sustain;
-        float release;
+    /// audio thread to render thread snapshot of each callback
+    triple_buffer_t< audio_telemetry_t > telemetry;
 
-        float pressed();
-        float released();
+    /// copy of everything the callback played, for the scope
+    scope_ring_t scope;
 
-        float out;
-        float t;
-    } eg;
+    /// what the last periodic report saw
+    audio_load_t last_report;
+    std::chrono::steady_clock::time_point last_report_time;
 
-    float sine[ OSC_TABLE_SIZE ];
-    float sawtooth[ OSC_TABLE_SIZE ];
-    float triangle[ OSC_TABLE_SIZE ];
+} intern;
 
-    float envelope_factor();
-};
+/// single writer, so a relaxed load and store is enough to count
+template < typename T > static void bump( std::atomic< T > & x, T amount )
+{
+    x.store( x.load( std::memory_order_relaxed ) + amount,
+             std::memory_order_relaxed );
+}
 
-float synth_t::eg_t::pressed()
+void audio_record_callback(
+    int64_t busy_ns,
+    unsigned long frames,
+    unsigned long status_flags
+)
 {
-    if ( t < attack ) {
-        out += ( 1.0f / attack ) * ( 1.0f / SAMPLE_RATE );
-    } else if ( t < attack + decay ) {
-        out -= ( ( 1.0f - sustain ) / decay ) * ( 1.0f / SAMPLE_RATE );
-    } else {
-        out = sustain;
-    }
+    int64_t budget_ns = (int64_t) frames * 1000000000 / SAMPLE_RATE;
+    if ( budget_ns == 0 ) return;
 
-    t += ( 1.0f / SAMPLE_RATE );
+    int bin = (int) ( busy_ns * 10 / budget_ns );
+    if ( bin > AUDIO_LOAD_BINS - 1 ) bin = AUDIO_LOAD_BINS - 1;
+    bump( intern.stats.histogram[ bin ], 1 );
 
-    if ( out > 1.0f ) out = 1.0f;
-    if ( out < 0.0f ) out = 0.0f;
+    if ( busy_ns > intern.stats.max_ns.load( std::memory_order_relaxed ) ) {
+        intern.stats.max_ns.store( busy_ns, std::memory_order_relaxed );
+    }
+
+    if ( status_flags & paOutputUnderflow ) bump( intern.stats.underflows, 1 );
+    if ( status_flags & paOutputOverflow ) bump( intern.stats.overflows, 1 );
+    if ( status_flags & paPrimingOutput ) bump( intern.stats.priming, 1 );
 
-    return out;
+    bump( intern.stats.busy_ns, busy_ns );
+    bump( intern.stats.budget_ns, budget_ns );
+    bump( intern.stats.callbacks, 1 );
 }
 
-float synth_t::eg_t::released()
+static void publish_anchor( int64_t frame, double dac_time )
 {
-    if ( t < release ) {
-        out -= ( sustain / release ) * ( 1.0f / SAMPLE_RATE );
-    } else {
-        out = 0.0f;
-    }
+    unsigned int seq = intern.anchor_seq.load( std::memory_order_relaxed );
+    intern.anchor_seq.store( seq + 1, std::memory_order_relaxed );
+    std::atomic_thread_fence( std::memory_order_release );
 
-    t += ( 1.0f / SAMPLE_RATE );
+    intern.anchor_frame.store( frame, std::memory_order_relaxed );
+    intern.anchor_dac_time.store( dac_time, std::memory_order_relaxed );
 
-    if ( out > 1.0f ) out = 1.0f;
-    if ( out < 0.0f ) out = 0.0f;
+    intern.anchor_seq.store( seq + 2, std::memory_order_release );
+}
 
-    return out;
+static void read_anchor( int64_t * frame, double * dac_time )
+{
+    unsigned int seq0, seq1;
+
+    do {
+        seq0 = intern.anchor_seq.load( std::memory_order_acquire );
+        *frame = intern.anchor_frame.load( std::memory_order_relaxed );
+        *dac_time = intern.anchor_dac_time.load( std::memory_order_relaxed );
+        std::atomic_thread_fence( std::memory_order_acquire );
+        seq1 = intern.anchor_seq.load( std::memory_order_relaxed );
+    } while ( seq0 != seq1 || ( seq0 & 1 ) );
 }
 
-float synth_t::envelope_factor()
+int64_t audio_schedule_frame(
+    audio_clock_t * clock,
+    int timestamp,
+    double offset
+)
 {
-    if ( midi_enable ) {
-        return eg.pressed();
-    } else {
-        return eg.released();
+    // no callback yet, or the host api does not report dac times
+    if ( clock->anchor_dac_time == 0.0 ) return 0;
+
+    // Pt_Time() is truncated to whole milliseconds, so the smallest offset
+    // seen is the closest one; start over if the clocks drift apart
+    if ( offset < clock->pt_offset || offset > clock->pt_offset + 0.002 ) {
+        clock->pt_offset = offset;
     }
+
+    double event_time = timestamp / 1000.0 + clock->pt_offset;
+    double target = event_time + clock->latency;
+
+    // the limiter plays every frame its lookahead after it was rendered
+    int64_t ahead =
+        llround( ( target - clock->anchor_dac_time ) * SAMPLE_RATE ) -
+        clock->lookahead;
+
+    // never hold an event back for more than a second on a bogus timestamp
+    if ( ahead > SAMPLE_RATE ) ahead = SAMPLE_RATE;
+
+    return clock->anchor_frame + ahead;
 }
 
-float synth_t::vcf_t::process( float in )
+/// maps a porttime timestamp (ms) to the render frame it should sound on,
+/// a constant output_latency + midi_latency after the event happened
+static int64_t schedule_frame( int timestamp )
 {
-    float rc = 1.0f / ( 2 * M_PI * cutoff );
-    float dt = 1.0f / SAMPLE_RATE;
-    float a = dt / ( rc + dt );
+    audio_clock_t clock;
+    read_anchor( &clock.anchor_frame, &clock.anchor_dac_time );
+    clock.pt_offset = intern.pt_offset;
+    clock.latency = intern.output_latency + intern.midi_latency;
+    clock.lookahead = intern.limiter.lookahead;
 
-    out = a * in + ( 1 - a ) * out;
+    double offset = Pa_GetStreamTime( intern.stream ) - Pt_Time() / 1000.0;
+    int64_t frame = audio_schedule_frame( &clock, timestamp, offset );
+    intern.pt_offset = clock.pt_offset;
 
-    return out;
+    return frame;
 }
 
-struct {
-    PaStream * stream;
-    synth_t synth;
+static void send( synth_command_t cmd, int timestamp )
+{
+    std::lock_guard< std::mutex > lock( intern.send_mutex );
 
-} intern;
+    cmd.frame = schedule_frame( timestamp );
+    synth_send( &intern.synth, cmd );
+}
 
-static float midi_to_freq( int midi_no )
+static void publish_telemetry(
+    const synth_t * s,
+    const float * out,
+    unsigned long frames,
+    int64_t busy_ns
+)
 {
-    return 440.00 * pow( 2.0, ( midi_no - 69.00 ) / 12.00 );
+    audio_telemetry_t * t = triple_buffer_back( &intern.telemetry );
+
+    t->frame = s->frame;
+    t->voice_count = s->voice.count;
+
+    t->eg_level = 0.0f;
+    for ( int i = 0; i < s->voice.count; i++ ) {
+        if ( s->voice.eg_out[ i ] > t->eg_level ) {
+            t->eg_level = s->voice.eg_out[ i ];
+        }
+    }
+
+    float peak = 0.0f;
+    float sum_sq = 0.0f;
+    for ( unsigned long i = 0; i < frames * 2; i++ ) {
+        float x = fabsf( out[ i ] );
+        if ( x > peak ) peak = x;
+        sum_sq += x * x;
+    }
+    t->peak = peak;
+    t->rms = 0.0f;
+    t->load = 0.0f;
+    if ( frames ) {
+        t->rms = sqrtf( sum_sq / ( frames * 2 ) );
+        t->load = (float) busy_ns * SAMPLE_RATE / ( frames * 1e9f );
+    }
+
+    triple_buffer_publish( &intern.telemetry );
 }
 
 static int pa_callback(
@@ -157,81 +231,94 @@ static int pa_callback(
     void * user_data
 )
 {
+    auto start = std::chrono::steady_clock::now();
+
     synth_t * s = (synth_t *) user_data;
     float * out = (float *) output_buffer;
 
-    synth_command_t command;
-    if ( PaUtil_ReadRingBuffer( &s->command_queue, &command, 1 ) ) {
-        if ( command.type == synth_command_t::MIDI_START ) {
-            if ( !s->midi_enable ) s->eg.t = 0.0f;
-            s->midi_enable = 1;
-            s->midi_no = command.value;
-        }
-        if ( command.type == synth_command_t::MIDI_STOP ) {
-            s->midi_enable = 0;
-            s->eg.t = 0.0f;
-        }
-        if ( command.type == synth_command_t::MIDI_CONTROL ) {
-            s->vcf.cutoff =
-                100.0f + ( (float) command.value / 0x7f ) * 5000.0f;
-        }
-    }
+    publish_anchor( s->frame, time_info->outputBufferDacTime );
 
-    for ( unsigned long i = 0; i < frames_per_buffer; i++ ) {
-        float freq = midi_to_freq( s->midi_no );
-        //*out++ = s->sine[ s->phase ];
-        //*out++ = s->sine[ s->phase ];
-        float x = s->triangle[ s->phase ] * s->envelope_factor();
-        x = s->vcf.process( x );
-        *out++ = x;
-        *out++ = x;
-
-        s->phase += (int) ( freq * OSC_TABLE_SIZE / SAMPLE_RATE );
-        s->phase %= OSC_TABLE_SIZE;
-    }
+    synth_render( s, out, (int) frames_per_buffer );
+    limiter_process(
+        &intern.limiter,
+        out,
+        (int) frames_per_buffer,
+        SAMPLE_RATE
+    );
+    scope_write( &intern.scope, out, (int) frames_per_buffer );
+
+    auto end = std::chrono::steady_clock::now();
+    int64_t busy_ns =
+        std::chrono::duration_cast< std::chrono::nanoseconds >( end - start )
+            .count();
+
+    audio_record_callback( busy_ns, frames_per_buffer, status_flags );
+    publish_telemetry( s, out, frames_per_buffer, busy_ns );
 
     return paContinue;
 }
 
-static void setup_osc_tables()
+void audio_send_control( int control, int value, int timestamp )
 {
-    for ( int i = 0; i < OSC_TABLE_SIZE; i++ ) {
-        intern.synth.sine[ i ] =
-            (float) sin( ( (double) i / (double) OSC_TABLE_SIZE ) * M_PI * 2. );
-    }
+    synth_command_t cmd;
+    cmd.type = synth_command_t::MIDI_CONTROL;
+    cmd.param = control;
+    cmd.value = value;
+    send( cmd, timestamp );
+}
 
-    for ( int i = 0; i < OSC_TABLE_SIZE; i++ ) {
-        intern.synth.sawtooth[ i ] =
-            1.0f - 2.0f * ( i / (float) OSC_TABLE_SIZE );
-    }
+void audio_set_param( int param, float amount )
+{
+    synth_command_t cmd;
+    cmd.type = synth_command_t::SET_PARAM;
+    cmd.param = param;
+    cmd.amount = amount;
+    cmd.frame = 0;
 
-    for ( int i = 0; i < OSC_TABLE_SIZE; i++ ) {
-        intern.synth.triangle[ i ] =
-            -fabs( -1.0 + 2.0f * i / (float) OSC_TABLE_SIZE );
-    }
+    std::lock_guard< std::mutex > lock( intern.send_mutex );
+    synth_send( &intern.synth, cmd );
 }
 
-void audio_send_control( int value )
+void audio_send_bend( int value, int timestamp )
 {
     synth_command_t cmd;
-    cmd.type = synth_command_t::MIDI_CONTROL;
+    cmd.type = synth_command_t::MIDI_BEND;
     cmd.value = value;
-    PaUtil_WriteRingBuffer( &intern.synth.command_queue, &cmd, 1 );
+    send( cmd, timestamp );
+}
+
+void audio_send_program( int program, int timestamp )
+{
+    synth_command_t cmd;
+    cmd.type = synth_command_t::MIDI_PROGRAM;
+    cmd.value = program;
+    send( cmd, timestamp );
 }
 
-void audio_start_midi( int midi_no )
+void audio_start_midi( int midi_no, int timestamp )
 {
     synth_command_t cmd;
     cmd.type = synth_command_t::MIDI_START;
     cmd.value = midi_no;
-    PaUtil_WriteRingBuffer( &intern.synth.command_queue, &cmd, 1 );
+    send( cmd, timestamp );
 }
 
-void audio_stop_midi()
+void audio_stop_midi( int midi_no, int timestamp )
 {
     synth_command_t cmd;
     cmd.type = synth_command_t::MIDI_STOP;
-    PaUtil_WriteRingBuffer( &intern.synth.command_queue, &cmd, 1 );
+    cmd.value = midi_no;
+    send( cmd, timestamp );
+}
+
+void audio_set_midi_latency( float seconds )
+{
+    intern.midi_latency = seconds;
+}
+
+void audio_set_impulse_response( const char * path )
+{
+    intern.ir_path = path;
 }
 
 int audio_init()
@@ -240,25 +327,22 @@ int audio_init()
     PaError err;
     int i;
 
-    intern.synth.midi_no = 69;
-    intern.synth.midi_enable = 1;
+    synth_init( &intern.synth );
+    if ( intern.ir_path ) synth_load_ir( &intern.synth, intern.ir_path, false );
+    limiter_init( &intern.limiter, LIMITER_LOOKAHEAD, SAMPLE_RATE );
 
-    intern.synth.eg.attack = 0.1f;
-    intern.synth.eg.decay = 0.0f;
-    intern.synth.eg.sustain = 1.0f;
-    intern.synth.eg.release = 0.1f;
+    intern.anchor_seq = 0;
+    intern.anchor_frame = 0;
+    intern.anchor_dac_time = 0.0;
+    intern.pt_offset = 0.0;
 
-    intern.synth.vcf.cutoff = 500;
+    triple_buffer_init( &intern.telemetry );
+    scope_init( &intern.scope );
 
-    static void * command_buffer = new synth_command_t[ 1024 ];
-    PaUtil_InitializeRingBuffer(
-        &intern.synth.command_queue,
-        sizeof( synth_command_t ),
-        1024,
-        command_buffer
-    );
+    intern.last_report = {};
+    intern.last_report_time = std::chrono::steady_clock::now();
 
-    setup_osc_tables();
+    intern.midi_latency = AUDIO_MIDI_LATENCY;
 
     printf(
         "PortAudio Test: output sine wave. SR = %d, BufSize = %d\n",
@@ -288,19 +372,104 @@ int audio_init()
         &outputParameters,
         SAMPLE_RATE,
         FRAMES_PER_BUFFER,
-        paClipOff, /* we won't output out of range samples so don't bother
-                      clipping them */
+        paClipOff, /* the limiter keeps every sample in range, so don't
+                      bother clipping them */
         pa_callback,
         &intern.synth
     );
 
+    intern.output_latency = Pa_GetStreamInfo( intern.stream )->outputLatency;
+    double lookahead = (double) intern.limiter.lookahead / SAMPLE_RATE;
+    INFO_LOG(
+        "output latency %.1f ms, %.1f ms of it the limiter's lookahead",
+        1e3 * ( intern.output_latency + lookahead ),
+        1e3 * lookahead
+    );
+
     err = Pa_StartStream( intern.stream );
 
     return 0;
 }
 
+void audio_get_load( audio_load_t * out )
+{
+    out->callbacks = intern.stats.callbacks.load( std::memory_order_relaxed );
+    out->underflows = intern.stats.underflows.load( std::memory_order_relaxed );
+    out->overflows = intern.stats.overflows.load( std::memory_order_relaxed );
+    out->priming = intern.stats.priming.load( std::memory_order_relaxed );
+
+    auto & stats = intern.stats;
+    int64_t busy_ns = stats.busy_ns.load( std::memory_order_relaxed );
+    int64_t budget_ns = stats.budget_ns.load( std::memory_order_relaxed );
+    int64_t max_ns = stats.max_ns.load( std::memory_order_relaxed );
+
+    int64_t period_ns = (int64_t) FRAMES_PER_BUFFER * 1000000000 / SAMPLE_RATE;
+
+    out->load_avg = budget_ns ? (float) busy_ns / budget_ns : 0.0f;
+    out->load_max = (float) max_ns / period_ns;
+
+    for ( int i = 0; i < AUDIO_LOAD_BINS; i++ ) {
+        out->histogram[ i ] =
+            intern.stats.histogram[ i ].load( std::memory_order_relaxed );
+    }
+}
+
+static void write_stats( const audio_load_t & load )
+{
+    FILE * file = fopen( AUDIO_STATS_PATH, "w" );
+    if ( !file ) {
+        ERROR_LOG( "failed to write %s", AUDIO_STATS_PATH );
+        return;
+    }
+
+    fprintf( file, "{\n" );
+    fprintf( file, "  \"sample_rate\": %d,\n", SAMPLE_RATE );
+    fprintf( file, "  \"frames_per_buffer\": %d,\n", FRAMES_PER_BUFFER );
+    fprintf( file, "  \"callbacks\": %d,\n", load.callbacks );
+    fprintf( file, "  \"output_underflows\": %d,\n", load.underflows );
+    fprintf( file, "  \"output_overflows\": %d,\n", load.overflows );
+    fprintf( file, "  \"priming_output\": %d,\n", load.priming );
+    fprintf( file, "  \"load_avg\": %.4f,\n", load.load_avg );
+    fprintf( file, "  \"load_max\": %.4f,\n", load.load_max );
+    fprintf( file, "  \"load_bin_width\": 0.1,\n" );
+    fprintf( file, "  \"load_histogram\": [" );
+    for ( int i = 0; i < AUDIO_LOAD_BINS; i++ ) {
+        fprintf( file, i ? ", %d" : "%d", load.histogram[ i ] );
+    }
+    fprintf( file, "]\n}\n" );
+
+    fclose( file );
+}
+
 void audio_tick()
 {
+    auto now = std::chrono::steady_clock::now();
+    std::chrono::duration< double > since = now - intern.last_report_time;
+    if ( since.count() < AUDIO_STATS_INTERVAL ) return;
+
+    audio_load_t load;
+    audio_get_load( &load );
+
+    const audio_load_t & last = intern.last_report;
+    int callbacks = load.callbacks - last.callbacks;
+
+    // average over the interval from the running totals
+    float load_avg = 0.0f;
+    if ( callbacks > 0 ) {
+        load_avg = ( load.load_avg * load.callbacks -
+                     last.load_avg * last.callbacks ) /
+                   callbacks;
+    }
+
+    INFO_LOG(
+        "audio load avg %.1f%% max %.1f%%, %d underflows",
+        load_avg * 100.0f,
+        load.load_max * 100.0f,
+        load.underflows - last.underflows
+    );
+
+    intern.last_report = load;
+    intern.last_report_time = now;
 }
 
 void audio_destroy()
@@ -310,11 +479,43 @@ void audio_destroy()
     Pa_CloseStream( intern.stream );
 
     Pa_Terminate();
+
+    audio_load_t load;
+    audio_get_load( &load );
+    INFO_LOG(
+        "audio callbacks %d, load avg %.1f%% max %.1f%%, %d underflows",
+        load.callbacks,
+        load.load_avg * 100.0f,
+        load.load_max * 100.0f,
+        load.underflows
+    );
+    write_stats( load );
+
+    const synth_t::timing_t & t = intern.synth.timing;
+    if ( t.count ) {
+        double mean = t.late_sum / t.count;
+        double var = t.late_sum_sq / t.count - mean * mean;
+        INFO_LOG(
+            "midi onset error over %d events: min %d max %d mean %.1f "
+            "stddev %.1f frames",
+            (int) t.count,
+            (int) t.late_min,
+            (int) t.late_max,
+            mean,
+            sqrt( var > 0.0 ? var : 0.0 )
+        );
+    }
+
+    synth_destroy( &intern.synth );
     printf( "Test finished.\n" );
 }
 
-float audio_visual_1()
+void audio_get_telemetry( audio_telemetry_t * out )
+{
+    *out = *triple_buffer_read( &intern.telemetry );
+}
+
+int audio_read_scope( float * out, int count )
 {
-    // TODO: not exactly threadsafe
-    return intern.synth.eg.out;
+    return scope_read( &intern.scope, out, count );
 }
\ No newline at end of file
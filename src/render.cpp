@@ -1,5 +1,10 @@
 #include "render.hpp"
 
+#include "logging.hpp"
+#include "res_data.h"
+
+#include <string.h>
+
 #ifdef __EMSCRIPTEN__
 #include <GLES2/gl2.h>
 #else
@@ -8,13 +13,193 @@
 
 renderstate_t rstate;
 
+static const float identity[ 16 ] = {
+    1.0f, 0.0f, 0.0f, 0.0f, //
+    0.0f, 1.0f, 0.0f, 0.0f, //
+    0.0f, 0.0f, 1.0f, 0.0f, //
+    0.0f, 0.0f, 0.0f, 1.0f, //
+};
+
 // render state
 struct {
+    GLuint shader1;
+    GLint shader1_a_pos;
+    GLint shader1_u_proj;
+    GLint shader1_u_model;
+    GLint shader1_u_color;
+
+    /// one buffer per trace, sized for RENDER_TRACE_MAX points once and
+    /// orphaned every frame
+    GLuint trace_vbo[ RENDER_TRACE_SLOTS ];
 } intern;
 
-void render( float x )
+/// finds a "#shader <name>" section in shaders.glsl, the section runs until
+/// the next line of slashes
+static bool find_shader( const char * name, const char ** out, int * out_len )
+{
+    int index = -1;
+    for ( int i = 0; i < res_data_count; i++ ) {
+        if ( !strcmp( res_data_name_list[ i ], "shaders.glsl" ) ) index = i;
+    }
+    if ( index < 0 ) return false;
+
+    const char * data = (const char *) res_data;
+    const char * begin = data + res_data_offset_list[ index ];
+    const char * end = begin + res_data_size_list[ index ];
+
+    int name_len = (int) strlen( name );
+
+    for ( const char * p = begin; p + 8 + name_len < end; p++ ) {
+        if ( memcmp( p, "#shader ", 8 ) || memcmp( p + 8, name, name_len ) ) {
+            continue;
+        }
+        if ( p[ 8 + name_len ] != '\n' ) continue;
+
+        // skip the header and the separator line under it
+        const char * src = p + 8 + name_len + 1;
+        while ( src < end && *src != '\n' ) src++;
+
+        const char * src_end = src;
+        while ( src_end < end && memcmp( src_end, "\n//", 3 ) ) src_end++;
+
+        *out = src;
+        *out_len = (int) ( src_end - src );
+        return true;
+    }
+
+    return false;
+}
+
+static GLuint compile_shader( GLenum type, const char * name )
 {
-    //glClearColor( 0.2f, 0.0f, 0.0f, 1.0f );
+    const char * src;
+    int len;
+    if ( !find_shader( name, &src, &len ) ) {
+        ERROR_LOG( "missing shader %s", name );
+        return 0;
+    }
+
+    GLuint shader = glCreateShader( type );
+    glShaderSource( shader, 1, &src, &len );
+    glCompileShader( shader );
+
+    GLint ok;
+    glGetShaderiv( shader, GL_COMPILE_STATUS, &ok );
+    if ( !ok ) {
+        char log[ 512 ];
+        glGetShaderInfoLog( shader, sizeof( log ), nullptr, log );
+        ERROR_LOG( "failed to compile %s: %s", name, log );
+    }
+
+    return shader;
+}
+
+static GLuint link_program( const char * vertex, const char * fragment )
+{
+    GLuint program = glCreateProgram();
+    GLuint vs = compile_shader( GL_VERTEX_SHADER, vertex );
+    GLuint fs = compile_shader( GL_FRAGMENT_SHADER, fragment );
+
+    glAttachShader( program, vs );
+    glAttachShader( program, fs );
+    glLinkProgram( program );
+
+    GLint ok;
+    glGetProgramiv( program, GL_LINK_STATUS, &ok );
+    if ( !ok ) {
+        char log[ 512 ];
+        glGetProgramInfoLog( program, sizeof( log ), nullptr, log );
+        ERROR_LOG( "failed to link %s: %s", vertex, log );
+    }
+
+    glDeleteShader( vs );
+    glDeleteShader( fs );
+
+    return program;
+}
+
+void render_init()
+{
+    intern.shader1 = link_program( "shader1_vertex", "shader1_fragment" );
+    intern.shader1_a_pos = glGetAttribLocation( intern.shader1, "a_pos" );
+    intern.shader1_u_proj = glGetUniformLocation( intern.shader1, "u_proj" );
+    intern.shader1_u_model = glGetUniformLocation( intern.shader1, "u_model" );
+    intern.shader1_u_color = glGetUniformLocation( intern.shader1, "u_color" );
+
+    glGenBuffers( RENDER_TRACE_SLOTS, intern.trace_vbo );
+    for ( int i = 0; i < RENDER_TRACE_SLOTS; i++ ) {
+        glBindBuffer( GL_ARRAY_BUFFER, intern.trace_vbo[ i ] );
+        glBufferData(
+            GL_ARRAY_BUFFER,
+            sizeof( float ) * 2 * RENDER_TRACE_MAX,
+            nullptr,
+            GL_STREAM_DRAW
+        );
+    }
+}
+
+static void draw_trace( GLuint vbo, const render_trace_t & trace )
+{
+    int count = trace.count;
+    if ( count < 2 ) return;
+    if ( count > RENDER_TRACE_MAX ) count = RENDER_TRACE_MAX;
+
+    // x and y only, the shader fills in z
+    static float vertices[ RENDER_TRACE_MAX * 2 ];
+
+    float dx = 2.0f / ( count - 1 );
+    for ( int i = 0; i < count; i++ ) {
+        float y = trace.samples[ i ];
+        vertices[ i * 2 + 0 ] = -1.0f + dx * i;
+        vertices[ i * 2 + 1 ] = trace.y_offset + trace.y_scale * y;
+    }
+
+    // orphan the storage the gpu may still be reading from last frame, the
+    // driver hands back a fresh block instead of stalling on the old one
+    glBindBuffer( GL_ARRAY_BUFFER, vbo );
+    glBufferData(
+        GL_ARRAY_BUFFER,
+        sizeof( float ) * 2 * RENDER_TRACE_MAX,
+        nullptr,
+        GL_STREAM_DRAW
+    );
+    glBufferSubData(
+        GL_ARRAY_BUFFER,
+        0,
+        sizeof( float ) * 2 * count,
+        vertices
+    );
+
+    glUniform4fv( intern.shader1_u_color, 1, trace.color );
+    glVertexAttribPointer(
+        intern.shader1_a_pos,
+        2,
+        GL_FLOAT,
+        GL_FALSE,
+        0,
+        nullptr
+    );
+
+    glDrawArrays( GL_LINE_STRIP, 0, count );
+}
+
+void render( float level, const render_trace_t * traces, int trace_count )
+{
+    float x = level * 0.2f;
     glClearColor( x, x, x, 1.0f );
     glClear( GL_COLOR_BUFFER_BIT );
+
+    if ( trace_count > RENDER_TRACE_SLOTS ) trace_count = RENDER_TRACE_SLOTS;
+    if ( trace_count == 0 ) return;
+
+    glUseProgram( intern.shader1 );
+    glUniformMatrix4fv( intern.shader1_u_proj, 1, GL_FALSE, identity );
+    glUniformMatrix4fv( intern.shader1_u_model, 1, GL_FALSE, identity );
+    glEnableVertexAttribArray( intern.shader1_a_pos );
+
+    for ( int i = 0; i < trace_count; i++ ) {
+        draw_trace( intern.trace_vbo[ i ], traces[ i ] );
+    }
+
+    glDisableVertexAttribArray( intern.shader1_a_pos );
 }
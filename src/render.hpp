@@ -1,5 +1,23 @@
 #pragma once
 
+/// most points a single trace can have
+#define RENDER_TRACE_MAX 4096
+
+/// traces drawn per frame, each streams through its own vertex buffer
+#define RENDER_TRACE_SLOTS 4
+
+/// a line strip across the screen, sample i of count lands at
+/// x = -1 + 2 i / ( count - 1 ), y = y_offset + y_scale * samples[ i ]
+struct render_trace_t {
+    const float * samples;
+    int count;
+
+    float y_offset;
+    float y_scale;
+
+    float color[ 4 ];
+};
+
 struct renderstate_t {
 };
 
@@ -7,4 +25,5 @@ extern renderstate_t rstate;
 
 void render_init();
 
-void render( float x );
+/// clears to a grey level and draws up to RENDER_TRACE_SLOTS traces
+void render( float level, const render_trace_t * traces, int trace_count );
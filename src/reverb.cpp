@@ -0,0 +1,330 @@
+#include "reverb.hpp"
+
+#include <math.h>
+#include <string.h>
+
+#ifndef M_PI
+#define M_PI ( 3.14159265 )
+#endif
+
+/// samples processed at once, no line may be shorter
+#define REVERB_BLOCK 64
+
+/// the line lengths are spread geometrically over this range, in seconds
+#define REVERB_SHORTEST 0.021
+#define REVERB_LONGEST  0.087
+
+/// level of the input into every line and of the lines in the output
+#define REVERB_INPUT_GAIN  0.25f
+#define REVERB_OUTPUT_GAIN 0.35f
+
+/// added to the input so a tail dying out in silence levels off far below
+/// hearing instead of decaying into denormals, which are very slow on x86
+#define REVERB_DENORMAL_GUARD 1e-18f
+
+static bool is_prime( int n )
+{
+    if ( n < 2 ) return false;
+    for ( int d = 2; d * d <= n; d++ ) {
+        if ( n % d == 0 ) return false;
+    }
+    return true;
+}
+
+void reverb_init( reverb_t * r, float sample_rate )
+{
+    r->decay = 2.0f;
+    r->damping = 6000.0f;
+    r->mix = 0.0f;
+    r->active = 0;
+    r->coef_params[ 0 ] = -1.0f; // forces the first update
+
+    // prime lengths share no factor, so the echoes of different lines
+    // never pile up on the same sample
+    int total = 0;
+    for ( int k = 0; k < REVERB_LINES; k++ ) {
+        double ratio = (double) k / ( REVERB_LINES - 1 );
+        double seconds =
+            REVERB_SHORTEST * pow( REVERB_LONGEST / REVERB_SHORTEST, ratio );
+
+        int length = (int) ( seconds * sample_rate );
+        if ( length < REVERB_BLOCK ) length = REVERB_BLOCK;
+        while ( !is_prime( length ) ) length++;
+
+        r->length[ k ] = length;
+        r->offset[ k ] = total;
+        total += length;
+    }
+
+    r->buffer = new float[ total ];
+}
+
+void reverb_free( reverb_t * r )
+{
+    delete[] r->buffer;
+    r->buffer = nullptr;
+}
+
+int reverb_memory( const reverb_t * r )
+{
+    const int last = REVERB_LINES - 1;
+    return (int) sizeof( float ) * ( r->offset[ last ] + r->length[ last ] );
+}
+
+/// silences every line
+static void reverb_clear( reverb_t * r )
+{
+    memset( r->buffer, 0, reverb_memory( r ) );
+    memset( r->lowpass, 0, sizeof( r->lowpass ) );
+    memset( r->position, 0, sizeof( r->position ) );
+}
+
+/// recomputes the line gains and the damping if either parameter changed
+static void update_coef( reverb_t * r, float sample_rate )
+{
+    const float params[ 2 ] = { r->decay, r->damping };
+    if ( !memcmp( params, r->coef_params, sizeof( params ) ) ) return;
+    memcpy( r->coef_params, params, sizeof( params ) );
+
+    float decay = r->decay > 0.05f ? r->decay : 0.05f;
+    float damping = r->damping > 100.0f ? r->damping : 100.0f;
+    if ( damping > 0.5f * sample_rate ) damping = 0.5f * sample_rate;
+
+    // every pass through line k has to lose its share of the 60 dB
+    for ( int k = 0; k < REVERB_LINES; k++ ) {
+        float passes = decay * sample_rate / r->length[ k ];
+        r->gain[ k ] = powf( 10.0f, -3.0f / passes );
+    }
+
+    float w = 2.0f * (float) M_PI * damping / sample_rate;
+    r->lowpass_coef = 1.0f - expf( -w );
+}
+
+/// four samples of a line starting pos samples after its oldest one
+static inline f32x4 line_load( const float * line, int length, int pos )
+{
+    if ( pos >= length ) pos -= length;
+    if ( pos + SIMD_LANES <= length ) return f32x4_loadu( line + pos );
+
+    SIMD_ALIGN float x[ SIMD_LANES ];
+    for ( int l = 0; l < SIMD_LANES; l++ ) {
+        int p = pos + l;
+        x[ l ] = line[ p < length ? p : p - length ];
+    }
+    return f32x4_load( x );
+}
+
+/// the first count lanes of x into a line from pos samples after its oldest
+static inline void line_store(
+    float * line,
+    int length,
+    int pos,
+    f32x4 x,
+    int count
+)
+{
+    if ( pos >= length ) pos -= length;
+    if ( count == SIMD_LANES && pos + SIMD_LANES <= length ) {
+        f32x4_storeu( line + pos, x );
+        return;
+    }
+
+    SIMD_ALIGN float y[ SIMD_LANES ];
+    f32x4_store( y, x );
+    for ( int l = 0; l < count; l++ ) {
+        int p = pos + l;
+        line[ p < length ? p : p - length ] = y[ l ];
+    }
+}
+
+/// frames from the start of the block the four lines from k can be read and
+/// written as vectors without wrapping, whole groups of four only
+static int unwrapped( const reverb_t * r, int k, int frames )
+{
+    int n = frames;
+    for ( int l = 0; l < SIMD_LANES; l++ ) {
+        int left = r->length[ k + l ] - r->position[ k + l ];
+        if ( left < n ) n = left;
+    }
+    return n - n % SIMD_LANES;
+}
+
+/// reads the oldest frames samples of every line into taps, in frame order
+///
+/// four lines by four frames are transposed at a time; a partial last group
+/// is read whole, the frames past the block are never used
+static void read_taps(
+    const reverb_t * r,
+    float ( *taps )[ REVERB_LINES ],
+    int frames
+)
+{
+    for ( int k = 0; k < REVERB_LINES; k += SIMD_LANES ) {
+        const float * line[ SIMD_LANES ];
+        for ( int l = 0; l < SIMD_LANES; l++ ) {
+            line[ l ] = r->buffer + r->offset[ k + l ];
+        }
+
+        int fast = unwrapped( r, k, frames );
+        for ( int i = 0; i < frames; i += SIMD_LANES ) {
+            f32x4 x[ SIMD_LANES ];
+            for ( int l = 0; l < SIMD_LANES; l++ ) {
+                int length = r->length[ k + l ];
+                int pos = r->position[ k + l ] + i;
+                x[ l ] = i < fast ? f32x4_loadu( line[ l ] + pos )
+                                  : line_load( line[ l ], length, pos );
+            }
+
+            f32x4_transpose( x[ 0 ], x[ 1 ], x[ 2 ], x[ 3 ] );
+            for ( int l = 0; l < SIMD_LANES; l++ ) {
+                f32x4_store( taps[ i + l ] + k, x[ l ] );
+            }
+        }
+    }
+}
+
+/// writes taps back over the samples read_taps() read, and moves every line
+/// on by frames
+static void write_taps(
+    reverb_t * r,
+    float ( *taps )[ REVERB_LINES ],
+    int frames
+)
+{
+    for ( int k = 0; k < REVERB_LINES; k += SIMD_LANES ) {
+        float * line[ SIMD_LANES ];
+        for ( int l = 0; l < SIMD_LANES; l++ ) {
+            line[ l ] = r->buffer + r->offset[ k + l ];
+        }
+
+        int fast = unwrapped( r, k, frames );
+        for ( int i = 0; i < frames; i += SIMD_LANES ) {
+            f32x4 x[ SIMD_LANES ];
+            for ( int l = 0; l < SIMD_LANES; l++ ) {
+                x[ l ] = f32x4_load( taps[ i + l ] + k );
+            }
+
+            f32x4_transpose( x[ 0 ], x[ 1 ], x[ 2 ], x[ 3 ] );
+            int count = frames - i < SIMD_LANES ? frames - i : SIMD_LANES;
+            for ( int l = 0; l < SIMD_LANES; l++ ) {
+                int length = r->length[ k + l ];
+                int pos = r->position[ k + l ] + i;
+                if ( i < fast ) {
+                    f32x4_storeu( line[ l ] + pos, x[ l ] );
+                } else {
+                    line_store( line[ l ], length, pos, x[ l ], count );
+                }
+            }
+        }
+    }
+
+    for ( int k = 0; k < REVERB_LINES; k++ ) {
+        int p = r->position[ k ] + frames;
+        r->position[ k ] = p >= r->length[ k ] ? p - r->length[ k ] : p;
+    }
+}
+
+/// runs up to REVERB_BLOCK frames through the network and puts the tail in
+/// wet
+///
+/// the samples leaving the lines in a block were all written before it, so
+/// they are read up front and the new ones written back at the end; in
+/// between the lines are vectors, lane l of vector v being line 4 v + l
+static void reverb_block(
+    reverb_t * r,
+    float * const * in,
+    float ( *wet )[ REVERB_BLOCK ],
+    int frames
+)
+{
+    const int vectors = REVERB_LINES / SIMD_LANES;
+
+    SIMD_ALIGN float taps[ REVERB_BLOCK ][ REVERB_LINES ];
+    read_taps( r, taps, frames );
+
+    const f32x4 coef = f32x4_set1( r->lowpass_coef );
+    const f32x4 input_gain = f32x4_set1( REVERB_INPUT_GAIN );
+
+    f32x4 gain[ vectors ];
+    f32x4 lowpass[ vectors ];
+    for ( int v = 0; v < vectors; v++ ) {
+        gain[ v ] = f32x4_load( r->gain + SIMD_LANES * v );
+        lowpass[ v ] = f32x4_load( r->lowpass + SIMD_LANES * v );
+    }
+
+    for ( int i = 0; i < frames; i++ ) {
+        f32x4 x[ vectors ];
+        f32x4 out = f32x4_zero();
+
+        for ( int v = 0; v < vectors; v++ ) {
+            f32x4 tap = f32x4_load( taps[ i ] + SIMD_LANES * v );
+            out += tap;
+
+            lowpass[ v ] += ( tap - lowpass[ v ] ) * coef;
+            x[ v ] = lowpass[ v ] * gain[ v ];
+        }
+
+        reverb_mix( x );
+
+        // the even lines take the left input and make the left output, the
+        // odd ones the right
+        SIMD_ALIGN float pair[ SIMD_LANES ];
+        pair[ 0 ] = pair[ 2 ] = in[ 0 ][ i ] + REVERB_DENORMAL_GUARD;
+        pair[ 1 ] = pair[ 3 ] = in[ 1 ][ i ] + REVERB_DENORMAL_GUARD;
+        f32x4 feed = f32x4_load( pair ) * input_gain;
+
+        for ( int v = 0; v < vectors; v++ ) {
+            f32x4_store( taps[ i ] + SIMD_LANES * v, x[ v ] + feed );
+        }
+
+        f32x4_store( pair, out );
+        wet[ 0 ][ i ] = ( pair[ 0 ] + pair[ 2 ] ) * REVERB_OUTPUT_GAIN;
+        wet[ 1 ][ i ] = ( pair[ 1 ] + pair[ 3 ] ) * REVERB_OUTPUT_GAIN;
+    }
+
+    for ( int v = 0; v < vectors; v++ ) {
+        f32x4_store( r->lowpass + SIMD_LANES * v, lowpass[ v ] );
+    }
+
+    // the taps now hold what goes into the lines, in the slots just read
+    write_taps( r, taps, frames );
+}
+
+void reverb_process(
+    reverb_t * r,
+    float * const * io,
+    int frames,
+    float sample_rate
+)
+{
+    if ( r->mix <= 0.0f ) {
+        r->active = 0;
+        return;
+    }
+
+    // a tail left over from before the bypass would come back in
+    if ( !r->active ) {
+        reverb_clear( r );
+        r->active = 1;
+    }
+
+    update_coef( r, sample_rate );
+
+    float * chunk[ 2 ] = { io[ 0 ], io[ 1 ] };
+    while ( frames > 0 ) {
+        int block = frames < REVERB_BLOCK ? frames : REVERB_BLOCK;
+
+        float wet[ 2 ][ REVERB_BLOCK ];
+        reverb_block( r, chunk, wet, block );
+
+        for ( int c = 0; c < 2; c++ ) {
+            for ( int i = 0; i < block; i++ ) {
+                chunk[ c ][ i ] += r->mix * ( wet[ c ][ i ] - chunk[ c ][ i ] );
+            }
+        }
+
+        chunk[ 0 ] += block;
+        chunk[ 1 ] += block;
+        frames -= block;
+    }
+}
@@ -0,0 +1,74 @@
+#pragma once
+
+#include "simd.hpp"
+
+/// delay lines of the feedback delay network, four f32x4 of them
+#define REVERB_LINES 16
+
+/// feedback delay network reverb
+///
+/// every line feeds all the others through an orthogonal matrix, so the
+/// echoes multiply into a dense tail without the matrix adding or taking
+/// energy; only the per line gains set the decay
+struct reverb_t {
+    float decay;   // seconds for the tail to fall by 60 dB
+    float damping; // Hz, the tail loses what is above faster
+    float mix;     // 0 bypasses the effect, 1 is only the tail
+
+    int active;
+
+    /// decay and damping the coefficients below were computed for
+    float coef_params[ 2 ];
+    SIMD_ALIGN float gain[ REVERB_LINES ];
+    float lowpass_coef;
+
+    /// state of the lowpass in every line
+    SIMD_ALIGN float lowpass[ REVERB_LINES ];
+
+    /// all lines back to back in one allocation, line k holds length[ k ]
+    /// samples starting at offset[ k ]; position[ k ] is the oldest sample,
+    /// which is read and then overwritten by the newest one
+    float * buffer;
+    int length[ REVERB_LINES ];
+    int offset[ REVERB_LINES ];
+    int position[ REVERB_LINES ];
+};
+
+/// the feedback matrix, a householder reflection inside every vector and a
+/// hadamard transform across the four of them
+///
+/// both have entries of +-1/2 and are orthogonal, so their product is an
+/// orthogonal matrix of +-1/4 entries that feeds every line into every other;
+/// in the header so --check-reverb can measure the one the reverb runs
+inline void reverb_mix( f32x4 * x )
+{
+    const f32x4 half = f32x4_set1( 0.5f );
+
+    for ( int v = 0; v < REVERB_LINES / SIMD_LANES; v++ ) {
+        x[ v ] = x[ v ] - f32x4_set1( 0.5f * f32x4_sum( x[ v ] ) );
+    }
+
+    f32x4 a = x[ 0 ] + x[ 1 ];
+    f32x4 b = x[ 0 ] - x[ 1 ];
+    f32x4 c = x[ 2 ] + x[ 3 ];
+    f32x4 d = x[ 2 ] - x[ 3 ];
+
+    x[ 0 ] = ( a + c ) * half;
+    x[ 1 ] = ( b + d ) * half;
+    x[ 2 ] = ( a - c ) * half;
+    x[ 3 ] = ( b - d ) * half;
+}
+
+void reverb_init( reverb_t * r, float sample_rate );
+
+void reverb_free( reverb_t * r );
+
+/// bytes of delay memory the reverb allocated
+int reverb_memory( const reverb_t * r );
+
+void reverb_process(
+    reverb_t * r,
+    float * const * io,
+    int frames,
+    float sample_rate
+);
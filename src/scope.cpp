@@ -0,0 +1,176 @@
+#include "scope.hpp"
+
+#include <math.h>
+#include <string.h>
+
+#ifndef M_PI
+#define M_PI ( 3.14159265 )
+#endif
+
+/// a crossing only counts after the signal dipped this far below zero, so
+/// noise around zero does not retrigger
+#define SCOPE_HYSTERESIS 0.01f
+
+/// how far each spectrum update moves the points towards the new one
+#define SCOPE_SPECTRUM_SMOOTHING 0.3f
+
+static_assert( std::atomic< float >::is_always_lock_free );
+
+void scope_init( scope_ring_t * r )
+{
+    for ( auto & x : r->frames ) x.store( 0.0f, std::memory_order_relaxed );
+    r->write_begin.store( 0 );
+    r->write_end.store( 0 );
+}
+
+void scope_write( scope_ring_t * r, const float * frames, int count )
+{
+    if ( count > SCOPE_RING_FRAMES ) {
+        frames += ( count - SCOPE_RING_FRAMES ) * 2;
+        count = SCOPE_RING_FRAMES;
+    }
+
+    uint64_t pos = r->write_end.load( std::memory_order_relaxed );
+
+    r->write_begin.store( pos + count, std::memory_order_relaxed );
+    std::atomic_thread_fence( std::memory_order_release );
+
+    // the fence orders the stores below after the one of write_begin, for
+    // a reader that sees any of them
+    for ( int i = 0; i < count * 2; i++ ) {
+        uint64_t at = ( pos * 2 + i ) & ( SCOPE_RING_FRAMES * 2 - 1 );
+        r->frames[ at ].store( frames[ i ], std::memory_order_relaxed );
+    }
+
+    r->write_end.store( pos + count, std::memory_order_release );
+}
+
+int scope_read( scope_ring_t * r, float * out, int count )
+{
+    uint64_t end = r->write_end.load( std::memory_order_acquire );
+
+    if ( count > SCOPE_RING_FRAMES ) count = SCOPE_RING_FRAMES;
+    if ( (uint64_t) count > end ) count = (int) end;
+
+    uint64_t start = end - count;
+
+    for ( int i = 0; i < count; i++ ) {
+        uint64_t frame = ( start + i ) & ( SCOPE_RING_FRAMES - 1 );
+        out[ i ] = r->frames[ frame * 2 ].load( std::memory_order_relaxed );
+    }
+
+    // anything older than one ring behind the writer may have been replaced
+    // while we were copying; if a load above saw a new sample, the fence
+    // makes the write_begin raised before it visible
+    std::atomic_thread_fence( std::memory_order_acquire );
+    uint64_t begin = r->write_begin.load( std::memory_order_relaxed );
+
+    if ( begin > start + SCOPE_RING_FRAMES ) {
+        int lost = (int) ( begin - start - SCOPE_RING_FRAMES );
+        if ( lost > count ) lost = count;
+
+        count -= lost;
+        memmove( out, out + lost, sizeof( float ) * count );
+    }
+
+    return count;
+}
+
+int scope_trigger( const float * samples, int count, int window )
+{
+    if ( count <= window ) return 0;
+
+    // walk back from the newest start that still fits a whole window
+    int armed = -1;
+    for ( int i = count - window; i > 0; i-- ) {
+        if ( samples[ i - 1 ] <= 0.0f && samples[ i ] > 0.0f ) armed = i;
+
+        if ( armed >= 0 && samples[ i - 1 ] < -SCOPE_HYSTERESIS ) {
+            return armed;
+        }
+    }
+
+    return count - window;
+}
+
+int scope_spectrum_init( scope_spectrum_t * s )
+{
+    if ( fft_real_plan_init( &s->plan, SCOPE_SPECTRUM_SIZE ) ) return 1;
+
+    // the window sums to half its length, and a sine of amplitude a shows
+    // up with a * sum / 2 in its bin
+    for ( int i = 0; i < SCOPE_SPECTRUM_SIZE; i++ ) {
+        double w = 0.5 - 0.5 * cos( 2.0 * M_PI * i / SCOPE_SPECTRUM_SIZE );
+        s->window[ i ] = (float) ( w * 4.0 / SCOPE_SPECTRUM_SIZE );
+    }
+
+    for ( float & p : s->points ) p = 0.0f;
+
+    return 0;
+}
+
+void scope_spectrum_free( scope_spectrum_t * s )
+{
+    fft_real_plan_free( &s->plan );
+}
+
+/// magnitude of bin k of the packed real spectrum
+static float spectrum_bin( const scope_spectrum_t * s, int k )
+{
+    if ( k <= 0 ) return fabsf( s->re[ 0 ] );
+    if ( k >= SCOPE_SPECTRUM_SIZE / 2 ) return fabsf( s->im[ 0 ] );
+    return sqrtf( s->re[ k ] * s->re[ k ] + s->im[ k ] * s->im[ k ] );
+}
+
+void scope_spectrum_update(
+    scope_spectrum_t * s,
+    const float * samples,
+    int count,
+    float sample_rate
+)
+{
+    const int size = SCOPE_SPECTRUM_SIZE;
+
+    int pad = count < size ? size - count : 0;
+    samples += count - ( size - pad );
+    for ( int i = 0; i < size; i++ ) {
+        float x = i < pad ? 0.0f : samples[ i - pad ];
+        s->in[ i ] = x * s->window[ i ];
+    }
+
+    fft_real_forward( &s->plan, s->in, s->re, s->im );
+
+    // the points are spaced evenly in log frequency; where they are further
+    // apart than the bins they take the loudest bin in between, so a
+    // narrow peak is not missed, and below that they interpolate
+    const float nyquist = 0.5f * sample_rate;
+    const float ratio = logf( nyquist / SCOPE_SPECTRUM_LOW );
+    const float bins_per_hz = size / sample_rate;
+
+    for ( int p = 0; p < SCOPE_SPECTRUM_POINTS; p++ ) {
+        float t = (float) p / ( SCOPE_SPECTRUM_POINTS - 1 );
+        float t_next = (float) ( p + 1 ) / ( SCOPE_SPECTRUM_POINTS - 1 );
+        float from = SCOPE_SPECTRUM_LOW * expf( ratio * t ) * bins_per_hz;
+        float to = SCOPE_SPECTRUM_LOW * expf( ratio * t_next ) * bins_per_hz;
+
+        float magnitude;
+        if ( to - from < 1.0f ) {
+            int k = (int) from;
+            float f = from - k;
+            magnitude = spectrum_bin( s, k ) * ( 1.0f - f ) +
+                        spectrum_bin( s, k + 1 ) * f;
+        } else {
+            magnitude = 0.0f;
+            int end = (int) to < size / 2 ? (int) to : size / 2;
+            for ( int k = (int) from; k <= end; k++ ) {
+                magnitude = fmaxf( magnitude, spectrum_bin( s, k ) );
+            }
+        }
+
+        float db = 20.0f * log10f( fmaxf( magnitude, 1e-9f ) );
+        float y = 1.0f - db / SCOPE_SPECTRUM_FLOOR;
+        if ( y < 0.0f ) y = 0.0f;
+
+        s->points[ p ] += ( y - s->points[ p ] ) * SCOPE_SPECTRUM_SMOOTHING;
+    }
+}
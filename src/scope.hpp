@@ -0,0 +1,81 @@
+#pragma once
+
+#include "fft.hpp"
+
+#include <stdint.h>
+
+#include <atomic>
+
+/// frames of stereo output the scope ring holds, power of two
+#define SCOPE_RING_FRAMES 8192
+
+/// samples the spectrum is taken over, a power of two, and the points of
+/// its trace
+#define SCOPE_SPECTRUM_SIZE   2048
+#define SCOPE_SPECTRUM_POINTS 512
+
+/// lowest frequency and level the spectrum shows, in Hz and dB
+#define SCOPE_SPECTRUM_LOW   20.0f
+#define SCOPE_SPECTRUM_FLOOR -96.0f
+
+/// single producer / single consumer ring of stereo output frames
+///
+/// unlike PaUtilRingBuffer the writer never waits for the reader: old frames
+/// are overwritten and the reader only ever asks for the newest ones, so a
+/// stalled ui costs nothing on the audio side. PaUtilRingBuffer cannot be
+/// made to do that, dropping the oldest frames means moving its read index,
+/// which only the reader may touch
+struct scope_ring_t {
+    /// the reader copies while the writer may be overwriting the same
+    /// samples, so they are atomics; relaxed loads and stores of them are
+    /// plain moves
+    std::atomic< float > frames[ SCOPE_RING_FRAMES * 2 ];
+
+    /// frames written so far, raised before and after each copy so a reader
+    /// can tell which of the frames it copied were overwritten meanwhile
+    std::atomic< uint64_t > write_begin;
+    std::atomic< uint64_t > write_end;
+};
+
+void scope_init( scope_ring_t * r );
+
+/// audio side, copies interleaved stereo frames into the ring
+void scope_write( scope_ring_t * r, const float * frames, int count );
+
+/// ui side, copies the left channel of the newest frames into out oldest
+/// first and returns how many it got
+int scope_read( scope_ring_t * r, float * out, int count );
+
+/// finds the newest rising zero crossing that still leaves window samples
+/// after it, falls back to the newest window when there is none
+int scope_trigger( const float * samples, int count, int window );
+
+/// magnitude spectrum of the newest samples on a log frequency axis
+struct scope_spectrum_t {
+    fft_real_plan_t plan;
+
+    /// hann window, scaled so a full scale sine on a bin peaks at 0 dB
+    float window[ SCOPE_SPECTRUM_SIZE ];
+
+    SIMD_ALIGN float in[ SCOPE_SPECTRUM_SIZE ];
+    SIMD_ALIGN float re[ SCOPE_SPECTRUM_SIZE / 2 ];
+    SIMD_ALIGN float im[ SCOPE_SPECTRUM_SIZE / 2 ];
+
+    /// SCOPE_SPECTRUM_LOW up to nyquist, 0 at SCOPE_SPECTRUM_FLOOR and 1
+    /// at full scale, smoothed over successive updates
+    float points[ SCOPE_SPECTRUM_POINTS ];
+};
+
+/// 0 on success
+int scope_spectrum_init( scope_spectrum_t * s );
+
+void scope_spectrum_free( scope_spectrum_t * s );
+
+/// transforms the newest SCOPE_SPECTRUM_SIZE of count samples into points,
+/// zero padded in front when there are fewer
+void scope_spectrum_update(
+    scope_spectrum_t * s,
+    const float * samples,
+    int count,
+    float sample_rate
+);
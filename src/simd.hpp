@@ -0,0 +1,587 @@
+#pragma once
+
+// four lane float/int vectors used by the voice kernels
+//
+// the kernels are written once against this interface; SSE2 and NEON map it
+// to intrinsics, everything else (or a build with SIMD_SCALAR defined) gets a
+// plain array implementation which doubles as the scalar reference path
+
+#include <stdint.h>
+#include <string.h>
+
+#if !defined( SIMD_SCALAR ) &&                                                 \
+    ( defined( __SSE2__ ) || defined( _M_X64 ) ||                              \
+      ( defined( _M_IX86_FP ) && _M_IX86_FP >= 2 ) )
+#define SIMD_SSE2 1
+#include <emmintrin.h>
+#elif !defined( SIMD_SCALAR ) && defined( __ARM_NEON )
+#define SIMD_NEON 1
+#include <arm_neon.h>
+#else
+#ifndef SIMD_SCALAR
+#define SIMD_SCALAR 1
+#endif
+#endif
+
+#define SIMD_LANES 4
+
+#if defined( _MSC_VER )
+#define SIMD_ALIGN __declspec( align( 16 ) )
+#else
+#define SIMD_ALIGN __attribute__( ( aligned( 16 ) ) )
+#endif
+
+#if SIMD_SSE2
+
+struct f32x4 {
+    __m128 v;
+};
+
+struct i32x4 {
+    __m128i v;
+};
+
+inline f32x4 f32x4_set1( float x )
+{
+    return { _mm_set1_ps( x ) };
+}
+
+inline f32x4 f32x4_load( const float * p )
+{
+    return { _mm_load_ps( p ) };
+}
+
+/// like f32x4_load() without the SIMD_ALIGN requirement
+inline f32x4 f32x4_loadu( const float * p )
+{
+    return { _mm_loadu_ps( p ) };
+}
+
+inline void f32x4_store( float * p, f32x4 a )
+{
+    _mm_store_ps( p, a.v );
+}
+
+inline void f32x4_storeu( float * p, f32x4 a )
+{
+    _mm_storeu_ps( p, a.v );
+}
+
+inline f32x4 operator+( f32x4 a, f32x4 b )
+{
+    return { _mm_add_ps( a.v, b.v ) };
+}
+
+inline f32x4 operator-( f32x4 a, f32x4 b )
+{
+    return { _mm_sub_ps( a.v, b.v ) };
+}
+
+inline f32x4 operator*( f32x4 a, f32x4 b )
+{
+    return { _mm_mul_ps( a.v, b.v ) };
+}
+
+inline f32x4 operator/( f32x4 a, f32x4 b )
+{
+    return { _mm_div_ps( a.v, b.v ) };
+}
+
+inline f32x4 f32x4_min( f32x4 a, f32x4 b )
+{
+    return { _mm_min_ps( a.v, b.v ) };
+}
+
+inline f32x4 f32x4_max( f32x4 a, f32x4 b )
+{
+    return { _mm_max_ps( a.v, b.v ) };
+}
+
+/// all bits set in the lanes where a < b
+inline f32x4 f32x4_lt( f32x4 a, f32x4 b )
+{
+    return { _mm_cmplt_ps( a.v, b.v ) };
+}
+
+/// picks a where the mask is set, b elsewhere
+inline f32x4 f32x4_select( f32x4 mask, f32x4 a, f32x4 b )
+{
+    __m128 x = _mm_and_ps( mask.v, a.v );
+    __m128 y = _mm_andnot_ps( mask.v, b.v );
+    return { _mm_or_ps( x, y ) };
+}
+
+inline float f32x4_sum( f32x4 a )
+{
+    __m128 b = _mm_add_ps( a.v, _mm_movehl_ps( a.v, a.v ) );
+    b = _mm_add_ss( b, _mm_shuffle_ps( b, b, 1 ) );
+    return _mm_cvtss_f32( b );
+}
+
+/// transposes the 4x4 matrix with rows a, b, c and d in place
+inline void f32x4_transpose( f32x4 & a, f32x4 & b, f32x4 & c, f32x4 & d )
+{
+    _MM_TRANSPOSE4_PS( a.v, b.v, c.v, d.v );
+}
+
+/// the lanes in the opposite order
+inline f32x4 f32x4_reverse( f32x4 a )
+{
+    return { _mm_shuffle_ps( a.v, a.v, _MM_SHUFFLE( 0, 1, 2, 3 ) ) };
+}
+
+/// splits the pairs in a then b into the first and second of every pair
+inline void f32x4_deinterleave( f32x4 a, f32x4 b, f32x4 & x, f32x4 & y )
+{
+    x.v = _mm_shuffle_ps( a.v, b.v, _MM_SHUFFLE( 2, 0, 2, 0 ) );
+    y.v = _mm_shuffle_ps( a.v, b.v, _MM_SHUFFLE( 3, 1, 3, 1 ) );
+}
+
+/// the opposite of f32x4_deinterleave()
+inline void f32x4_interleave( f32x4 x, f32x4 y, f32x4 & a, f32x4 & b )
+{
+    a.v = _mm_unpacklo_ps( x.v, y.v );
+    b.v = _mm_unpackhi_ps( x.v, y.v );
+}
+
+inline i32x4 i32x4_set1( int32_t x )
+{
+    return { _mm_set1_epi32( x ) };
+}
+
+inline i32x4 i32x4_load( const int32_t * p )
+{
+    return { _mm_load_si128( (const __m128i *) p ) };
+}
+
+inline void i32x4_store( int32_t * p, i32x4 a )
+{
+    _mm_store_si128( (__m128i *) p, a.v );
+}
+
+inline i32x4 operator+( i32x4 a, i32x4 b )
+{
+    return { _mm_add_epi32( a.v, b.v ) };
+}
+
+inline i32x4 operator&( i32x4 a, i32x4 b )
+{
+    return { _mm_and_si128( a.v, b.v ) };
+}
+
+/// logical shift right
+template < int N > inline i32x4 i32x4_srl( i32x4 a )
+{
+    return { _mm_srli_epi32( a.v, N ) };
+}
+
+inline f32x4 i32x4_to_f32x4( i32x4 a )
+{
+    return { _mm_cvtepi32_ps( a.v ) };
+}
+
+/// all bits set in the lanes where a != 0, as a float mask
+inline f32x4 i32x4_nonzero( i32x4 a )
+{
+    __m128i zero = _mm_cmpeq_epi32( a.v, _mm_setzero_si128() );
+    return { _mm_castsi128_ps( _mm_xor_si128( zero, _mm_set1_epi32( -1 ) ) ) };
+}
+
+#elif SIMD_NEON
+
+struct f32x4 {
+    float32x4_t v;
+};
+
+struct i32x4 {
+    int32x4_t v;
+};
+
+inline f32x4 f32x4_set1( float x )
+{
+    return { vdupq_n_f32( x ) };
+}
+
+inline f32x4 f32x4_load( const float * p )
+{
+    return { vld1q_f32( p ) };
+}
+
+inline f32x4 f32x4_loadu( const float * p )
+{
+    return { vld1q_f32( p ) };
+}
+
+inline void f32x4_store( float * p, f32x4 a )
+{
+    vst1q_f32( p, a.v );
+}
+
+inline void f32x4_storeu( float * p, f32x4 a )
+{
+    vst1q_f32( p, a.v );
+}
+
+inline f32x4 operator+( f32x4 a, f32x4 b )
+{
+    return { vaddq_f32( a.v, b.v ) };
+}
+
+inline f32x4 operator-( f32x4 a, f32x4 b )
+{
+    return { vsubq_f32( a.v, b.v ) };
+}
+
+inline f32x4 operator*( f32x4 a, f32x4 b )
+{
+    return { vmulq_f32( a.v, b.v ) };
+}
+
+inline f32x4 operator/( f32x4 a, f32x4 b )
+{
+#if defined( __aarch64__ )
+    return { vdivq_f32( a.v, b.v ) };
+#else
+    // armv7 has no vector divide, refine the reciprocal estimate twice
+    float32x4_t r = vrecpeq_f32( b.v );
+    r = vmulq_f32( r, vrecpsq_f32( b.v, r ) );
+    r = vmulq_f32( r, vrecpsq_f32( b.v, r ) );
+    return { vmulq_f32( a.v, r ) };
+#endif
+}
+
+inline f32x4 f32x4_min( f32x4 a, f32x4 b )
+{
+    return { vminq_f32( a.v, b.v ) };
+}
+
+inline f32x4 f32x4_max( f32x4 a, f32x4 b )
+{
+    return { vmaxq_f32( a.v, b.v ) };
+}
+
+inline f32x4 f32x4_lt( f32x4 a, f32x4 b )
+{
+    return { vreinterpretq_f32_u32( vcltq_f32( a.v, b.v ) ) };
+}
+
+inline f32x4 f32x4_select( f32x4 mask, f32x4 a, f32x4 b )
+{
+    return { vbslq_f32( vreinterpretq_u32_f32( mask.v ), a.v, b.v ) };
+}
+
+inline float f32x4_sum( f32x4 a )
+{
+    float32x2_t b = vadd_f32( vget_low_f32( a.v ), vget_high_f32( a.v ) );
+    return vget_lane_f32( vpadd_f32( b, b ), 0 );
+}
+
+inline void f32x4_transpose( f32x4 & a, f32x4 & b, f32x4 & c, f32x4 & d )
+{
+    // pairs of rows interleaved, a0 b0 a2 b2 / a1 b1 a3 b3 and likewise
+    float32x4x2_t ab = vtrnq_f32( a.v, b.v );
+    float32x4x2_t cd = vtrnq_f32( c.v, d.v );
+    float32x4_t ab0 = ab.val[ 0 ], ab1 = ab.val[ 1 ];
+    float32x4_t cd0 = cd.val[ 0 ], cd1 = cd.val[ 1 ];
+
+    a.v = vcombine_f32( vget_low_f32( ab0 ), vget_low_f32( cd0 ) );
+    b.v = vcombine_f32( vget_low_f32( ab1 ), vget_low_f32( cd1 ) );
+    c.v = vcombine_f32( vget_high_f32( ab0 ), vget_high_f32( cd0 ) );
+    d.v = vcombine_f32( vget_high_f32( ab1 ), vget_high_f32( cd1 ) );
+}
+
+inline f32x4 f32x4_reverse( f32x4 a )
+{
+    float32x4_t b = vrev64q_f32( a.v );
+    return { vcombine_f32( vget_high_f32( b ), vget_low_f32( b ) ) };
+}
+
+inline void f32x4_deinterleave( f32x4 a, f32x4 b, f32x4 & x, f32x4 & y )
+{
+    float32x4x2_t xy = vuzpq_f32( a.v, b.v );
+    x.v = xy.val[ 0 ];
+    y.v = xy.val[ 1 ];
+}
+
+inline void f32x4_interleave( f32x4 x, f32x4 y, f32x4 & a, f32x4 & b )
+{
+    float32x4x2_t ab = vzipq_f32( x.v, y.v );
+    a.v = ab.val[ 0 ];
+    b.v = ab.val[ 1 ];
+}
+
+inline i32x4 i32x4_set1( int32_t x )
+{
+    return { vdupq_n_s32( x ) };
+}
+
+inline i32x4 i32x4_load( const int32_t * p )
+{
+    return { vld1q_s32( p ) };
+}
+
+inline void i32x4_store( int32_t * p, i32x4 a )
+{
+    vst1q_s32( p, a.v );
+}
+
+inline i32x4 operator+( i32x4 a, i32x4 b )
+{
+    return { vaddq_s32( a.v, b.v ) };
+}
+
+inline i32x4 operator&( i32x4 a, i32x4 b )
+{
+    return { vandq_s32( a.v, b.v ) };
+}
+
+template < int N > inline i32x4 i32x4_srl( i32x4 a )
+{
+    uint32x4_t u = vshrq_n_u32( vreinterpretq_u32_s32( a.v ), N );
+    return { vreinterpretq_s32_u32( u ) };
+}
+
+inline f32x4 i32x4_to_f32x4( i32x4 a )
+{
+    return { vcvtq_f32_s32( a.v ) };
+}
+
+inline f32x4 i32x4_nonzero( i32x4 a )
+{
+    return { vreinterpretq_f32_u32( vtstq_s32( a.v, a.v ) ) };
+}
+
+#else
+
+// in its own namespace so a second build of a kernel on this path can be
+// linked next to the vector one without the two clashing, see
+// synth_scalar.cpp
+namespace simd_scalar {
+
+struct f32x4 {
+    float v[ 4 ];
+};
+
+struct i32x4 {
+    int32_t v[ 4 ];
+};
+
+inline uint32_t simd_bits( float x )
+{
+    uint32_t u;
+    memcpy( &u, &x, sizeof( u ) );
+    return u;
+}
+
+inline float simd_float( uint32_t u )
+{
+    float x;
+    memcpy( &x, &u, sizeof( x ) );
+    return x;
+}
+
+inline f32x4 f32x4_set1( float x )
+{
+    return { { x, x, x, x } };
+}
+
+inline f32x4 f32x4_load( const float * p )
+{
+    return { { p[ 0 ], p[ 1 ], p[ 2 ], p[ 3 ] } };
+}
+
+inline f32x4 f32x4_loadu( const float * p )
+{
+    return f32x4_load( p );
+}
+
+inline void f32x4_store( float * p, f32x4 a )
+{
+    for ( int i = 0; i < 4; i++ ) p[ i ] = a.v[ i ];
+}
+
+inline void f32x4_storeu( float * p, f32x4 a )
+{
+    f32x4_store( p, a );
+}
+
+inline f32x4 operator+( f32x4 a, f32x4 b )
+{
+    for ( int i = 0; i < 4; i++ ) a.v[ i ] += b.v[ i ];
+    return a;
+}
+
+inline f32x4 operator-( f32x4 a, f32x4 b )
+{
+    for ( int i = 0; i < 4; i++ ) a.v[ i ] -= b.v[ i ];
+    return a;
+}
+
+inline f32x4 operator*( f32x4 a, f32x4 b )
+{
+    for ( int i = 0; i < 4; i++ ) a.v[ i ] *= b.v[ i ];
+    return a;
+}
+
+inline f32x4 operator/( f32x4 a, f32x4 b )
+{
+    for ( int i = 0; i < 4; i++ ) a.v[ i ] /= b.v[ i ];
+    return a;
+}
+
+inline f32x4 f32x4_min( f32x4 a, f32x4 b )
+{
+    for ( int i = 0; i < 4; i++ ) {
+        if ( b.v[ i ] < a.v[ i ] ) a.v[ i ] = b.v[ i ];
+    }
+    return a;
+}
+
+inline f32x4 f32x4_max( f32x4 a, f32x4 b )
+{
+    for ( int i = 0; i < 4; i++ ) {
+        if ( b.v[ i ] > a.v[ i ] ) a.v[ i ] = b.v[ i ];
+    }
+    return a;
+}
+
+inline f32x4 f32x4_lt( f32x4 a, f32x4 b )
+{
+    f32x4 r;
+    for ( int i = 0; i < 4; i++ ) {
+        r.v[ i ] = simd_float( a.v[ i ] < b.v[ i ] ? 0xffffffffu : 0u );
+    }
+    return r;
+}
+
+inline f32x4 f32x4_select( f32x4 mask, f32x4 a, f32x4 b )
+{
+    f32x4 r;
+    for ( int i = 0; i < 4; i++ ) {
+        uint32_t m = simd_bits( mask.v[ i ] );
+        r.v[ i ] = simd_float(
+            ( m & simd_bits( a.v[ i ] ) ) | ( ~m & simd_bits( b.v[ i ] ) )
+        );
+    }
+    return r;
+}
+
+inline float f32x4_sum( f32x4 a )
+{
+    return ( a.v[ 0 ] + a.v[ 2 ] ) + ( a.v[ 1 ] + a.v[ 3 ] );
+}
+
+inline void f32x4_transpose( f32x4 & a, f32x4 & b, f32x4 & c, f32x4 & d )
+{
+    f32x4 * rows[ 4 ] = { &a, &b, &c, &d };
+    for ( int i = 0; i < 4; i++ ) {
+        for ( int j = i + 1; j < 4; j++ ) {
+            float x = rows[ i ]->v[ j ];
+            rows[ i ]->v[ j ] = rows[ j ]->v[ i ];
+            rows[ j ]->v[ i ] = x;
+        }
+    }
+}
+
+inline f32x4 f32x4_reverse( f32x4 a )
+{
+    return { { a.v[ 3 ], a.v[ 2 ], a.v[ 1 ], a.v[ 0 ] } };
+}
+
+inline void f32x4_deinterleave( f32x4 a, f32x4 b, f32x4 & x, f32x4 & y )
+{
+    x = { { a.v[ 0 ], a.v[ 2 ], b.v[ 0 ], b.v[ 2 ] } };
+    y = { { a.v[ 1 ], a.v[ 3 ], b.v[ 1 ], b.v[ 3 ] } };
+}
+
+inline void f32x4_interleave( f32x4 x, f32x4 y, f32x4 & a, f32x4 & b )
+{
+    a = { { x.v[ 0 ], y.v[ 0 ], x.v[ 1 ], y.v[ 1 ] } };
+    b = { { x.v[ 2 ], y.v[ 2 ], x.v[ 3 ], y.v[ 3 ] } };
+}
+
+inline i32x4 i32x4_set1( int32_t x )
+{
+    return { { x, x, x, x } };
+}
+
+inline i32x4 i32x4_load( const int32_t * p )
+{
+    return { { p[ 0 ], p[ 1 ], p[ 2 ], p[ 3 ] } };
+}
+
+inline void i32x4_store( int32_t * p, i32x4 a )
+{
+    for ( int i = 0; i < 4; i++ ) p[ i ] = a.v[ i ];
+}
+
+/// wraps around like the vector instructions do
+inline i32x4 operator+( i32x4 a, i32x4 b )
+{
+    for ( int i = 0; i < 4; i++ ) {
+        a.v[ i ] = (int32_t) ( (uint32_t) a.v[ i ] + (uint32_t) b.v[ i ] );
+    }
+    return a;
+}
+
+inline i32x4 operator&( i32x4 a, i32x4 b )
+{
+    for ( int i = 0; i < 4; i++ ) a.v[ i ] &= b.v[ i ];
+    return a;
+}
+
+template < int N > inline i32x4 i32x4_srl( i32x4 a )
+{
+    for ( int i = 0; i < 4; i++ ) {
+        a.v[ i ] = (int32_t) ( (uint32_t) a.v[ i ] >> N );
+    }
+    return a;
+}
+
+inline f32x4 i32x4_to_f32x4( i32x4 a )
+{
+    f32x4 r;
+    for ( int i = 0; i < 4; i++ ) r.v[ i ] = (float) a.v[ i ];
+    return r;
+}
+
+inline f32x4 i32x4_nonzero( i32x4 a )
+{
+    f32x4 r;
+    for ( int i = 0; i < 4; i++ ) {
+        r.v[ i ] = simd_float( a.v[ i ] ? 0xffffffffu : 0u );
+    }
+    return r;
+}
+
+#endif
+
+inline f32x4 f32x4_zero()
+{
+    return f32x4_set1( 0.0f );
+}
+
+inline f32x4 & operator+=( f32x4 & a, f32x4 b )
+{
+    a = a + b;
+    return a;
+}
+
+/// looks up one table entry per lane
+inline f32x4 f32x4_gather( const float * table, i32x4 index )
+{
+    SIMD_ALIGN int32_t i[ 4 ];
+    SIMD_ALIGN float x[ 4 ];
+    i32x4_store( i, index );
+    x[ 0 ] = table[ i[ 0 ] ];
+    x[ 1 ] = table[ i[ 1 ] ];
+    x[ 2 ] = table[ i[ 2 ] ];
+    x[ 3 ] = table[ i[ 3 ] ];
+    return f32x4_load( x );
+}
+
+#if SIMD_SCALAR
+} // namespace simd_scalar
+
+using namespace simd_scalar;
+#endif
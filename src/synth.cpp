@@ -0,0 +1,1308 @@
+#include "synth.hpp"
+
+#include "logging.hpp"
+#include "state.hpp"
+#include "wav.hpp"
+
+#include <math.h>
+#include <string.h>
+
+struct note_table_t {
+    float freq[ 128 ];
+};
+
+static constexpr note_table_t make_note_table()
+{
+    // twelfth root of two
+    constexpr double semitone = 1.0594630943592953;
+
+    note_table_t table = {};
+
+    double freq = 440.0;
+    for ( int i = 69; i < 128; i++ ) {
+        table.freq[ i ] = (float) freq;
+        freq *= semitone;
+    }
+
+    freq = 440.0;
+    for ( int i = 69; i >= 0; i-- ) {
+        table.freq[ i ] = (float) freq;
+        freq /= semitone;
+    }
+
+    return table;
+}
+
+/// equal tempered frequency of every midi note, built at compile time
+static constexpr note_table_t note_table = make_note_table();
+
+/// 2^x, within 4e-6 relative error (well under a hundredth of a cent)
+static float fast_exp2( float x )
+{
+    float i = floorf( x );
+    float f = x - i;
+
+    // polynomial fit of 2^f on [0, 1) through chebyshev nodes
+    float p = 1.0000035f +
+              f * ( 0.69297292f +
+                    f * ( 0.24160436f +
+                          f * ( 0.05174500f + f * 0.01367031f ) ) );
+
+    // scale by 2^i through the exponent bits
+    int32_t e = ( (int32_t) i + 127 ) << 23;
+    float scale;
+    memcpy( &scale, &e, sizeof( scale ) );
+
+    return p * scale;
+}
+
+/// frequency of a fractional midi pitch, the fraction is applied with
+/// fast_exp2() on top of the note table
+static float pitch_to_freq( float pitch )
+{
+    if ( pitch < 0.0f ) pitch = 0.0f;
+    if ( pitch > 127.0f ) pitch = 127.0f;
+
+    int note = (int) pitch;
+    float cents = pitch - note;
+
+    return note_table.freq[ note ] * fast_exp2( cents * ( 1.0f / 12.0f ) );
+}
+
+static void remove_voice( synth_t::voice_pool_t & v, int index )
+{
+    array_swap_last( v.midi_no, v.count, index );
+    array_swap_last( v.gate, v.count, index );
+    array_swap_last( v.age, v.count, index );
+    array_swap_last( v.pitch, v.count, index );
+    for ( int u = 0; u < UNISON_MAX; u++ ) {
+        array_swap_last( v.phase[ u ], v.count, index );
+        array_swap_last( v.phase_inc[ u ], v.count, index );
+    }
+    array_swap_last( v.eg_out, v.count, index );
+    array_swap_last( v.eg_stage, v.count, index );
+    array_swap_last( v.eg_dist, v.count, index );
+    array_swap_last( v.eg_target, v.count, index );
+    for ( int c = 0; c < 2; c++ ) {
+        for ( int k = 0; k < VCF_STATE_COUNT; k++ ) {
+            array_swap_last( v.vcf_state[ c ][ k ], v.count, index );
+            array_swap_last( v.fade_vcf_state[ c ][ k ], v.count, index );
+        }
+    }
+    v.count--;
+
+    // the vacated slot becomes a padding lane, make sure it stays silent
+    v.gate[ v.count ] = 0;
+    v.eg_out[ v.count ] = 0.0f;
+    v.eg_stage[ v.count ] = EG_IDLE;
+    v.eg_dist[ v.count ] = 0.0f;
+    v.eg_target[ v.count ] = 0.0f;
+    for ( int c = 0; c < 2; c++ ) {
+        for ( int k = 0; k < VCF_STATE_COUNT; k++ ) {
+            v.vcf_state[ c ][ k ][ v.count ] = 0.0f;
+            v.fade_vcf_state[ c ][ k ][ v.count ] = 0.0f;
+        }
+    }
+}
+
+/// picks the voice a new note is played on, stealing the oldest voice (the
+/// oldest released one if there is any) when the pool is full
+static int allocate_voice( synth_t::voice_pool_t & v )
+{
+    if ( v.count < VOICE_COUNT ) {
+        int index = v.count++;
+        for ( int u = 0; u < UNISON_MAX; u++ ) {
+            // unison oscillators starting in phase would sum into one loud
+            // click; golden ratio steps line harmonics up at fibonacci
+            // numbers (13 steps are 8.03 turns), so the steps are scrambled
+            // by the murmur3 finalizer
+            uint32_t x = 0x9e3779b9u * u;
+            x ^= x >> 16;
+            x *= 0x85ebca6bu;
+            x ^= x >> 13;
+            x *= 0xc2b2ae35u;
+            x ^= x >> 16;
+            v.phase[ u ][ index ] = (int32_t) x;
+            v.phase_inc[ u ][ index ] = 0;
+        }
+        v.eg_out[ index ] = 0.0f;
+        v.eg_dist[ index ] = 0.0f;
+        v.eg_target[ index ] = 0.0f;
+        for ( int c = 0; c < 2; c++ ) {
+            for ( int k = 0; k < VCF_STATE_COUNT; k++ ) {
+                v.vcf_state[ c ][ k ][ index ] = 0.0f;
+                v.fade_vcf_state[ c ][ k ][ index ] = 0.0f;
+            }
+        }
+        return index;
+    }
+
+    int oldest = 0;
+    int oldest_released = -1;
+    for ( int i = 0; i < v.count; i++ ) {
+        if ( v.age[ i ] < v.age[ oldest ] ) oldest = i;
+        if ( !v.gate[ i ] ) {
+            if ( oldest_released < 0 || v.age[ i ] < v.age[ oldest_released ] )
+                oldest_released = i;
+        }
+    }
+
+    return oldest_released >= 0 ? oldest_released : oldest;
+}
+
+static void note_on( synth_t * s, int midi_no )
+{
+    synth_t::voice_pool_t & v = s->voice;
+
+    int index = -1;
+    for ( int i = 0; i < v.count; i++ ) {
+        if ( v.midi_no[ i ] == midi_no ) {
+            index = i;
+            break;
+        }
+    }
+
+    if ( index < 0 ) {
+        index = allocate_voice( v );
+        v.pitch[ index ] = s->vco.glide > 0.0f ? s->last_pitch : midi_no;
+    }
+
+    s->last_pitch = midi_no;
+
+    v.midi_no[ index ] = midi_no;
+    v.gate[ index ] = 1;
+    v.age[ index ] = s->note_counter++;
+    v.eg_stage[ index ] = EG_ATTACK;
+}
+
+static void note_off( synth_t * s, int midi_no )
+{
+    synth_t::voice_pool_t & v = s->voice;
+
+    for ( int i = 0; i < v.count; i++ ) {
+        if ( v.gate[ i ] && v.midi_no[ i ] == midi_no ) {
+            v.gate[ i ] = 0;
+            v.eg_stage[ i ] = EG_RELEASE;
+        }
+    }
+}
+
+/// name and range of a synth_param_t; a midi controller moves it over the
+/// range, exponentially for frequencies and times
+struct param_info_t {
+    const char * name;
+    float low;
+    float high;
+    bool exponential;
+};
+
+/// the three parameters of the mod_slot_t called "mod<n>"
+#define MOD_SLOT_PARAMS( n )                                  \
+    { "mod" n "_source", 0.0f, MOD_SOURCE_COUNT - 1, false }, \
+    { "mod" n "_dest", 0.0f, MOD_DEST_COUNT - 1, false },     \
+    { "mod" n "_amount", -4.0f, 4.0f, false }
+
+static const param_info_t param_info[ PARAM_COUNT ] = {
+    { "vco_wave", 0.0f, VCO_WAVE_COUNT - 1, false },
+    { "pulse_width", 0.05f, 0.95f, false },
+    { "unison", 1.0f, UNISON_MAX, false },
+    { "detune", 0.0f, 2.0f, false },
+    { "spread", 0.0f, 1.0f, false },
+    { "cutoff", 20.0f, 20000.0f, true },
+    { "resonance", 0.0f, 1.0f, false },
+    { "vcf_mode", 0.0f, VCF_MODE_COUNT - 1, false },
+    { "attack", 0.001f, 10.0f, true },
+    { "decay", 0.001f, 10.0f, true },
+    { "sustain", 0.0f, 1.0f, false },
+    { "release", 0.001f, 10.0f, true },
+    { "drive", 0.0f, 20.0f, false },
+    { "oversample", 1.0f, OVERSAMPLE_MAX, false },
+    { "chorus_rate", 0.01f, 10.0f, true },
+    { "chorus_delay", 0.001f, 0.04f, true },
+    { "chorus_depth", 0.0f, 0.01f, false },
+    { "chorus_mix", 0.0f, 1.0f, false },
+    { "flanger_rate", 0.01f, 10.0f, true },
+    { "flanger_delay", 0.0005f, 0.01f, true },
+    { "flanger_depth", 0.0f, 0.01f, false },
+    { "flanger_feedback", -0.95f, 0.95f, false },
+    { "flanger_mix", 0.0f, 1.0f, false },
+    { "echo_time_left", 0.01f, 2.0f, true },
+    { "echo_time_right", 0.01f, 2.0f, true },
+    { "echo_feedback", 0.0f, 0.95f, false },
+    { "echo_mix", 0.0f, 1.0f, false },
+    { "reverb_decay", 0.1f, 20.0f, true },
+    { "reverb_damping", 500.0f, 20000.0f, true },
+    { "reverb_mix", 0.0f, 1.0f, false },
+    { "lfo1_rate", 0.01f, 50.0f, true },
+    { "lfo1_wave", 0.0f, LFO_WAVE_COUNT - 1, false },
+    { "lfo2_rate", 0.01f, 50.0f, true },
+    { "lfo2_wave", 0.0f, LFO_WAVE_COUNT - 1, false },
+    MOD_SLOT_PARAMS( "1" ),
+    MOD_SLOT_PARAMS( "2" ),
+    MOD_SLOT_PARAMS( "3" ),
+    MOD_SLOT_PARAMS( "4" ),
+    MOD_SLOT_PARAMS( "5" ),
+    MOD_SLOT_PARAMS( "6" ),
+    MOD_SLOT_PARAMS( "7" ),
+    MOD_SLOT_PARAMS( "8" ),
+};
+
+#undef MOD_SLOT_PARAMS
+
+static_assert( MOD_SLOT_COUNT == 8, "one MOD_SLOT_PARAMS() per slot" );
+
+/// midi controllers mapped to parameters, any other one moves the cutoff
+/// over 100 - 5100 Hz
+static const struct {
+    int control;
+    int param;
+} control_map[] = {
+    { 1, PARAM_MOD1_AMOUNT }, // mod wheel
+    { 71, PARAM_RESONANCE },  // sound controller 2, timbre
+    { 72, PARAM_RELEASE },    // sound controller 3, release time
+    { 73, PARAM_ATTACK },     // sound controller 4, attack time
+    { 74, PARAM_CUTOFF },     // sound controller 5, brightness
+    { 75, PARAM_DECAY },      // sound controller 6, decay time
+    { 91, PARAM_REVERB_MIX }, // reverb send
+    { 93, PARAM_CHORUS_MIX }, // chorus send
+    { 94, PARAM_DETUNE },     // celeste depth
+};
+
+/// clamps x to the range of the parameter and sets it
+static void set_param( synth_t * s, int param, float x )
+{
+    if ( param < 0 || param >= PARAM_COUNT ) return;
+
+    const param_info_t & info = param_info[ param ];
+    x = fminf( fmaxf( x, info.low ), info.high );
+
+    // every slot has the first one's three parameters
+    if ( param >= PARAM_MOD1_SOURCE ) {
+        const int offset = param - PARAM_MOD1_SOURCE;
+        mod_slot_t & slot = s->mod[ offset / 3 ];
+
+        switch ( PARAM_MOD1_SOURCE + offset % 3 ) {
+        case PARAM_MOD1_SOURCE: slot.source = (int) lroundf( x ); break;
+        case PARAM_MOD1_DEST: slot.dest = (int) lroundf( x ); break;
+        case PARAM_MOD1_AMOUNT: slot.amount = x; break;
+        }
+        return;
+    }
+
+    switch ( param ) {
+    case PARAM_VCO_WAVE: s->vco.vco_wave = roundf( x ); break;
+    case PARAM_PULSE_WIDTH: s->vco.pulse_width = x; break;
+    case PARAM_UNISON: s->unison.count = (int) lroundf( x ); break;
+    case PARAM_DETUNE: s->unison.detune = x; break;
+    case PARAM_SPREAD: s->unison.spread = x; break;
+    case PARAM_CUTOFF: s->vcf.cutoff = x; break;
+    case PARAM_RESONANCE: s->vcf.resonance = x; break;
+    case PARAM_VCF_MODE: s->vcf.vcf_mode = (int) lroundf( x ); break;
+    case PARAM_ATTACK: s->eg.attack = x; break;
+    case PARAM_DECAY: s->eg.decay = x; break;
+    case PARAM_SUSTAIN: s->eg.sustain = x; break;
+    case PARAM_RELEASE: s->eg.release = x; break;
+    case PARAM_DRIVE: s->drive.drive = x; break;
+    case PARAM_OVERSAMPLE: s->drive.oversample = (int) lroundf( x ); break;
+    case PARAM_CHORUS_RATE: s->chorus.rate = x; break;
+    case PARAM_CHORUS_DELAY: s->chorus.delay = x; break;
+    case PARAM_CHORUS_DEPTH: s->chorus.depth = x; break;
+    case PARAM_CHORUS_MIX: s->chorus.mix = x; break;
+    case PARAM_FLANGER_RATE: s->flanger.rate = x; break;
+    case PARAM_FLANGER_DELAY: s->flanger.delay = x; break;
+    case PARAM_FLANGER_DEPTH: s->flanger.depth = x; break;
+    case PARAM_FLANGER_FEEDBACK: s->flanger.feedback = x; break;
+    case PARAM_FLANGER_MIX: s->flanger.mix = x; break;
+    case PARAM_ECHO_TIME_LEFT: s->echo.time_left = x; break;
+    case PARAM_ECHO_TIME_RIGHT: s->echo.time_right = x; break;
+    case PARAM_ECHO_FEEDBACK: s->echo.feedback = x; break;
+    case PARAM_ECHO_MIX: s->echo.mix = x; break;
+    case PARAM_REVERB_DECAY: s->reverb.decay = x; break;
+    case PARAM_REVERB_DAMPING: s->reverb.damping = x; break;
+    case PARAM_REVERB_MIX: s->reverb.mix = x; break;
+    case PARAM_LFO1_RATE: s->lfo[ 0 ].lfo_rate = x; break;
+    case PARAM_LFO1_WAVE: s->lfo[ 0 ].lfo_wave = roundf( x ); break;
+    case PARAM_LFO2_RATE: s->lfo[ 1 ].lfo_rate = x; break;
+    case PARAM_LFO2_WAVE: s->lfo[ 1 ].lfo_wave = roundf( x ); break;
+    }
+}
+
+static void control_change( synth_t * s, int control, int value )
+{
+    float t = (float) value / 0x7f;
+
+    for ( const auto & map : control_map ) {
+        if ( map.control != control ) continue;
+
+        // one going both ways starts from 0, a controller at rest leaves
+        // it off
+        const param_info_t & info = param_info[ map.param ];
+        const float low = fmaxf( info.low, 0.0f );
+        float x = info.exponential ? low * powf( info.high / low, t )
+                                   : low + ( info.high - low ) * t;
+        set_param( s, map.param, x );
+        return;
+    }
+
+    s->vcf.cutoff = 100.0f + t * 5000.0f;
+}
+
+static void handle_command( synth_t * s, const synth_command_t & command )
+{
+    if ( command.type == synth_command_t::MIDI_START ) {
+        note_on( s, command.value );
+    }
+    if ( command.type == synth_command_t::MIDI_STOP ) {
+        note_off( s, command.value );
+    }
+    if ( command.type == synth_command_t::MIDI_CONTROL ) {
+        control_change( s, command.param, command.value );
+    }
+    if ( command.type == synth_command_t::MIDI_BEND ) {
+        s->vco.bend = ( command.value - 0x2000 ) * ( 1.0f / 0x2000 ) *
+                      s->vco.bend_range;
+    }
+    if ( command.type == synth_command_t::MIDI_PROGRAM ) {
+        s->vco.vco_wave = (float) ( command.value % VCO_WAVE_COUNT );
+    }
+    if ( command.type == synth_command_t::SET_PARAM ) {
+        set_param( s, command.param, command.amount );
+    }
+}
+
+/// advances the lfos to the end of the control block and runs the matrix
+static void update_mod( synth_t * s, int frames )
+{
+    float sources[ MOD_SOURCE_COUNT ] = {};
+
+    for ( int i = 0; i < LFO_COUNT; i++ ) {
+        synth_t::lfo_t & lfo = s->lfo[ i ];
+        sources[ MOD_SOURCE_LFO1 + i ] = lfo_advance(
+            &lfo.state,
+            lfo.lfo_rate,
+            (int) lfo.lfo_wave,
+            frames,
+            SAMPLE_RATE
+        );
+    }
+
+    mod_apply( s->mod, MOD_SLOT_COUNT, sources, s->mod_out );
+}
+
+/// advances glide and ramps the phase increments towards the pitch at the
+/// end of the control block
+static void update_pitch( synth_t * s, int frames )
+{
+    synth_t::voice_pool_t & v = s->voice;
+
+    // one full cycle is 2^32
+    const double phase_per_hz = 4294967296.0 / SAMPLE_RATE;
+
+    float glide = 1.0f;
+    if ( s->vco.glide > 0.0f ) {
+        glide = 1.0f - expf( -frames / ( s->vco.glide * SAMPLE_RATE ) );
+    }
+
+    float bend = s->vco.bend + s->mod_out[ MOD_DEST_PITCH ];
+
+    // frequency ratio of every unison oscillator to the note, evenly spaced
+    // over the detune and ascending, so the last one is the highest
+    synth_t::unison_t & unison = s->unison;
+    if ( unison.count < 1 ) unison.count = 1;
+    if ( unison.count > UNISON_MAX ) unison.count = UNISON_MAX;
+
+    double ratio[ UNISON_MAX ] = { 1.0 };
+    for ( int u = 0; unison.count > 1 && u < unison.count; u++ ) {
+        float offset = unison.detune * ( (float) u / ( unison.count - 1 ) -
+                                         0.5f );
+        ratio[ u ] = fast_exp2( offset * ( 1.0f / 12.0f ) );
+    }
+
+    for ( int j = 0; j < v.count; j++ ) {
+        v.pitch[ j ] += ( v.midi_no[ j ] - v.pitch[ j ] ) * glide;
+
+        float freq = pitch_to_freq( v.pitch[ j ] + bend );
+        double note_inc = freq * phase_per_hz;
+
+        // the table has to be clean for the highest oscillator
+        double top = note_inc * ratio[ unison.count - 1 ] + 0.5;
+        v.table_offset[ j ] = wavetable_offset( (uint32_t) top );
+
+        // a new voice, and an oscillator the voice did not play so far,
+        // start right on their pitch
+        bool start = v.phase_inc[ 0 ][ j ] == 0;
+
+        for ( int u = 0; u < unison.count; u++ ) {
+            uint32_t inc = (uint32_t) ( note_inc * ratio[ u ] + 0.5 );
+            if ( start || u >= unison.rendered ) {
+                v.phase_inc[ u ][ j ] = (int32_t) inc;
+            }
+
+            int64_t delta = (int64_t) inc - (uint32_t) v.phase_inc[ u ][ j ];
+            v.phase_inc_step[ u ][ j ] = (int32_t) ( delta / frames );
+
+            // the ramp stops short by less than a step, which would leave
+            // a low note off by hundredths of a cent for as long as it holds
+            if ( delta / frames == 0 ) v.phase_inc[ u ][ j ] = (int32_t) inc;
+        }
+    }
+
+    unison.rendered = unison.count;
+}
+
+/// reads a wavetable at a fixed point phase, interpolating linearly between
+/// the two neighbouring entries; offset selects a table per lane
+static inline f32x4 osc_lookup( const float * table, i32x4 phase, i32x4 offset )
+{
+    const i32x4 frac_mask = i32x4_set1( ( 1 << PHASE_FRAC_BITS ) - 1 );
+    const f32x4 frac_scale = f32x4_set1( 1.0f / ( 1 << PHASE_FRAC_BITS ) );
+
+    i32x4 index = i32x4_srl< PHASE_FRAC_BITS >( phase ) + offset;
+    f32x4 frac = i32x4_to_f32x4( phase & frac_mask ) * frac_scale;
+
+    f32x4 a = f32x4_gather( table, index );
+    f32x4 b = f32x4_gather( table + 1, index );
+
+    return a + ( b - a ) * frac;
+}
+
+/// recomputes the envelope segments if any parameter changed
+static void update_eg( synth_t * s )
+{
+    synth_t::eg_t & eg = s->eg;
+
+    const float params[ 4 ] = { eg.attack, eg.decay, eg.sustain, eg.release };
+    if ( !memcmp( params, eg.coef_params, sizeof( params ) ) ) return;
+
+    eg.coef =
+        eg_coef( eg.attack, eg.decay, eg.sustain, eg.release, SAMPLE_RATE );
+    memcpy( eg.coef_params, params, sizeof( params ) );
+}
+
+/// the polyblep residual of a rising step of 2 at t = 0, t is the phase in
+/// cycles and the correction spans one sample on either side of the step
+static inline f32x4 poly_blep( f32x4 t, f32x4 dt, f32x4 inv_dt )
+{
+    const f32x4 zero = f32x4_zero();
+    const f32x4 one = f32x4_set1( 1.0f );
+
+    // the sample after the step, x in [0, 1)
+    f32x4 a = t * inv_dt - one;
+    f32x4 after = zero - a * a;
+
+    // the sample before it, x in [-1, 0)
+    f32x4 b = ( t - one ) * inv_dt + one;
+    f32x4 before = b * b;
+
+    f32x4 r = f32x4_select( f32x4_lt( one - dt, t ), before, zero );
+    return f32x4_select( f32x4_lt( t, dt ), after, r );
+}
+
+/// the polyblamp residual of a slope change of 2 per sample at t = 0, the
+/// integral of poly_blep()
+static inline f32x4 poly_blamp( f32x4 t, f32x4 dt, f32x4 inv_dt )
+{
+    const f32x4 zero = f32x4_zero();
+    const f32x4 one = f32x4_set1( 1.0f );
+    const f32x4 third = f32x4_set1( 1.0f / 3.0f );
+
+    f32x4 a = one - t * inv_dt;
+    f32x4 after = a * a * a * third;
+
+    f32x4 b = ( t - one ) * inv_dt + one;
+    f32x4 before = b * b * b * third;
+
+    f32x4 r = f32x4_select( f32x4_lt( one - dt, t ), before, zero );
+    return f32x4_select( f32x4_lt( t, dt ), after, r );
+}
+
+/// wraps a phase in cycles that went below zero back into [0, 1)
+static inline f32x4 wrap_phase( f32x4 t )
+{
+    const f32x4 zero = f32x4_zero();
+    return f32x4_select( f32x4_lt( t, zero ), t + f32x4_set1( 1.0f ), t );
+}
+
+/// the oscillator of one waveform at a fixed point phase
+///
+/// the table waves read a band-limited table at their octave; the blep waves
+/// are the same shapes (and a pulse) computed directly, with polynomial
+/// corrections at the steps and corners so nothing above nyquist is left to
+/// alias back except what the polynomials do not catch
+template < int WAVE >
+static inline f32x4 osc_sample(
+    const wavetables_t * tables,
+    i32x4 phase,
+    i32x4 phase_inc,
+    i32x4 table_offset,
+    f32x4 pulse_width
+)
+{
+    if constexpr ( WAVE == VCO_SINE ) {
+        // the sine is pure and needs no band-limited tables
+        return osc_lookup( tables->sine, phase, i32x4_set1( 0 ) );
+    } else if constexpr ( WAVE == VCO_SAWTOOTH ) {
+        return osc_lookup( tables->sawtooth.table[ 0 ], phase, table_offset );
+    } else if constexpr ( WAVE == VCO_TRIANGLE ) {
+        return osc_lookup( tables->triangle.table[ 0 ], phase, table_offset );
+    } else {
+        const f32x4 zero = f32x4_zero();
+        const f32x4 one = f32x4_set1( 1.0f );
+        const f32x4 two = f32x4_set1( 2.0f );
+        const f32x4 half = f32x4_set1( 0.5f );
+
+        // 24 bits are plenty for the phase in cycles, and keep the unsigned
+        // fixed point values positive as signed integers
+        const f32x4 scale = f32x4_set1( 1.0f / ( 1 << 24 ) );
+        f32x4 t = i32x4_to_f32x4( i32x4_srl< 8 >( phase ) ) * scale;
+        f32x4 dt = i32x4_to_f32x4( i32x4_srl< 8 >( phase_inc ) ) * scale;
+
+        // padding lanes have no increment
+        dt = f32x4_max( dt, f32x4_set1( 1e-6f ) );
+        f32x4 inv_dt = one / dt;
+
+        if constexpr ( WAVE == VCO_BLEP_SAWTOOTH ) {
+            // falling ramp from 1 to -1 like the table, it jumps up by 2
+            f32x4 y = one - two * t;
+            return y + poly_blep( t, dt, inv_dt );
+        } else if constexpr ( WAVE == VCO_BLEP_PULSE ) {
+            f32x4 high = f32x4_lt( t, pulse_width );
+            f32x4 y = f32x4_select( high, one, zero - one );
+            f32x4 t_down = wrap_phase( t - pulse_width );
+            return y + poly_blep( t, dt, inv_dt ) -
+                   poly_blep( t_down, dt, inv_dt );
+        } else {
+            // -| 2t - 1 | like the table, the slope turns by 4 per cycle at
+            // both corners
+            f32x4 a = two * t - one;
+            f32x4 y = f32x4_min( a, zero - a );
+
+            f32x4 t_top = wrap_phase( t - half );
+            f32x4 corner = two * dt;
+            return y + corner * ( poly_blamp( t, dt, inv_dt ) -
+                                  poly_blamp( t_top, dt, inv_dt ) );
+        }
+    }
+}
+
+/// what the kernels ramp across a control block, from the values the last
+/// block ended on to the ones this block ends on
+struct block_params_t {
+    vcf_coef_t vcf_from;
+    vcf_coef_t vcf_to;
+
+    float pulse_width_from;
+    float pulse_width_to;
+
+    /// oscillators per note, and whether they are panned apart
+    int unison;
+    bool stereo;
+
+    /// level of every unison oscillator in the left and right channel
+    float unison_left[ UNISON_MAX ];
+    float unison_right[ UNISON_MAX ];
+};
+
+/// adds unison oscillator u of SIMD_LANES voices starting at j into left,
+/// and right when STEREO
+template < int WAVE, bool STEREO >
+static void render_unison(
+    synth_t * s,
+    int j,
+    int u,
+    f32x4 * left,
+    f32x4 * right,
+    int frames,
+    const block_params_t & params
+)
+{
+    synth_t::voice_pool_t & v = s->voice;
+
+    const i32x4 table_offset = i32x4_load( v.table_offset + j );
+    const i32x4 phase_inc_step = i32x4_load( v.phase_inc_step[ u ] + j );
+    const f32x4 level_left = f32x4_set1( params.unison_left[ u ] );
+    const f32x4 level_right = f32x4_set1( params.unison_right[ u ] );
+
+    i32x4 phase = i32x4_load( v.phase[ u ] + j );
+    i32x4 phase_inc = i32x4_load( v.phase_inc[ u ] + j );
+
+    const float pw_from = params.pulse_width_from;
+    const float pw_to = params.pulse_width_to;
+    const f32x4 pw_step = f32x4_set1( ( pw_to - pw_from ) / frames );
+    f32x4 pulse_width = f32x4_set1( pw_from );
+
+    for ( int i = 0; i < frames; i++ ) {
+        pulse_width += pw_step;
+        f32x4 osc = osc_sample< WAVE >(
+            s->tables,
+            phase,
+            phase_inc,
+            table_offset,
+            pulse_width
+        );
+        left[ i ] += osc * level_left;
+        if constexpr ( STEREO ) right[ i ] += osc * level_right;
+
+        phase = phase + phase_inc;
+        phase_inc = phase_inc + phase_inc_step;
+    }
+
+    i32x4_store( v.phase[ u ] + j, phase );
+    i32x4_store( v.phase_inc[ u ] + j, phase_inc );
+}
+
+/// renders SIMD_LANES voices starting at j into left and right and filters
+/// them with the given filter state, VCF_STATE_COUNT rows for the left
+/// channel followed by as many for the right
+///
+/// the oscillator and filter are template parameters so the per sample loop
+/// holds no branches, the kernel is picked once per block from voice_kernels;
+/// the unison oscillators of a voice share its envelope and filter, so they
+/// are summed before either is applied
+template < int WAVE, int MODE >
+static void render_lanes(
+    synth_t * s,
+    int j,
+    f32x4 * left,
+    f32x4 * right,
+    int frames,
+    float * const * vcf_state,
+    const block_params_t & params
+)
+{
+    synth_t::voice_pool_t & v = s->voice;
+
+    const f32x4 zero = f32x4_zero();
+    const f32x4 one = f32x4_set1( 1.0f );
+
+    f32x4 eg_out = f32x4_load( v.eg_out + j );
+
+    // the segment every lane is in and the one it moves on to
+    SIMD_ALIGN float seg[ 9 ][ SIMD_LANES ];
+    for ( int l = 0; l < SIMD_LANES; l++ ) {
+        eg_segment_t current, next;
+        eg_segments( s->eg.coef, v.eg_stage[ j + l ], &current, &next );
+
+        // a new stage or new parameters start again from the level
+        seg[ 8 ][ l ] = v.eg_target[ j + l ] == current.target
+                            ? v.eg_dist[ j + l ]
+                            : v.eg_out[ j + l ] - current.target;
+        seg[ 0 ][ l ] = current.coef;
+        seg[ 1 ][ l ] = current.target;
+        seg[ 2 ][ l ] = current.limit;
+        seg[ 3 ][ l ] = current.dir;
+        seg[ 4 ][ l ] = next.coef;
+        seg[ 5 ][ l ] = next.target;
+        seg[ 6 ][ l ] = next.limit;
+        seg[ 7 ][ l ] = next.dir;
+    }
+    f32x4 eg_coef = f32x4_load( seg[ 0 ] );
+    f32x4 eg_target = f32x4_load( seg[ 1 ] );
+    f32x4 eg_limit = f32x4_load( seg[ 2 ] );
+    f32x4 eg_dir = f32x4_load( seg[ 3 ] );
+    f32x4 next_coef = f32x4_load( seg[ 4 ] );
+    f32x4 next_target = f32x4_load( seg[ 5 ] );
+    f32x4 next_limit = f32x4_load( seg[ 6 ] );
+    f32x4 next_dir = f32x4_load( seg[ 7 ] );
+    f32x4 eg_dist = f32x4_load( seg[ 8 ] );
+    f32x4 eg_ends = zero;
+
+    f32x4 eg[ CONTROL_INTERVAL ];
+    for ( int i = 0; i < frames; i++ ) {
+        // one multiply and one add per sample, the segment change is
+        // done with selects so every lane runs the same instructions
+        eg_dist = eg_dist * eg_coef;
+        eg_out = eg_dist + eg_target;
+
+        f32x4 end = f32x4_lt( ( eg_limit - eg_out ) * eg_dir, zero );
+        eg_out = f32x4_select( end, eg_limit, eg_out );
+        eg_dist = f32x4_select( end, eg_limit - next_target, eg_dist );
+        eg_ends += f32x4_select( end, one, zero );
+
+        eg_coef = f32x4_select( end, next_coef, eg_coef );
+        eg_target = f32x4_select( end, next_target, eg_target );
+        eg_limit = f32x4_select( end, next_limit, eg_limit );
+        eg_dir = f32x4_select( end, next_dir, eg_dir );
+
+        // after that the lane holds, sustain and idle keep their level
+        next_coef = f32x4_select( end, one, next_coef );
+        next_target = f32x4_select( end, zero, next_target );
+        next_dir = f32x4_select( end, zero, next_dir );
+
+        eg[ i ] = eg_out;
+    }
+
+    f32x4_store( v.eg_out + j, eg_out );
+    f32x4_store( v.eg_dist + j, eg_dist );
+    f32x4_store( v.eg_target + j, eg_target );
+
+    SIMD_ALIGN float ends[ SIMD_LANES ];
+    f32x4_store( ends, eg_ends );
+    for ( int l = 0; l < SIMD_LANES; l++ ) {
+        int stage = v.eg_stage[ j + l ];
+        v.eg_stage[ j + l ] = eg_advance( stage, (int) ends[ l ] );
+    }
+
+    for ( int i = 0; i < frames; i++ ) left[ i ] = zero;
+    if ( params.stereo ) {
+        for ( int i = 0; i < frames; i++ ) right[ i ] = zero;
+        for ( int u = 0; u < params.unison; u++ ) {
+            render_unison< WAVE, true >(
+                s, j, u, left, right, frames, params );
+        }
+    } else {
+        for ( int u = 0; u < params.unison; u++ ) {
+            render_unison< WAVE, false >(
+                s, j, u, left, right, frames, params );
+        }
+    }
+
+    for ( int i = 0; i < frames; i++ ) left[ i ] = left[ i ] * eg[ i ];
+    vcf_block< MODE >(
+        left,
+        frames,
+        vcf_state,
+        params.vcf_from,
+        params.vcf_to
+    );
+
+    if ( !params.stereo ) {
+        // the right filter follows the left one, so it picks up from the
+        // same place when the spread is turned up
+        for ( int k = 0; k < VCF_STATE_COUNT; k++ ) {
+            memcpy(
+                vcf_state[ VCF_STATE_COUNT + k ],
+                vcf_state[ k ],
+                sizeof( float ) * SIMD_LANES
+            );
+        }
+        return;
+    }
+
+    for ( int i = 0; i < frames; i++ ) right[ i ] = right[ i ] * eg[ i ];
+    vcf_block< MODE >(
+        right,
+        frames,
+        vcf_state + VCF_STATE_COUNT,
+        params.vcf_from,
+        params.vcf_to
+    );
+}
+
+typedef void ( *voice_kernel_t )(
+    synth_t * s,
+    int j,
+    f32x4 * left,
+    f32x4 * right,
+    int frames,
+    float * const * vcf_state,
+    const block_params_t & params
+);
+
+/// every specialization of render_lanes, indexed by waveform and filter mode
+#define VOICE_KERNELS( WAVE )                                                  \
+    {                                                                          \
+        render_lanes< WAVE, VCF_ONE_POLE >,                                    \
+        render_lanes< WAVE, VCF_SVF >,                                         \
+        render_lanes< WAVE, VCF_LADDER >,                                      \
+    }
+
+static const voice_kernel_t
+    voice_kernels[ VCO_WAVE_COUNT ][ VCF_MODE_COUNT ] = {
+        VOICE_KERNELS( VCO_SINE ),
+        VOICE_KERNELS( VCO_SAWTOOTH ),
+        VOICE_KERNELS( VCO_TRIANGLE ),
+        VOICE_KERNELS( VCO_BLEP_SAWTOOTH ),
+        VOICE_KERNELS( VCO_BLEP_PULSE ),
+        VOICE_KERNELS( VCO_BLEP_TRIANGLE ),
+    };
+
+#undef VOICE_KERNELS
+
+/// the oscillator and envelope state of SIMD_LANES voices, the crossfade
+/// runs both kernels from the same starting point
+struct lane_state_t {
+    int32_t phase[ UNISON_MAX ][ SIMD_LANES ];
+    int32_t phase_inc[ UNISON_MAX ][ SIMD_LANES ];
+    float eg_out[ SIMD_LANES ];
+    int32_t eg_stage[ SIMD_LANES ];
+    float eg_dist[ SIMD_LANES ];
+    float eg_target[ SIMD_LANES ];
+};
+
+static void save_lanes(
+    const synth_t::voice_pool_t & v,
+    int j,
+    lane_state_t * state
+)
+{
+    const size_t row = sizeof( int32_t ) * SIMD_LANES;
+    for ( int u = 0; u < UNISON_MAX; u++ ) {
+        memcpy( state->phase[ u ], v.phase[ u ] + j, row );
+        memcpy( state->phase_inc[ u ], v.phase_inc[ u ] + j, row );
+    }
+    memcpy( state->eg_out, v.eg_out + j, sizeof( state->eg_out ) );
+    memcpy( state->eg_stage, v.eg_stage + j, sizeof( state->eg_stage ) );
+    memcpy( state->eg_dist, v.eg_dist + j, sizeof( state->eg_dist ) );
+    memcpy( state->eg_target, v.eg_target + j, sizeof( state->eg_target ) );
+}
+
+static void restore_lanes(
+    synth_t::voice_pool_t & v,
+    int j,
+    const lane_state_t & state
+)
+{
+    const size_t row = sizeof( int32_t ) * SIMD_LANES;
+    for ( int u = 0; u < UNISON_MAX; u++ ) {
+        memcpy( v.phase[ u ] + j, state.phase[ u ], row );
+        memcpy( v.phase_inc[ u ] + j, state.phase_inc[ u ], row );
+    }
+    memcpy( v.eg_out + j, state.eg_out, sizeof( state.eg_out ) );
+    memcpy( v.eg_stage + j, state.eg_stage, sizeof( state.eg_stage ) );
+    memcpy( v.eg_dist + j, state.eg_dist, sizeof( state.eg_dist ) );
+    memcpy( v.eg_target + j, state.eg_target, sizeof( state.eg_target ) );
+}
+
+static int clamp_index( int i, int count )
+{
+    if ( i < 0 ) return 0;
+    if ( i >= count ) return count - 1;
+    return i;
+}
+
+/// picks up waveform and filter mode changes, starting a crossfade from the
+/// kernel that was playing
+static void update_kernel( synth_t * s )
+{
+    synth_t::kernel_t & k = s->kernel;
+
+    int wave = clamp_index( (int) s->vco.vco_wave, VCO_WAVE_COUNT );
+    int mode = clamp_index( s->vcf.vcf_mode, VCF_MODE_COUNT );
+    if ( wave == k.vco_wave && mode == k.vcf_mode ) return;
+
+    // a change during a crossfade waits for it to finish, starting another
+    // would drop the outgoing kernel halfway and click
+    if ( k.fade_left > 0 ) return;
+
+    // the outgoing kernel continues from the filter state it left
+    synth_t::voice_pool_t & v = s->voice;
+    memcpy( v.fade_vcf_state, v.vcf_state, sizeof( v.vcf_state ) );
+
+    k.fade_wave = k.vco_wave;
+    k.fade_mode = k.vcf_mode;
+    k.fade_left = KERNEL_FADE_FRAMES;
+    k.vco_wave = wave;
+    k.vcf_mode = mode;
+}
+
+/// adds all active voices into the left and right mix buffers
+///
+/// voices are rendered SIMD_LANES at a time in lockstep: oscillator lookup
+/// and envelope run on whole lanes into a block buffer, the filter runs over
+/// that buffer, and the per-sample lane sums are reduced into the mix buffers
+/// once at the end
+static void render_voices(
+    synth_t * s,
+    float * mix_left,
+    float * mix_right,
+    int frames
+)
+{
+    synth_t::voice_pool_t & v = s->voice;
+    synth_t::kernel_t & k = s->kernel;
+
+    update_eg( s );
+    update_kernel( s );
+
+    const f32x4 zero = f32x4_zero();
+
+    // filter coefficients and pulse width are computed once per control
+    // block and ramped across it
+    block_params_t params;
+
+    float cutoff = s->vcf.cutoff * fast_exp2( s->mod_out[ MOD_DEST_CUTOFF ] );
+    params.vcf_from = s->vcf.coef;
+    params.vcf_to = vcf_coef( cutoff, s->vcf.resonance, SAMPLE_RATE );
+    s->vcf.coef = params.vcf_to;
+
+    float pw = s->vco.pulse_width + s->mod_out[ MOD_DEST_PULSE_WIDTH ];
+    if ( pw < 0.05f ) pw = 0.05f;
+    if ( pw > 0.95f ) pw = 0.95f;
+    params.pulse_width_from = s->pulse_width;
+    params.pulse_width_to = pw;
+    s->pulse_width = pw;
+
+    // equal power over the stack, and a pan from -spread on the lowest
+    // oscillator to +spread on the highest
+    const synth_t::unison_t & unison = s->unison;
+    params.unison = unison.count;
+    params.stereo = unison.count > 1 && unison.spread > 0.0f;
+
+    float level = 1.0f / sqrtf( (float) unison.count );
+    for ( int u = 0; u < unison.count; u++ ) {
+        float pan = 0.0f;
+        if ( unison.count > 1 ) {
+            pan = unison.spread * ( 2.0f * u / ( unison.count - 1 ) - 1.0f );
+        }
+        params.unison_left[ u ] = level * ( 1.0f - pan );
+        params.unison_right[ u ] = level * ( 1.0f + pan );
+    }
+
+    const voice_kernel_t kernel = voice_kernels[ k.vco_wave ][ k.vcf_mode ];
+    const voice_kernel_t fade_kernel =
+        k.fade_left > 0 ? voice_kernels[ k.fade_wave ][ k.fade_mode ] : nullptr;
+
+    // weight of the new kernel during a crossfade
+    float fade[ CONTROL_INTERVAL ];
+    if ( fade_kernel ) {
+        int done = KERNEL_FADE_FRAMES - k.fade_left;
+        for ( int i = 0; i < frames; i++ ) {
+            float w = (float) ( done + i + 1 ) / KERNEL_FADE_FRAMES;
+            fade[ i ] = w < 1.0f ? w : 1.0f;
+        }
+    }
+
+    // the right channel is only rendered when the voices are panned
+    const int channels = params.stereo ? 2 : 1;
+
+    f32x4 acc[ 2 ][ CONTROL_INTERVAL ];
+    f32x4 buf[ 2 ][ CONTROL_INTERVAL ];
+    f32x4 fade_buf[ 2 ][ CONTROL_INTERVAL ];
+    for ( int c = 0; c < channels; c++ ) {
+        for ( int i = 0; i < frames; i++ ) acc[ c ][ i ] = zero;
+    }
+
+    for ( int j = 0; j < v.count; j += SIMD_LANES ) {
+        float * vcf_state[ 2 * VCF_STATE_COUNT ];
+        float * fade_vcf_state[ 2 * VCF_STATE_COUNT ];
+        for ( int c = 0; c < 2; c++ ) {
+            for ( int k = 0; k < VCF_STATE_COUNT; k++ ) {
+                int row = c * VCF_STATE_COUNT + k;
+                vcf_state[ row ] = v.vcf_state[ c ][ k ] + j;
+                fade_vcf_state[ row ] = v.fade_vcf_state[ c ][ k ] + j;
+            }
+        }
+
+        if ( !fade_kernel ) {
+            kernel( s, j, buf[ 0 ], buf[ 1 ], frames, vcf_state, params );
+            for ( int c = 0; c < channels; c++ ) {
+                for ( int i = 0; i < frames; i++ ) {
+                    acc[ c ][ i ] += buf[ c ][ i ];
+                }
+            }
+            continue;
+        }
+
+        // oscillator and envelope do not depend on the kernel, so both
+        // kernels start from the same state and the new one keeps its result
+        lane_state_t state;
+        save_lanes( v, j, &state );
+        fade_kernel(
+            s,
+            j,
+            fade_buf[ 0 ],
+            fade_buf[ 1 ],
+            frames,
+            fade_vcf_state,
+            params
+        );
+        restore_lanes( v, j, state );
+        kernel( s, j, buf[ 0 ], buf[ 1 ], frames, vcf_state, params );
+
+        for ( int c = 0; c < channels; c++ ) {
+            for ( int i = 0; i < frames; i++ ) {
+                f32x4 w = f32x4_set1( fade[ i ] );
+                f32x4 from = fade_buf[ c ][ i ];
+                acc[ c ][ i ] += from + ( buf[ c ][ i ] - from ) * w;
+            }
+        }
+    }
+
+    if ( k.fade_left > 0 ) {
+        k.fade_left = k.fade_left > frames ? k.fade_left - frames : 0;
+    }
+
+    // amplitude modulation ramps the output gain across the block
+    float gain = 1.0f + s->mod_out[ MOD_DEST_AMP ];
+    if ( gain < 0.0f ) gain = 0.0f;
+
+    float gain_step = ( gain - s->gain ) / frames;
+    float g = s->gain;
+    for ( int i = 0; i < frames; i++ ) {
+        g += gain_step;
+        float left = f32x4_sum( acc[ 0 ][ i ] ) * g;
+        float right = params.stereo ? f32x4_sum( acc[ 1 ][ i ] ) * g : left;
+        mix_left[ i ] += left;
+        mix_right[ i ] += right;
+    }
+    s->gain = gain;
+
+    // free the voices whose release has finished
+    for ( int j = v.count - 1; j >= 0; j-- ) {
+        if ( v.eg_stage[ j ] == EG_IDLE ) remove_voice( v, j );
+    }
+}
+
+/// smooth saturation with unity slope at zero, it reaches +-1 at +-3 with a
+/// flat slope and stays there
+static inline float soft_clip( float x )
+{
+    // clamping the input lands exactly on +-1, and compiles to min / max
+    x = x < -3.0f ? -3.0f : x;
+    x = x > 3.0f ? 3.0f : x;
+
+    float x2 = x * x;
+    return x * ( 27.0f + x2 ) / ( 27.0f + 9.0f * x2 );
+}
+
+/// runs both channels of the mix through the oversampled saturation
+static void render_drive( synth_t * s, float * const * mix, int frames )
+{
+    synth_t::drive_t & d = s->drive;
+
+    if ( d.drive <= 0.0f ) {
+        d.os[ 0 ].factor = 0;
+        return;
+    }
+    if ( d.os[ 0 ].factor != d.oversample ) {
+        oversampler_init( &d.os[ 0 ], d.oversample );
+        oversampler_init( &d.os[ 1 ], d.oversample );
+        d.oversample = d.os[ 0 ].factor;
+    }
+
+    for ( int c = 0; c < 2; c++ ) {
+        float up[ CONTROL_INTERVAL * OVERSAMPLE_MAX ];
+        oversampler_up( &d.os[ c ], mix[ c ], frames, up );
+
+        for ( int i = 0; i < frames * d.oversample; i++ ) {
+            up[ i ] = soft_clip( up[ i ] * d.drive );
+        }
+
+        oversampler_down( &d.os[ c ], up, frames, mix[ c ] );
+    }
+}
+
+/// runs both channels of the mix through the effects
+static void render_effects( synth_t * s, float * const * mix, int frames )
+{
+    chorus_process( &s->chorus, mix, frames, SAMPLE_RATE );
+    flanger_process( &s->flanger, mix, frames, SAMPLE_RATE );
+    echo_process( &s->echo, mix, frames, SAMPLE_RATE );
+    reverb_process( &s->reverb, mix, frames, SAMPLE_RATE );
+    convolver_process( &s->convolver, mix, frames );
+}
+
+void synth_init( synth_t * s )
+{
+    memset( &s->voice, 0, sizeof( s->voice ) );
+    s->note_counter = 0;
+    s->last_pitch = 69.0f;
+
+    s->vco.vco_wave = VCO_TRIANGLE;
+    s->vco.pulse_width = 0.5f;
+    s->vco.bend = 0.0f;
+    s->vco.bend_range = 2.0f;
+    s->vco.glide = 0.0f;
+
+    s->unison.count = 1;
+    s->unison.detune = 0.2f;
+    s->unison.spread = 0.0f;
+    s->unison.rendered = 1;
+
+    s->eg.attack = 0.1f;
+    s->eg.decay = 0.0f;
+    s->eg.sustain = 1.0f;
+    s->eg.release = 0.1f;
+    s->eg.coef_params[ 0 ] = -1.0f; // forces the first update
+    update_eg( s );
+
+    s->lfo[ 0 ].lfo_rate = 5.0f;
+    s->lfo[ 0 ].lfo_wave = LFO_SINE;
+    s->lfo[ 1 ].lfo_rate = 0.5f;
+    s->lfo[ 1 ].lfo_wave = LFO_TRIANGLE;
+    for ( int i = 0; i < LFO_COUNT; i++ ) lfo_init( &s->lfo[ i ].state, i + 1 );
+
+    // nothing is routed until a patch asks for it, but for the mod wheel's
+    // vibrato, at no depth until the wheel moves
+    memset( s->mod, 0, sizeof( s->mod ) );
+    s->mod[ 0 ].source = MOD_SOURCE_LFO1;
+    s->mod[ 0 ].dest = MOD_DEST_PITCH;
+    s->mod[ 0 ].amount = 0.0f;
+    memset( s->mod_out, 0, sizeof( s->mod_out ) );
+    s->pulse_width = s->vco.pulse_width;
+    s->gain = 1.0f;
+
+    s->vcf.cutoff = 500;
+    s->vcf.resonance = 0.0f;
+    s->vcf.vcf_mode = VCF_SVF;
+    s->vcf.coef = vcf_coef( s->vcf.cutoff, s->vcf.resonance, SAMPLE_RATE );
+
+    s->drive.drive = 0.0f;
+    s->drive.oversample = 2;
+    s->drive.os[ 0 ].factor = 0;
+
+    chorus_init( &s->chorus, SAMPLE_RATE );
+    flanger_init( &s->flanger, SAMPLE_RATE );
+    echo_init( &s->echo, SAMPLE_RATE );
+    reverb_init( &s->reverb, SAMPLE_RATE );
+    convolver_init( &s->convolver );
+
+    s->kernel.vco_wave = (int) s->vco.vco_wave;
+    s->kernel.vcf_mode = s->vcf.vcf_mode;
+    s->kernel.fade_left = 0;
+
+    s->pending_count = 0;
+    s->frame = 0;
+    memset( &s->timing, 0, sizeof( s->timing ) );
+
+    void * command_buffer = new synth_command_t[ COMMAND_QUEUE_SIZE ];
+    PaUtil_InitializeRingBuffer(
+        &s->command_queue,
+        sizeof( synth_command_t ),
+        COMMAND_QUEUE_SIZE,
+        command_buffer
+    );
+
+    s->tables = wavetables_get();
+}
+
+void synth_destroy( synth_t * s )
+{
+    delete[] (synth_command_t *) s->command_queue.buffer;
+
+    chorus_free( &s->chorus );
+    flanger_free( &s->flanger );
+    echo_free( &s->echo );
+    reverb_free( &s->reverb );
+    convolver_free( &s->convolver );
+}
+
+int synth_load_ir( synth_t * s, const char * path, bool synchronous )
+{
+    float * ir;
+    int channels, frames, rate;
+    if ( wav_read( path, &ir, &channels, &frames, &rate ) ) return 1;
+
+    if ( channels > 2 ) {
+        ERROR_LOG( "%s has %d channels, at most 2 work", path, channels );
+        delete[] ir;
+        return 1;
+    }
+
+    // played as is, so a response recorded at another rate comes out
+    // stretched in time and pitch
+    if ( rate != SAMPLE_RATE ) {
+        INFO_LOG( "%s is %d Hz, not %d", path, rate, SAMPLE_RATE );
+    }
+
+    convolver_load( &s->convolver, ir, channels, frames, synchronous );
+    delete[] ir;
+
+    INFO_LOG(
+        "loaded %.2f s impulse response %s, %d KiB",
+        (double) frames / SAMPLE_RATE,
+        path,
+        convolver_memory( &s->convolver ) / 1024
+    );
+
+    return 0;
+}
+
+float synth_pitch_to_freq( float pitch )
+{
+    return pitch_to_freq( pitch );
+}
+
+int synth_param_find( const char * name )
+{
+    for ( int i = 0; i < PARAM_COUNT; i++ ) {
+        if ( !strcmp( param_info[ i ].name, name ) ) return i;
+    }
+
+    return -1;
+}
+
+void synth_send( synth_t * s, const synth_command_t & command )
+{
+    PaUtil_WriteRingBuffer( &s->command_queue, &command, 1 );
+}
+
+/// moves everything in the command queue into the pending list, keeping it
+/// sorted by frame (and in arrival order for equal frames)
+static void drain_commands( synth_t * s )
+{
+    synth_command_t command;
+
+    while ( s->pending_count < COMMAND_QUEUE_SIZE &&
+            PaUtil_ReadRingBuffer( &s->command_queue, &command, 1 ) ) {
+        int i = s->pending_count++;
+        while ( i > 0 && s->pending[ i - 1 ].frame > command.frame ) {
+            s->pending[ i ] = s->pending[ i - 1 ];
+            i--;
+        }
+        s->pending[ i ] = command;
+    }
+}
+
+static void record_timing( synth_t::timing_t & t, int64_t late )
+{
+    if ( t.count == 0 || late < t.late_min ) t.late_min = late;
+    if ( t.count == 0 || late > t.late_max ) t.late_max = late;
+    t.late_sum += late;
+    t.late_sum_sq += (double) late * late;
+    t.count++;
+}
+
+void synth_render( synth_t * s, float * out, int frames )
+{
+    drain_commands( s );
+
+    float mix_left[ CONTROL_INTERVAL ];
+    float mix_right[ CONTROL_INTERVAL ];
+    float * const mix[ 2 ] = { mix_left, mix_right };
+
+    // the render loop is split into control blocks, and further at command
+    // frames so every command lands on its exact sample
+    int next = 0;
+
+    while ( frames > 0 ) {
+        while ( next < s->pending_count &&
+                s->pending[ next ].frame <= s->frame ) {
+            if ( s->pending[ next ].frame > 0 ) {
+                record_timing( s->timing, s->frame - s->pending[ next ].frame );
+            }
+            handle_command( s, s->pending[ next ] );
+            next++;
+        }
+
+        int block = frames < CONTROL_INTERVAL ? frames : CONTROL_INTERVAL;
+        if ( next < s->pending_count ) {
+            int64_t until = s->pending[ next ].frame - s->frame;
+            if ( until < block ) block = (int) until;
+        }
+
+        memset( mix_left, 0, sizeof( float ) * block );
+        memset( mix_right, 0, sizeof( float ) * block );
+        update_mod( s, block );
+        update_pitch( s, block );
+        render_voices( s, mix_left, mix_right, block );
+        render_drive( s, mix, block );
+        render_effects( s, mix, block );
+
+        for ( int i = 0; i < block; i++ ) {
+            *out++ = mix_left[ i ];
+            *out++ = mix_right[ i ];
+        }
+
+        s->frame += block;
+        frames -= block;
+    }
+
+    s->pending_count -= next;
+    memmove(
+        s->pending,
+        s->pending + next,
+        sizeof( synth_command_t ) * s->pending_count
+    );
+}
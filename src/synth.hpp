@@ -0,0 +1,334 @@
+#pragma once
+
+#include "convolver.hpp"
+#include "delay.hpp"
+#include "eg.hpp"
+#include "mod.hpp"
+#include "oversample.hpp"
+#include "reverb.hpp"
+#include "simd.hpp"
+#include "vcf.hpp"
+#include "wavetable.hpp"
+
+#include <pa_ringbuffer.h>
+
+#define SAMPLE_RATE       ( 44100 )
+#define FRAMES_PER_BUFFER ( 64 )
+
+/// the oscillator phase is a 32 bit fixed point fraction of a cycle: the top
+/// OSC_TABLE_BITS index the wavetable, the rest interpolate between entries
+#define PHASE_FRAC_BITS ( 32 - OSC_TABLE_BITS )
+
+/// fixed capacity of the voice pool, a multiple of SIMD_LANES
+#define VOICE_COUNT 64
+
+/// capacity of the command queue, a power of two
+#define COMMAND_QUEUE_SIZE 1024
+
+/// most oscillators a note can stack, see synth_t::unison
+#define UNISON_MAX 16
+
+/// length of the crossfade between two voice kernels, see synth_t::kernel
+#define KERNEL_FADE_FRAMES 256
+
+/// the first waveforms read band-limited wavetables, the blep ones are
+/// computed per sample and correct their discontinuities with polynomials
+enum vco_wave_t {
+    VCO_SINE,
+    VCO_SAWTOOTH,
+    VCO_TRIANGLE,
+    VCO_BLEP_SAWTOOTH,
+    VCO_BLEP_PULSE, // width set by pulse_width
+    VCO_BLEP_TRIANGLE,
+    VCO_WAVE_COUNT,
+};
+
+/// patch parameters that can be set by name, see synth_param_find(), or
+/// moved by a midi controller
+enum synth_param_t {
+    PARAM_VCO_WAVE,    // see vco_wave_t
+    PARAM_PULSE_WIDTH, // fraction of a cycle, VCO_BLEP_PULSE
+    PARAM_UNISON,      // oscillators per note, 1 - UNISON_MAX
+    PARAM_DETUNE,      // semitones between the outermost oscillators
+    PARAM_SPREAD,      // stereo width, 0 - 1
+    PARAM_CUTOFF,      // Hz
+    PARAM_RESONANCE,   // 0 - 1
+    PARAM_VCF_MODE,    // see vcf_mode_t
+    PARAM_ATTACK,      // seconds
+    PARAM_DECAY,       // seconds
+    PARAM_SUSTAIN,     // 0 - 1
+    PARAM_RELEASE,     // seconds
+    PARAM_DRIVE,       // gain into the saturation, 0 bypasses it
+    PARAM_OVERSAMPLE,  // 1, 2 or 4
+
+    /// see chorus_t, flanger_t and echo_t, times in seconds
+    PARAM_CHORUS_RATE,
+    PARAM_CHORUS_DELAY,
+    PARAM_CHORUS_DEPTH,
+    PARAM_CHORUS_MIX,
+    PARAM_FLANGER_RATE,
+    PARAM_FLANGER_DELAY,
+    PARAM_FLANGER_DEPTH,
+    PARAM_FLANGER_FEEDBACK,
+    PARAM_FLANGER_MIX,
+    PARAM_ECHO_TIME_LEFT,
+    PARAM_ECHO_TIME_RIGHT,
+    PARAM_ECHO_FEEDBACK,
+    PARAM_ECHO_MIX,
+
+    /// see reverb_t
+    PARAM_REVERB_DECAY,
+    PARAM_REVERB_DAMPING,
+    PARAM_REVERB_MIX,
+
+    PARAM_LFO1_RATE,   // Hz
+    PARAM_LFO1_WAVE,   // see lfo_wave_t
+    PARAM_LFO2_RATE,
+    PARAM_LFO2_WAVE,
+
+    /// the first mod_slot_t, the others follow in turn; the amount is in the
+    /// units of the destination
+    PARAM_MOD1_SOURCE, // see mod_source_t
+    PARAM_MOD1_DEST,   // see mod_dest_t
+    PARAM_MOD1_AMOUNT,
+
+    PARAM_COUNT = PARAM_MOD1_SOURCE + 3 * MOD_SLOT_COUNT,
+};
+
+struct synth_command_t {
+    enum {
+        MIDI_START,
+        MIDI_STOP,
+        MIDI_CONTROL,
+        MIDI_BEND,
+        MIDI_PROGRAM,
+        SET_PARAM,
+    } type;
+
+    int value;
+
+    /// controller number of MIDI_CONTROL, synth_param_t of SET_PARAM
+    int param;
+
+    /// what SET_PARAM sets the parameter to, in its own units
+    float amount;
+
+    /// render frame (see synth_t::frame) the command takes effect on, commands
+    /// that are not in the future are applied at the start of the next block
+    int64_t frame;
+};
+
+struct synth_t {
+    PaUtilRingBuffer command_queue;
+
+    /// commands taken from the queue that are still waiting for their frame,
+    /// sorted by frame
+    synth_command_t pending[ COMMAND_QUEUE_SIZE ];
+    int pending_count;
+
+    /// number of frames rendered so far
+    int64_t frame;
+
+    /// how late scheduled commands (frame > 0) were applied, in frames
+    struct timing_t {
+        int64_t count;
+        int64_t late_min;
+        int64_t late_max;
+        double late_sum;
+        double late_sum_sq;
+    } timing;
+
+    /// voltage controlled oscillator
+    struct vco_t {
+        float pitch;
+        float vco_wave; // see vco_wave_t
+        float pulse_width;
+
+        float bend;       // current pitch bend in semitones
+        float bend_range; // semitones at full pitch wheel deflection
+        float glide;      // portamento time constant in seconds
+    } vco;
+
+    /// every note plays count detuned copies of the oscillator, spread
+    /// evenly over detune and panned from left to right by pitch
+    struct unison_t {
+        int count;    // 1 - UNISON_MAX
+        float detune; // semitones between the outermost oscillators
+        float spread; // stereo width, 0 renders the voices in mono
+
+        /// count of the previous block, oscillators added since then start
+        /// right on their pitch
+        int rendered;
+    } unison;
+
+    /// voltage controlled filter
+    struct vcf_t {
+        float cutoff;
+        float resonance; // 0 - 1
+        int vcf_mode;    // see vcf_mode_t
+
+        /// coefficients the last block ended on, the next one starts here
+        vcf_coef_t coef;
+    } vcf;
+
+    /// voltage controlled amplifier
+    struct vca_t {
+        float volume;
+        int vca_mode; // 0 - ON   1 - EG
+    } vca;
+
+    /// saturation on the mixed voices, run oversampled so the harmonics it
+    /// adds above nyquist are filtered out instead of folding back
+    struct drive_t {
+        float drive;    // gain into the saturation, 0 bypasses the stage
+        int oversample; // 1, 2 or 4
+
+        /// left and right, initialized for os[ 0 ].factor which is 0 while
+        /// bypassed so the history is cleared when the stage comes back
+        oversampler_t os[ 2 ];
+    } drive;
+
+    /// effects after the drive, in this order; each is bypassed while its
+    /// mix is 0 and costs nothing then
+    chorus_t chorus;
+    flanger_t flanger;
+    echo_t echo;
+    reverb_t reverb;
+    convolver_t convolver;
+
+    /// low frequency oscillators, evaluated every CONTROL_INTERVAL frames
+    struct lfo_t {
+        float lfo_rate; // Hz
+        float lfo_wave; // see lfo_wave_t
+
+        lfo_state_t state;
+    } lfo[ LFO_COUNT ];
+
+    /// modulation matrix, unused slots have source MOD_SOURCE_NONE
+    mod_slot_t mod[ MOD_SLOT_COUNT ];
+
+    /// destination offsets at the end of the last control block, the next
+    /// one ramps from here
+    float mod_out[ MOD_DEST_COUNT ];
+
+    /// modulated pulse width and output gain the last control block ended on
+    float pulse_width;
+    float gain;
+
+    /// the voices are rendered by a kernel specialized on the waveform and
+    /// filter mode; when either changes the old kernel keeps running next to
+    /// the new one and is faded out over KERNEL_FADE_FRAMES
+    struct kernel_t {
+        int vco_wave;
+        int vcf_mode;
+
+        int fade_wave;
+        int fade_mode;
+        int fade_left; // frames, 0 when not fading
+    } kernel;
+
+    /// envelope generator
+    struct eg_t {
+        float attack;
+        float decay;
+        float sustain;
+        float release;
+
+        /// segments for the parameters above, recomputed when they change
+        eg_coef_t coef;
+        float coef_params[ 4 ];
+    } eg;
+
+    /// voice pool stored as structure-of-arrays
+    ///
+    /// voices [0, count) are sounding, the rest are free; a finished voice is
+    /// removed by moving the last active voice into its slot. the kernels
+    /// render SIMD_LANES voices at a time, so free slots are kept silent
+    /// (envelope idle at zero, filter state at zero) to be safely rendered as
+    /// padding lanes
+    struct voice_pool_t {
+        int count;
+
+        int midi_no[ VOICE_COUNT ];
+        unsigned int age[ VOICE_COUNT ];
+
+        /// current pitch in semitones, glides towards midi_no
+        float pitch[ VOICE_COUNT ];
+
+        int32_t gate[ VOICE_COUNT ];
+
+        /// one row per unison oscillator, the rows from unison.count on are
+        /// not rendered
+        SIMD_ALIGN int32_t phase[ UNISON_MAX ][ VOICE_COUNT ]; // wraps around
+        SIMD_ALIGN int32_t phase_inc[ UNISON_MAX ][ VOICE_COUNT ]; // unsigned
+
+        /// added to phase_inc every frame to ramp modulated pitch
+        SIMD_ALIGN int32_t phase_inc_step[ UNISON_MAX ][ VOICE_COUNT ];
+
+        /// band-limited table for the highest oscillator of the voice, see
+        /// wavetable_offset()
+        SIMD_ALIGN int32_t table_offset[ VOICE_COUNT ];
+
+        SIMD_ALIGN float eg_out[ VOICE_COUNT ];
+        int32_t eg_stage[ VOICE_COUNT ]; // see eg_stage_t
+
+        /// distance to eg_target, kept across blocks while the lane heads
+        /// for the same target since eg_out only holds it to the precision
+        /// of the level; it would stall a long decay just above its sustain
+        SIMD_ALIGN float eg_dist[ VOICE_COUNT ];
+        SIMD_ALIGN float eg_target[ VOICE_COUNT ];
+
+        /// left and right, the right one follows the left while the voices
+        /// are rendered in mono
+        SIMD_ALIGN float vcf_state[ 2 ][ VCF_STATE_COUNT ][ VOICE_COUNT ];
+
+        /// filter state of the kernel being faded out, the filter input
+        /// differs between kernels so it runs on a copy of its own
+        SIMD_ALIGN float fade_vcf_state[ 2 ][ VCF_STATE_COUNT ][ VOICE_COUNT ];
+    } voice;
+
+    /// incremented on every note on, used to find the oldest voice
+    unsigned int note_counter;
+
+    /// pitch of the most recent note, where new voices glide from
+    float last_pitch;
+
+    /// shared between all instances
+    const wavetables_t * tables;
+};
+
+void synth_init( synth_t * s );
+
+void synth_destroy( synth_t * s );
+
+/// loads a wav impulse response into the convolver, before rendering starts;
+/// synchronous computes all of it on the rendering thread, for offline use
+int synth_load_ir( synth_t * s, const char * path, bool synchronous );
+
+/// frequency of a fractional midi pitch the way the voices compute it
+float synth_pitch_to_freq( float pitch );
+
+/// the synth_param_t called name, -1 if there is none
+int synth_param_find( const char * name );
+
+void synth_send( synth_t * s, const synth_command_t & command );
+
+/// renders interleaved stereo frames
+void synth_render( synth_t * s, float * out, int frames );
+
+// the same engine with the voice kernels on the scalar path of simd.hpp, see
+// synth_scalar.cpp; the effects after the voices are shared with the above
+
+void synth_scalar_init( synth_t * s );
+
+void synth_scalar_destroy( synth_t * s );
+
+int synth_scalar_load_ir( synth_t * s, const char * path, bool synchronous );
+
+float synth_scalar_pitch_to_freq( float pitch );
+
+int synth_scalar_param_find( const char * name );
+
+void synth_scalar_send( synth_t * s, const synth_command_t & command );
+
+void synth_scalar_render( synth_t * s, float * out, int frames );
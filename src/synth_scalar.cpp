@@ -0,0 +1,14 @@
+// the synth engine built a second time on the scalar path of simd.hpp, under
+// its own names, so offline_check_simd() can compare the two in one program
+
+#define SIMD_SCALAR 1
+
+#define synth_init      synth_scalar_init
+#define synth_destroy   synth_scalar_destroy
+#define synth_load_ir   synth_scalar_load_ir
+#define synth_send      synth_scalar_send
+#define synth_pitch_to_freq synth_scalar_pitch_to_freq
+#define synth_param_find    synth_scalar_param_find
+#define synth_render    synth_scalar_render
+
+#include "synth.cpp"
@@ -0,0 +1,58 @@
+#pragma once
+
+#include <atomic>
+
+/// wait-free single producer / single consumer handoff of a value
+///
+/// the writer fills its private slot and swaps it with the shared middle
+/// slot, the reader swaps the middle slot with its own whenever the writer
+/// has published since the last read, neither side ever waits on the other
+/// and the reader always gets the latest complete value
+template < typename T > struct triple_buffer_t {
+    /// set in middle when it holds a value the reader has not taken yet
+    static constexpr int FRESH = 4;
+
+    T slots[ 3 ];
+
+    int back;
+    std::atomic< int > middle;
+    int front;
+};
+
+template < typename T > void triple_buffer_init( triple_buffer_t< T > * b )
+{
+    b->slots[ 0 ] = {};
+    b->slots[ 1 ] = {};
+    b->slots[ 2 ] = {};
+
+    b->back = 0;
+    b->middle.store( 1 );
+    b->front = 2;
+}
+
+/// the slot the writer may fill before calling triple_buffer_publish()
+template < typename T > T * triple_buffer_back( triple_buffer_t< T > * b )
+{
+    return &b->slots[ b->back ];
+}
+
+template < typename T > void triple_buffer_publish( triple_buffer_t< T > * b )
+{
+    int old = b->middle.exchange(
+        b->back | triple_buffer_t< T >::FRESH,
+        std::memory_order_acq_rel
+    );
+    b->back = old & ~triple_buffer_t< T >::FRESH;
+}
+
+/// the newest published value, stays valid until the next read
+template < typename T > const T * triple_buffer_read( triple_buffer_t< T > * b )
+{
+    if ( b->middle.load( std::memory_order_relaxed ) &
+         triple_buffer_t< T >::FRESH ) {
+        int old = b->middle.exchange( b->front, std::memory_order_acq_rel );
+        b->front = old & ~triple_buffer_t< T >::FRESH;
+    }
+
+    return &b->slots[ b->front ];
+}
@@ -0,0 +1,36 @@
+#include "vcf.hpp"
+
+#include <math.h>
+
+#ifndef M_PI
+#define M_PI ( 3.14159265 )
+#endif
+
+vcf_coef_t vcf_coef( float cutoff, float resonance, float sample_rate )
+{
+    // tan() runs away near nyquist
+    float max_cutoff = 0.45f * sample_rate;
+    if ( cutoff < 10.0f ) cutoff = 10.0f;
+    if ( cutoff > max_cutoff ) cutoff = max_cutoff;
+    if ( resonance < 0.0f ) resonance = 0.0f;
+    if ( resonance > 1.0f ) resonance = 1.0f;
+
+    float g = tanf( (float) M_PI * cutoff / sample_rate );
+
+    vcf_coef_t c;
+    c.G = g / ( 1.0f + g );
+
+    // damping 2 is a q of 0.5, critically damped with no peak at all (a
+    // butterworth response would be the square root of 2); it goes down to
+    // a q of 25
+    float k = 2.0f - 1.96f * resonance;
+    c.svf_a1 = 1.0f / ( 1.0f + g * ( g + k ) );
+    c.svf_a2 = g * c.svf_a1;
+    c.svf_a3 = g * c.svf_a2;
+
+    float G4 = c.G * c.G * c.G * c.G;
+    c.ladder_k = 3.9f * resonance;
+    c.ladder_d = 1.0f / ( 1.0f + c.ladder_k * G4 );
+
+    return c;
+}
@@ -0,0 +1,183 @@
+#pragma once
+
+#include "simd.hpp"
+
+/// state variables per voice, the svf uses two and the ladder all four
+#define VCF_STATE_COUNT 4
+
+enum vcf_mode_t {
+    VCF_ONE_POLE, // 6 dB lowpass
+    VCF_SVF,      // 12 dB state variable lowpass
+    VCF_LADDER,   // 24 dB four pole ladder lowpass
+    VCF_MODE_COUNT,
+};
+
+/// coefficients for one cutoff and resonance, computed at control rate
+///
+/// all filters are built from trapezoidal (topology preserving) integrators
+/// with the cutoff prewarped as g = tan( pi fc / fs ), so they have no unit
+/// delay in the feedback path and track the cutoff all the way up
+struct vcf_coef_t {
+    float G; // one pole gain, g / ( 1 + g )
+
+    float svf_a1;
+    float svf_a2;
+    float svf_a3;
+
+    float ladder_k; // feedback, 0 - 4
+    float ladder_d; // 1 / ( 1 + k G^4 ), solves the feedback loop
+};
+
+vcf_coef_t vcf_coef( float cutoff, float resonance, float sample_rate );
+
+// the kernels below filter one block of SIMD_LANES voices in place, the
+// coefficients move linearly from `from` towards `to` and land on `to` at the
+// last sample; state holds pointers to the VCF_STATE_COUNT state variables
+// of the lanes
+//
+// they live in the header so the voice kernels can inline the one they are
+// specialized on
+
+inline void vcf_one_pole(
+    f32x4 * buf,
+    int frames,
+    float * const * state,
+    const vcf_coef_t & from,
+    const vcf_coef_t & to
+)
+{
+    f32x4 s = f32x4_load( state[ 0 ] );
+
+    const f32x4 G_step = f32x4_set1( ( to.G - from.G ) / frames );
+    f32x4 G = f32x4_set1( from.G );
+
+    for ( int i = 0; i < frames; i++ ) {
+        G += G_step;
+
+        f32x4 v = ( buf[ i ] - s ) * G;
+        f32x4 y = v + s;
+        s = y + v;
+
+        buf[ i ] = y;
+    }
+
+    f32x4_store( state[ 0 ], s );
+}
+
+inline void vcf_svf(
+    f32x4 * buf,
+    int frames,
+    float * const * state,
+    const vcf_coef_t & from,
+    const vcf_coef_t & to
+)
+{
+    f32x4 ic1 = f32x4_load( state[ 0 ] );
+    f32x4 ic2 = f32x4_load( state[ 1 ] );
+
+    const f32x4 a1_step = f32x4_set1( ( to.svf_a1 - from.svf_a1 ) / frames );
+    const f32x4 a2_step = f32x4_set1( ( to.svf_a2 - from.svf_a2 ) / frames );
+    const f32x4 a3_step = f32x4_set1( ( to.svf_a3 - from.svf_a3 ) / frames );
+    f32x4 a1 = f32x4_set1( from.svf_a1 );
+    f32x4 a2 = f32x4_set1( from.svf_a2 );
+    f32x4 a3 = f32x4_set1( from.svf_a3 );
+
+    for ( int i = 0; i < frames; i++ ) {
+        a1 += a1_step;
+        a2 += a2_step;
+        a3 += a3_step;
+
+        f32x4 v3 = buf[ i ] - ic2;
+        f32x4 v1 = a1 * ic1 + a2 * v3;
+        f32x4 v2 = ic2 + a2 * ic1 + a3 * v3;
+        ic1 = v1 + v1 - ic1;
+        ic2 = v2 + v2 - ic2;
+
+        buf[ i ] = v2;
+    }
+
+    f32x4_store( state[ 0 ], ic1 );
+    f32x4_store( state[ 1 ], ic2 );
+}
+
+inline void vcf_ladder(
+    f32x4 * buf,
+    int frames,
+    float * const * state,
+    const vcf_coef_t & from,
+    const vcf_coef_t & to
+)
+{
+    f32x4 s1 = f32x4_load( state[ 0 ] );
+    f32x4 s2 = f32x4_load( state[ 1 ] );
+    f32x4 s3 = f32x4_load( state[ 2 ] );
+    f32x4 s4 = f32x4_load( state[ 3 ] );
+
+    const f32x4 one = f32x4_set1( 1.0f );
+
+    const f32x4 G_step = f32x4_set1( ( to.G - from.G ) / frames );
+    const f32x4 k_step = f32x4_set1( ( to.ladder_k - from.ladder_k ) / frames );
+    const f32x4 d_step = f32x4_set1( ( to.ladder_d - from.ladder_d ) / frames );
+    f32x4 G = f32x4_set1( from.G );
+    f32x4 k = f32x4_set1( from.ladder_k );
+    f32x4 d = f32x4_set1( from.ladder_d );
+
+    for ( int i = 0; i < frames; i++ ) {
+        G += G_step;
+        k += k_step;
+        d += d_step;
+
+        // each stage is y = G x + ( 1 - G ) s, so the last output is an
+        // affine function of the input and the loop solves in closed form
+        f32x4 H = one - G;
+        f32x4 sigma = ( ( s1 * H * G + s2 * H ) * G + s3 * H ) * G + s4 * H;
+
+        // scaling the input by 1 + k keeps unity gain at dc
+        f32x4 x = buf[ i ] * ( one + k );
+        f32x4 G2 = G * G;
+        f32x4 y4 = ( G2 * G2 * x + sigma ) * d;
+        f32x4 u = x - k * y4;
+
+        f32x4 v = ( u - s1 ) * G;
+        f32x4 y = v + s1;
+        s1 = y + v;
+
+        v = ( y - s2 ) * G;
+        y = v + s2;
+        s2 = y + v;
+
+        v = ( y - s3 ) * G;
+        y = v + s3;
+        s3 = y + v;
+
+        v = ( y - s4 ) * G;
+        y = v + s4;
+        s4 = y + v;
+
+        buf[ i ] = y;
+    }
+
+    f32x4_store( state[ 0 ], s1 );
+    f32x4_store( state[ 1 ], s2 );
+    f32x4_store( state[ 2 ], s3 );
+    f32x4_store( state[ 3 ], s4 );
+}
+
+/// the kernel for a filter mode, resolved at compile time
+template < int MODE >
+inline void vcf_block(
+    f32x4 * buf,
+    int frames,
+    float * const * state,
+    const vcf_coef_t & from,
+    const vcf_coef_t & to
+)
+{
+    if constexpr ( MODE == VCF_SVF ) {
+        vcf_svf( buf, frames, state, from, to );
+    } else if constexpr ( MODE == VCF_LADDER ) {
+        vcf_ladder( buf, frames, state, from, to );
+    } else {
+        vcf_one_pole( buf, frames, state, from, to );
+    }
+}
@@ -0,0 +1,207 @@
+#include "wav.hpp"
+
+#include "logging.hpp"
+
+#include <stdint.h>
+#include <string.h>
+
+#include <vector>
+
+#define WAV_FORMAT_PCM        1
+#define WAV_FORMAT_FLOAT      3
+#define WAV_FORMAT_EXTENSIBLE 0xfffe
+
+static void write_u32( FILE * file, uint32_t x )
+{
+    unsigned char b[ 4 ] = {
+        (unsigned char) x,
+        (unsigned char) ( x >> 8 ),
+        (unsigned char) ( x >> 16 ),
+        (unsigned char) ( x >> 24 ),
+    };
+    fwrite( b, 1, 4, file );
+}
+
+static void write_u16( FILE * file, uint16_t x )
+{
+    unsigned char b[ 2 ] = { (unsigned char) x, (unsigned char) ( x >> 8 ) };
+    fwrite( b, 1, 2, file );
+}
+
+static void write_header( wav_writer_t * w, int rate )
+{
+    uint32_t data_size = (uint32_t) w->frames * w->channels * 4;
+
+    fwrite( "RIFF", 1, 4, w->file );
+    write_u32( w->file, 36 + data_size );
+    fwrite( "WAVE", 1, 4, w->file );
+
+    fwrite( "fmt ", 1, 4, w->file );
+    write_u32( w->file, 16 );
+    write_u16( w->file, WAV_FORMAT_FLOAT );
+    write_u16( w->file, w->channels );
+    write_u32( w->file, rate );
+    write_u32( w->file, rate * w->channels * 4 );
+    write_u16( w->file, w->channels * 4 );
+    write_u16( w->file, 32 );
+
+    fwrite( "data", 1, 4, w->file );
+    write_u32( w->file, data_size );
+}
+
+int wav_open( wav_writer_t * w, const char * path, int channels, int rate )
+{
+    w->file = fopen( path, "wb" );
+    w->channels = channels;
+    w->frames = 0;
+
+    if ( !w->file ) {
+        ERROR_LOG( "failed to open %s", path );
+        return 1;
+    }
+
+    write_header( w, rate );
+
+    return 0;
+}
+
+void wav_write( wav_writer_t * w, const float * samples, int frames )
+{
+    // samples go out in host order, little endian on every target we build
+    fwrite( samples, sizeof( float ) * w->channels, frames, w->file );
+    w->frames += frames;
+}
+
+void wav_close( wav_writer_t * w )
+{
+    uint32_t data_size = (uint32_t) w->frames * w->channels * 4;
+
+    fseek( w->file, 4, SEEK_SET );
+    write_u32( w->file, 36 + data_size );
+    fseek( w->file, 40, SEEK_SET );
+    write_u32( w->file, data_size );
+
+    fclose( w->file );
+    w->file = nullptr;
+}
+
+static uint32_t read_u32( const unsigned char * p )
+{
+    return p[ 0 ] | ( p[ 1 ] << 8 ) | ( p[ 2 ] << 16 ) |
+           ( (uint32_t) p[ 3 ] << 24 );
+}
+
+static uint16_t read_u16( const unsigned char * p )
+{
+    return (uint16_t) ( p[ 0 ] | ( p[ 1 ] << 8 ) );
+}
+
+/// one sample of bits bits in the given format, scaled to -1 - 1
+static float read_sample( const unsigned char * p, int format, int bits )
+{
+    if ( format == WAV_FORMAT_FLOAT ) {
+        uint32_t u = read_u32( p );
+        float x;
+        memcpy( &x, &u, sizeof( x ) );
+        return x;
+    }
+
+    // 24 bit samples go to the top of an int32 to keep their sign
+    uint32_t u = bits == 16 ? (uint32_t) read_u16( p ) << 16
+               : bits == 24 ? (uint32_t) p[ 0 ] << 8 | p[ 1 ] << 16 |
+                                  (uint32_t) p[ 2 ] << 24
+                            : read_u32( p );
+
+    return (int32_t) u / 2147483648.0f;
+}
+
+int wav_read(
+    const char * path,
+    float ** samples,
+    int * channels,
+    int * frames,
+    int * rate
+)
+{
+    FILE * file = fopen( path, "rb" );
+    if ( !file ) {
+        ERROR_LOG( "failed to open %s", path );
+        return 1;
+    }
+
+    std::vector< unsigned char > data;
+    unsigned char chunk[ 4096 ];
+    size_t n;
+    while ( ( n = fread( chunk, 1, sizeof( chunk ), file ) ) > 0 ) {
+        data.insert( data.end(), chunk, chunk + n );
+    }
+    fclose( file );
+
+    const unsigned char * p = data.data();
+    const unsigned char * end = p + data.size();
+
+    if ( data.size() < 12 || memcmp( p, "RIFF", 4 ) ||
+         memcmp( p + 8, "WAVE", 4 ) ) {
+        ERROR_LOG( "%s is not a wav file", path );
+        return 1;
+    }
+    p += 12;
+
+    int format = 0, count = 0, bits = 0;
+    const unsigned char * samples_start = nullptr;
+    uint32_t samples_size = 0;
+
+    while ( end - p >= 8 ) {
+        uint32_t size = read_u32( p + 4 );
+        const unsigned char * body = p + 8;
+        if ( size > (uint32_t) ( end - body ) ) {
+            size = (uint32_t) ( end - body );
+        }
+
+        if ( !memcmp( p, "fmt ", 4 ) && size >= 16 ) {
+            format = read_u16( body );
+            count = read_u16( body + 2 );
+            *rate = (int) read_u32( body + 4 );
+            bits = read_u16( body + 14 );
+
+            // the real format is the first two bytes of the sub format guid
+            if ( format == WAV_FORMAT_EXTENSIBLE && size >= 26 ) {
+                format = read_u16( body + 24 );
+            }
+        }
+
+        if ( !memcmp( p, "data", 4 ) ) {
+            samples_start = body;
+            samples_size = size;
+        }
+
+        // chunks are padded to an even size
+        p = body + size + ( size & 1 );
+    }
+
+    bool pcm = format == WAV_FORMAT_PCM &&
+               ( bits == 16 || bits == 24 || bits == 32 );
+    bool floating = format == WAV_FORMAT_FLOAT && bits == 32;
+
+    if ( !samples_start || count < 1 || ( !pcm && !floating ) ) {
+        ERROR_LOG(
+            "%s: unsupported wav format %d with %d bits",
+            path,
+            format,
+            bits
+        );
+        return 1;
+    }
+
+    int frame_size = count * bits / 8;
+    *channels = count;
+    *frames = (int) ( samples_size / frame_size );
+    *samples = new float[ (size_t) *frames * count ];
+
+    for ( int i = 0; i < *frames * count; i++ ) {
+        const unsigned char * s = samples_start + i * ( bits / 8 );
+        ( *samples )[ i ] = read_sample( s, format, bits );
+    }
+
+    return 0;
+}
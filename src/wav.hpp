@@ -0,0 +1,28 @@
+#pragma once
+
+#include <stdio.h>
+
+/// streams 32 bit float samples into a wav file, the header sizes are
+/// filled in on close
+struct wav_writer_t {
+    FILE * file;
+    int channels;
+    int frames;
+};
+
+int wav_open( wav_writer_t * w, const char * path, int channels, int rate );
+
+/// writes interleaved frames
+void wav_write( wav_writer_t * w, const float * samples, int frames );
+
+void wav_close( wav_writer_t * w );
+
+/// reads a whole 16, 24 or 32 bit pcm or 32 bit float wav file as
+/// interleaved floats, which the caller releases with delete[]
+int wav_read(
+    const char * path,
+    float ** samples,
+    int * channels,
+    int * frames,
+    int * rate
+);
@@ -0,0 +1,130 @@
+#include "wavetable.hpp"
+
+#include "logging.hpp"
+
+#include <math.h>
+
+#include <chrono>
+
+#ifndef M_PI
+#define M_PI ( 3.14159265 )
+#endif
+
+/// number of harmonics in table k
+static int harmonic_count( int k )
+{
+    return 1 << ( 30 - WAVETABLE_BASE_BITS - k );
+}
+
+/// sums the harmonics [first, last] of a fourier series into the table,
+/// amplitude( h ) scales a cosine (phase 1) or sine (phase 0) partial
+template < typename F >
+static void add_harmonics(
+    double * acc,
+    const double * sine,
+    int first,
+    int last,
+    int quarter,
+    F amplitude
+)
+{
+    const int mask = OSC_TABLE_SIZE - 1;
+
+    for ( int h = first; h <= last; h++ ) {
+        double a = amplitude( h );
+        if ( a == 0.0 ) continue;
+
+        // sin( 2 pi h i / N ) is an exact entry of the sine table
+        for ( int i = 0; i < OSC_TABLE_SIZE; i++ ) {
+            acc[ i ] += a * sine[ ( h * i + quarter ) & mask ];
+        }
+    }
+}
+
+/// fills every octave of a set, starting from the table with the fewest
+/// harmonics and adding the missing ones for each lower octave
+template < typename F >
+static void generate_set(
+    wavetable_set_t & set,
+    const double * sine,
+    double dc,
+    int quarter,
+    F amplitude
+)
+{
+    static double acc[ OSC_TABLE_SIZE ];
+
+    for ( int i = 0; i < OSC_TABLE_SIZE; i++ ) acc[ i ] = dc;
+
+    int done = 0;
+    for ( int k = WAVETABLE_COUNT - 1; k >= 0; k-- ) {
+        int count = harmonic_count( k );
+        add_harmonics( acc, sine, done + 1, count, quarter, amplitude );
+        done = count;
+
+        for ( int i = 0; i < OSC_TABLE_SIZE; i++ ) {
+            set.table[ k ][ i ] = (float) acc[ i ];
+        }
+        set.table[ k ][ OSC_TABLE_SIZE ] = set.table[ k ][ 0 ];
+    }
+}
+
+static wavetables_t * generate()
+{
+    auto start = std::chrono::steady_clock::now();
+
+    static wavetables_t tables;
+    static double sine[ OSC_TABLE_SIZE ];
+
+    for ( int i = 0; i < OSC_TABLE_SIZE; i++ ) {
+        sine[ i ] = sin( ( (double) i / (double) OSC_TABLE_SIZE ) * M_PI * 2. );
+        tables.sine[ i ] = (float) sine[ i ];
+    }
+    tables.sine[ OSC_TABLE_SIZE ] = tables.sine[ 0 ];
+
+    // falling ramp from 1 to -1
+    generate_set( tables.sawtooth, sine, 0.0, 0, []( int h ) {
+        return 2.0 / ( M_PI * h );
+    } );
+
+    // -| 2x - 1 |, odd cosine partials around a dc of -0.5
+    generate_set(
+        tables.triangle,
+        sine,
+        -0.5,
+        OSC_TABLE_SIZE / 4,
+        []( int h ) {
+            return h % 2 ? -4.0 / ( M_PI * M_PI * h * h ) : 0.0;
+        }
+    );
+
+    auto end = std::chrono::steady_clock::now();
+    double ms = std::chrono::duration< double, std::milli >( end - start )
+                    .count();
+
+    INFO_LOG(
+        "wavetables: %d kB, generated in %.1f ms",
+        (int) ( sizeof( tables ) / 1024 ),
+        ms
+    );
+
+    return &tables;
+}
+
+const wavetables_t * wavetables_get()
+{
+    static const wavetables_t * tables = generate();
+    return tables;
+}
+
+int wavetable_offset( uint32_t phase_inc )
+{
+    int bits = 0;
+    while ( bits < 32 && ( phase_inc >> bits ) ) bits++;
+
+    int k = bits - 1 - WAVETABLE_BASE_BITS;
+    if ( k < 0 ) k = 0;
+    if ( k > WAVETABLE_COUNT - 1 ) k = WAVETABLE_COUNT - 1;
+
+    return k * ( OSC_TABLE_SIZE + 1 );
+}
@@ -0,0 +1,35 @@
+#pragma once
+
+#include <stdint.h>
+
+#define OSC_TABLE_BITS 12
+#define OSC_TABLE_SIZE ( 1 << OSC_TABLE_BITS )
+
+/// number of band-limited tables per waveform, one per octave
+#define WAVETABLE_COUNT 11
+
+/// table 0 serves phase increments below 2^( WAVETABLE_BASE_BITS + 1 ), which
+/// is about 21 Hz, every following table covers one octave more
+#define WAVETABLE_BASE_BITS 20
+
+/// one waveform at every octave; table k holds the harmonics that stay below
+/// nyquist for every fundamental it serves (1024 >> k of them)
+///
+/// every table has one guard entry past the end for interpolation, and the
+/// tables are contiguous so a voice can address its octave with an offset
+struct wavetable_set_t {
+    float table[ WAVETABLE_COUNT ][ OSC_TABLE_SIZE + 1 ];
+};
+
+struct wavetables_t {
+    float sine[ OSC_TABLE_SIZE + 1 ];
+    wavetable_set_t sawtooth;
+    wavetable_set_t triangle;
+};
+
+/// generated on the first call and shared by every synth instance
+const wavetables_t * wavetables_get();
+
+/// offset of the table (from the start of a wavetable_set_t) that plays the
+/// given 32 bit phase increment without aliasing
+int wavetable_offset( uint32_t phase_inc );